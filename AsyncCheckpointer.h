@@ -0,0 +1,260 @@
+//-----------------------------------------------------------------------------
+// File: AsyncCheckpointer.h
+// Author: Edward Koch
+// Description: Holds the declaration of the AsyncCheckpointer Class
+//              Checkpoints a Neural Net every N batches or seconds without
+//              stalling training - the weights are copied into a spare
+//              snapshot buffer on the training thread, then a background
+//              writer checksums it, flushes it to disk and renames it over
+//              the previous checkpoint
+//
+//              If a checkpoint comes due while the previous one is still
+//              being written it is deferred to the next batch rather than
+//              blocking the training loop
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef ASYNC_CHECKPOINTER_H
+#define ASYNC_CHECKPOINTER_H
+
+#include "Checkpoint.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <math.h>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T = double_t>
+class AsyncCheckpointer
+{
+public:
+    // Constructor - checkpoint to path every everyBatches batches or every
+    // everySeconds seconds, whichever comes first - 0 disables either trigger
+    AsyncCheckpointer(const char* path, uint32_t everyBatches, double_t everySeconds = 0.0);
+
+    // Destructor - finishes any write in progress and stops the writer
+    ~AsyncCheckpointer();
+
+    // Count one trained batch and snapshot the Neural Net if a checkpoint is due
+    // Returns true if a snapshot was taken
+    bool step(const NeuralNet<numInputs, numHidden, numOutputs, T> &net);
+
+    // Snapshot the Neural Net now - waits for a write in progress to finish
+    void checkpoint(const NeuralNet<numInputs, numHidden, numOutputs, T> &net);
+
+    // Wait until every snapshot taken so far is on disk
+    void flush();
+
+    // Copy the latest checkpoint into the Neural Net and continue counting from its step
+    // Returns false if there is no valid checkpoint for this Neural Net
+    bool resume(NeuralNet<numInputs, numHidden, numOutputs, T> &net);
+
+    // Get the number of batches trained, including those before a resume
+    uint64_t getStep() const { return numSteps; }
+
+    // Get the number of checkpoints written and failed
+    uint32_t getNumWritten() const { return numWritten; }
+    uint32_t getNumFailed() const { return numFailed; }
+
+private:
+    AsyncCheckpointer(const AsyncCheckpointer &other) = delete;
+    AsyncCheckpointer& operator=(const AsyncCheckpointer &other) = delete;
+
+    // Copy the Neural Net into the spare buffer and hand it to the writer
+    // The writer must be idle
+    void takeSnapshot(const NeuralNet<numInputs, numHidden, numOutputs, T> &net);
+
+    // Writer thread - writes each snapshot handed to it
+    void write();
+
+    // Configuration
+    std::string path;
+    uint32_t everyBatches;
+    double_t everySeconds;
+
+    // Training thread state
+    uint64_t numSteps;
+    uint64_t lastSnapshotStep;
+    std::chrono::steady_clock::time_point lastSnapshotTime;
+
+    // Spare buffer - owned by the writer while a snapshot is pending
+    std::vector<uint8_t> snapshotBytes;
+
+    std::mutex mutex;
+    std::condition_variable snapshotReady;
+    std::condition_variable snapshotWritten;
+
+    bool pending;
+    bool stopping;
+    std::atomic<uint32_t> numWritten;
+    std::atomic<uint32_t> numFailed;
+
+    // Writer - started on the first snapshot
+    std::thread writer;
+};
+
+// Constructor - checkpoint to path every everyBatches batches or every everySeconds seconds
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::AsyncCheckpointer(const char* path, uint32_t everyBatches, double_t everySeconds)
+    : path(path),
+      everyBatches(everyBatches),
+      everySeconds(everySeconds),
+      numSteps(0),
+      lastSnapshotStep(0),
+      lastSnapshotTime(std::chrono::steady_clock::now()),
+      pending(false),
+      stopping(false),
+      numWritten(0),
+      numFailed(0)
+{
+
+}
+
+// Destructor - finishes any write in progress and stops the writer
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::~AsyncCheckpointer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    snapshotReady.notify_all();
+
+    if (writer.joinable())
+    {
+        writer.join();
+    }
+}
+
+// Count one trained batch and snapshot the Neural Net if a checkpoint is due
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::step(const NeuralNet<numInputs, numHidden, numOutputs, T> &net)
+{
+    ++numSteps;
+
+    bool batchesDue = everyBatches > 0 && numSteps - lastSnapshotStep >= everyBatches;
+    bool secondsDue = everySeconds > 0.0 &&
+                      std::chrono::duration<double_t>(std::chrono::steady_clock::now() - lastSnapshotTime).count() >= everySeconds;
+
+    if (!batchesDue && !secondsDue)
+    {
+        return false;
+    }
+
+    // Never wait on the writer here - try again after the next batch
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (pending)
+        {
+            return false;
+        }
+    }
+
+    takeSnapshot(net);
+
+    return true;
+}
+
+// Snapshot the Neural Net now - waits for a write in progress to finish
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::checkpoint(const NeuralNet<numInputs, numHidden, numOutputs, T> &net)
+{
+    flush();
+    takeSnapshot(net);
+}
+
+// Wait until every snapshot taken so far is on disk
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    snapshotWritten.wait(lock, [this]() { return !pending; });
+}
+
+// Copy the latest checkpoint into the Neural Net and continue counting from its step
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::resume(NeuralNet<numInputs, numHidden, numOutputs, T> &net)
+{
+    flush();
+
+    CheckpointFile file;
+
+    if (!file.open(path.c_str()) || !file.load(net))
+    {
+        return false;
+    }
+
+    numSteps = file.getHeader().step;
+    lastSnapshotStep = numSteps;
+    lastSnapshotTime = std::chrono::steady_clock::now();
+
+    return true;
+}
+
+// Copy the Neural Net into the spare buffer and hand it to the writer
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::takeSnapshot(const NeuralNet<numInputs, numHidden, numOutputs, T> &net)
+{
+    // The writer is idle, so the buffer belongs to this thread until it is handed over
+    CheckpointFile::snapshot(net, numSteps, snapshotBytes);
+
+    lastSnapshotStep = numSteps;
+    lastSnapshotTime = std::chrono::steady_clock::now();
+
+    if (!writer.joinable())
+    {
+        writer = std::thread(&AsyncCheckpointer::write, this);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = true;
+    }
+    snapshotReady.notify_one();
+}
+
+// Writer thread - writes each snapshot handed to it
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void AsyncCheckpointer<numInputs, numHidden, numOutputs, T>::write()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    while (true)
+    {
+        snapshotReady.wait(lock, [this]() { return pending || stopping; });
+
+        // A pending snapshot is always written, even when stopping
+        if (!pending)
+        {
+            return;
+        }
+
+        // Checksum, flush and rename without holding the lock
+        lock.unlock();
+        bool written = CheckpointFile::write(path.c_str(), snapshotBytes);
+        lock.lock();
+
+        if (written)
+        {
+            ++numWritten;
+        }
+        else
+        {
+            ++numFailed;
+        }
+
+        pending = false;
+        snapshotWritten.notify_all();
+    }
+}
+
+#endif
@@ -0,0 +1,427 @@
+//-----------------------------------------------------------------------------
+// File: BatchPipeline.h
+// Author: Edward Koch
+// Description: Holds the declaration of the BatchPipeline Class
+//              Background workers shuffle, normalise and optionally augment
+//              (shift, rotate, noise) the next mini-batches while the current
+//              one trains, so data preparation is hidden behind compute
+//
+//              Batches are prepared into a ring of aligned slots - with the
+//              default of two slots one batch trains while the next is built
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Seeded Epoch Sampling
+//-----------------------------------------------------------------------------
+#ifndef BATCH_PIPELINE_H
+#define BATCH_PIPELINE_H
+
+#include "MatrixSimd.h"
+#include "MatrixStorage.h"
+#include "Sampler.h"
+
+#include <condition_variable>
+#include <math.h>
+#include <mutex>
+#include <random>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+template <uint16_t numInputs, uint16_t numOutputs, typename T = double_t>
+class BatchPipeline
+{
+public:
+    // One labelled image - the pixels must outlive the pipeline's use of them
+    struct Source
+    {
+        uint8_t label;
+        const uint8_t* pixels;
+    };
+
+    // Random distortions applied to every prepared image - all zero disables them
+    struct Augmentation
+    {
+        uint16_t maxShift;      // Pixels in x and y
+        T maxRotation;          // Radians either way, about the image centre
+        T noise;                // Standard deviation of added gaussian noise
+    };
+
+    // One prepared mini-batch - inputs and one-hot answers, one row per sample
+    struct Batch
+    {
+        // Get the inputs of one sample
+        const T(&getInputs(uint32_t sample) const)[numInputs] { return *(const T(*)[numInputs])(inputs + (uint64_t)sample * numInputs); }
+
+        // Get the one-hot answers of one sample
+        const T(&getAnswers(uint32_t sample) const)[numOutputs] { return *(const T(*)[numOutputs])(answers + (uint64_t)sample * numOutputs); }
+
+        // Get the label of one sample
+        uint8_t getLabel(uint32_t sample) const { return labels[sample]; }
+
+        // Number of samples - only the last batch of a pass may be partial
+        uint32_t count;
+
+        T* inputs;
+        T* answers;
+        uint8_t* labels;
+
+        // Pass position of the batch held in this slot, and whether it is ready
+        uint64_t index;
+        bool ready;
+    };
+
+    // Constructor - images are imageWidth pixels wide (numInputs / imageWidth tall)
+    BatchPipeline(uint32_t batchSize, uint16_t imageWidth, uint16_t numWorkers = 1, uint16_t numSlots = 2, uint64_t seed = 0);
+
+    // Destructor - stops the workers and frees the slots
+    ~BatchPipeline();
+
+    // Set the samples every pass is drawn from
+    void setSources(const std::vector<Source> &newSources);
+
+    // Set the distortions applied to every prepared image
+    void setAugmentation(const Augmentation &newAugmentation);
+
+    // Set how the samples of every pass are ordered - shuffled by default
+    void setSampling(Sampler::Mode mode);
+
+    // Get the number of samples in a full batch
+    uint32_t getBatchSize() const { return batchSize; }
+
+    // Start a pass over every source in the order of the next epoch
+    // Any pass still running is stopped first
+    void start();
+
+    // Get the next prepared batch - blocks until a worker has finished it
+    // The batch is valid until the next call to next()
+    // Returns false once every batch of the pass has been returned
+    bool next(const Batch* &batch);
+
+    // Abandon the current pass and stop the workers
+    void stop();
+
+private:
+    BatchPipeline(const BatchPipeline &other) = delete;
+    BatchPipeline& operator=(const BatchPipeline &other) = delete;
+
+    // Worker thread - prepares every numWorkers-th batch of the pass
+    void work(uint16_t workerIdx);
+
+    // Normalise, augment and label one sample into a slot
+    void prepareSample(const Source &source, Batch &slot, uint32_t sample, std::mt19937 &workerRng) const;
+
+    // Sample an image with an affine map - bilinear, zero outside the image
+    void transform(const uint8_t* pixels, T* image, T angle, T shiftX, T shiftY) const;
+
+    // Configuration
+    uint32_t batchSize;
+    uint16_t imageWidth;
+    uint16_t imageHeight;
+    uint16_t numWorkers;
+    Augmentation augmentation;
+
+    // Samples and the order of the current pass
+    std::vector<Source> sources;
+    Sampler sampler;
+    uint64_t seed;
+
+    // Ring of prepared batches
+    std::vector<Batch> slots;
+
+    std::mutex mutex;
+    std::condition_variable batchReady;
+    std::condition_variable batchFreed;
+
+    uint64_t numBatches;
+    uint64_t numConsumed;   // Batches handed to the consumer, including the one in use
+    uint64_t numReleased;   // Batches whose slots have been handed back to the workers
+    bool stopping;
+
+    // Workers
+    std::vector<std::thread> workers;
+};
+
+// Constructor - images are imageWidth pixels wide (numInputs / imageWidth tall)
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline BatchPipeline<numInputs, numOutputs, T>::BatchPipeline(uint32_t batchSize, uint16_t imageWidth, uint16_t numWorkers, uint16_t numSlots, uint64_t seed)
+    : batchSize(batchSize > 0 ? batchSize : 1),
+      imageWidth(imageWidth > 0 ? imageWidth : numInputs),
+      imageHeight((uint16_t)(numInputs / (imageWidth > 0 ? imageWidth : numInputs))),
+      numWorkers(numWorkers > 0 ? numWorkers : 1),
+      augmentation{ 0, (T)0.0, (T)0.0 },
+      sampler(0, seed),
+      seed(seed),
+      slots(numSlots > 1 ? numSlots : 2),
+      numBatches(0),
+      numConsumed(0),
+      numReleased(0),
+      stopping(false)
+{
+    // Aligned slots so the rows can be read straight into the Neural Net
+    for (Batch &slot : slots)
+    {
+        slot.count = 0;
+        slot.inputs = (T*)Storage::heapArena().allocate((uint64_t)this->batchSize * numInputs * sizeof(T));
+        slot.answers = (T*)Storage::heapArena().allocate((uint64_t)this->batchSize * numOutputs * sizeof(T));
+        slot.labels = (uint8_t*)Storage::heapArena().allocate(this->batchSize);
+        slot.index = 0;
+        slot.ready = false;
+    }
+}
+
+// Destructor - stops the workers and frees the slots
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline BatchPipeline<numInputs, numOutputs, T>::~BatchPipeline()
+{
+    stop();
+
+    for (Batch &slot : slots)
+    {
+        Storage::heapArena().deallocate(slot.inputs, (uint64_t)batchSize * numInputs * sizeof(T));
+        Storage::heapArena().deallocate(slot.answers, (uint64_t)batchSize * numOutputs * sizeof(T));
+        Storage::heapArena().deallocate(slot.labels, batchSize);
+    }
+}
+
+// Set the samples every pass is drawn from
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::setSources(const std::vector<Source> &newSources)
+{
+    stop();
+    sources = newSources;
+
+    // Labels let the sampler balance the classes
+    std::vector<uint16_t> labels(sources.size());
+    for (size_t i = 0; i < sources.size(); ++i)
+    {
+        labels[i] = sources[i].label;
+    }
+    sampler.setLabels(labels);
+}
+
+// Set the distortions applied to every prepared image
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::setAugmentation(const Augmentation &newAugmentation)
+{
+    stop();
+    augmentation = newAugmentation;
+}
+
+// Set how the samples of every pass are ordered
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::setSampling(Sampler::Mode mode)
+{
+    stop();
+    sampler.setMode(mode);
+}
+
+// Start a pass over every source in the order of the next epoch
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::start()
+{
+    stop();
+
+    sampler.nextEpoch();
+
+    numBatches = (sampler.size() + batchSize - 1) / batchSize;
+    numConsumed = 0;
+    numReleased = 0;
+    stopping = false;
+
+    for (Batch &slot : slots)
+    {
+        slot.ready = false;
+    }
+
+    for (uint16_t i = 0; i < numWorkers; ++i)
+    {
+        workers.emplace_back(&BatchPipeline::work, this, i);
+    }
+}
+
+// Get the next prepared batch - blocks until a worker has finished it
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline bool BatchPipeline<numInputs, numOutputs, T>::next(const Batch* &batch)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // Hand the previous batch's slot back to the workers
+    if (numConsumed > 0)
+    {
+        slots[(numConsumed - 1) % slots.size()].ready = false;
+        numReleased = numConsumed;
+        batchFreed.notify_all();
+    }
+
+    if (numConsumed >= numBatches || workers.empty())
+    {
+        return false;
+    }
+
+    Batch &slot = slots[numConsumed % slots.size()];
+    batchReady.wait(lock, [this, &slot]() { return slot.ready && slot.index == numConsumed; });
+
+    ++numConsumed;
+    batch = &slot;
+
+    return true;
+}
+
+// Abandon the current pass and stop the workers
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    batchFreed.notify_all();
+
+    for (std::thread &worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+}
+
+// Worker thread - prepares every numWorkers-th batch of the pass
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::work(uint16_t workerIdx)
+{
+    // Each worker has its own random stream, different for every pass
+    std::mt19937 workerRng((uint32_t)Sampler::streamSeed(Sampler::streamSeed(seed, sampler.getEpoch()), workerIdx));
+
+    for (uint64_t index = workerIdx; index < numBatches; index += numWorkers)
+    {
+        Batch &slot = slots[index % slots.size()];
+
+        // Wait until the batch that last used this slot has been consumed
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            batchFreed.wait(lock, [this, index]() { return stopping || index < numReleased + slots.size(); });
+
+            if (stopping)
+            {
+                return;
+            }
+        }
+
+        // The slot is not touched by anyone else until it is marked ready
+        uint64_t first = index * batchSize;
+        uint32_t count = (sampler.size() - first < batchSize) ? (uint32_t)(sampler.size() - first) : batchSize;
+
+        for (uint32_t sample = 0; sample < count; ++sample)
+        {
+            prepareSample(sources[sampler[first + sample]], slot, sample, workerRng);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            slot.count = count;
+            slot.index = index;
+            slot.ready = true;
+        }
+        batchReady.notify_all();
+    }
+}
+
+// Normalise, augment and label one sample into a slot
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::prepareSample(const Source &source, Batch &slot, uint32_t sample, std::mt19937 &workerRng) const
+{
+    T* image = slot.inputs + (uint64_t)sample * numInputs;
+    T* answer = slot.answers + (uint64_t)sample * numOutputs;
+
+    // Geometry - one fused pass when shifting or rotating, otherwise a SIMD conversion
+    if (augmentation.maxShift > 0 || augmentation.maxRotation > (T)0.0)
+    {
+        std::uniform_real_distribution<T> angle(-augmentation.maxRotation, augmentation.maxRotation);
+        std::uniform_int_distribution<int32_t> shift(-(int32_t)augmentation.maxShift, (int32_t)augmentation.maxShift);
+
+        T a = angle(workerRng);
+        T dx = (T)shift(workerRng);
+        T dy = (T)shift(workerRng);
+
+        transform(source.pixels, image, a, dx, dy);
+    }
+    else
+    {
+        Simd::ops<T>().fromBytes(image, source.pixels, (T)(1.0 / 255.0), numInputs);
+    }
+
+    // Noise - clamped back to the valid pixel range
+    if (augmentation.noise > (T)0.0)
+    {
+        std::normal_distribution<T> noise((T)0.0, augmentation.noise);
+
+        for (uint16_t i = 0; i < numInputs; ++i)
+        {
+            T value = image[i] + noise(workerRng);
+            image[i] = (value < (T)0.0) ? (T)0.0 : (value > (T)1.0) ? (T)1.0 : value;
+        }
+    }
+
+    // One-hot answer
+    Simd::ops<T>().set(answer, (T)0.0, numOutputs);
+    if (source.label < numOutputs)
+    {
+        answer[source.label] = (T)1.0;
+    }
+    slot.labels[sample] = source.label;
+}
+
+// Sample an image with an affine map - bilinear, zero outside the image
+// Every output pixel is rotated back by angle about the centre and shifted
+// back by (shiftX, shiftY) to find where it comes from in the source
+template <uint16_t numInputs, uint16_t numOutputs, typename T>
+inline void BatchPipeline<numInputs, numOutputs, T>::transform(const uint8_t* pixels, T* image, T angle, T shiftX, T shiftY) const
+{
+    const T scale = (T)(1.0 / 255.0);
+
+    T cosA = std::cos(angle);
+    T sinA = std::sin(angle);
+
+    T centreX = (T)(imageWidth - 1) * (T)0.5;
+    T centreY = (T)(imageHeight - 1) * (T)0.5;
+
+    for (uint16_t y = 0; y < imageHeight; ++y)
+    {
+        for (uint16_t x = 0; x < imageWidth; ++x)
+        {
+            T outX = (T)x - centreX - shiftX;
+            T outY = (T)y - centreY - shiftY;
+
+            T srcX = cosA * outX + sinA * outY + centreX;
+            T srcY = -sinA * outX + cosA * outY + centreY;
+
+            int32_t x0 = (int32_t)std::floor(srcX);
+            int32_t y0 = (int32_t)std::floor(srcY);
+            T fx = srcX - (T)x0;
+            T fy = srcY - (T)y0;
+
+            T value = (T)0.0;
+
+            for (int32_t dy = 0; dy < 2; ++dy)
+            {
+                for (int32_t dx = 0; dx < 2; ++dx)
+                {
+                    int32_t sx = x0 + dx;
+                    int32_t sy = y0 + dy;
+
+                    if (sx >= 0 && sx < imageWidth && sy >= 0 && sy < imageHeight)
+                    {
+                        T weight = (dx ? fx : (T)1.0 - fx) * (dy ? fy : (T)1.0 - fy);
+                        value += weight * (T)pixels[sy * imageWidth + sx];
+                    }
+                }
+            }
+
+            image[(uint32_t)y * imageWidth + x] = value * scale;
+        }
+    }
+}
+
+#endif
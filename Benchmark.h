@@ -0,0 +1,478 @@
+//-----------------------------------------------------------------------------
+// File: Benchmark.h
+// Author: Edward Koch
+// Description: Holds the declaration of the Benchmark Class
+//              Times an operation over repeated runs and keeps a report of
+//              GFLOP/s, GB/s, samples/s and ns/sample for each one, printed
+//              as a table and written as JSON so a change can be judged
+//              against a saved baseline
+//
+//              Each operation is repeated until a run lasts long enough to
+//              time, then timed several times - the fastest run is reported
+//              as the best case and the median as the typical one
+//
+//              On Linux the hardware counters (cycles, instructions, cache
+//              and L1 data misses) are read through perf_event around the
+//              timed runs - elsewhere, or where perf_event is not permitted,
+//              they are reported as unavailable
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Bench
+{
+    // Hardware events counted around the timed runs
+    enum Counter : uint8_t
+    {
+        CYCLES,
+        INSTRUCTIONS,
+        CACHE_REFERENCES,
+        CACHE_MISSES,
+        L1D_MISSES,
+        NUM_COUNTERS
+    };
+
+    // JSON names of the hardware events
+    const char* const COUNTER_NAMES[NUM_COUNTERS] =
+    {
+        "cycles",
+        "instructions",
+        "cache_references",
+        "cache_misses",
+        "l1d_misses"
+    };
+
+    // Keep the compiler from optimising away an operation whose result is unused
+    inline void doNotOptimize(const void* value)
+    {
+#ifdef _MSC_VER
+        (void)value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "g"(value) : "memory");
+#endif
+    }
+
+    // Hardware counters of the calling thread
+    class PerfCounters
+    {
+    public:
+        // Constructor - opens every event this machine and user may count
+        PerfCounters();
+
+        // Destructor - closes the events
+        ~PerfCounters();
+
+        // Check if any event could be opened
+        bool isAvailable() const { return numOpen > 0; }
+
+        // Zero and start every event
+        void start();
+
+        // Stop every event and read the counts - an event that could not be
+        // opened is marked invalid
+        void stop(uint64_t (&counts)[NUM_COUNTERS], bool (&valid)[NUM_COUNTERS]);
+
+    private:
+        PerfCounters(const PerfCounters &other) = delete;
+        PerfCounters& operator=(const PerfCounters &other) = delete;
+
+        // Event file of each counter, -1 if it could not be opened - the
+        // first open event leads the group so every event counts the same span
+        int files[NUM_COUNTERS];
+        int leader;
+        uint8_t numOpen;
+    };
+
+    // Measurements of one operation
+    struct Result
+    {
+        std::string group;
+        std::string name;
+        std::string shape;
+        std::string type;
+
+        // Operations per timed run and number of timed runs
+        uint64_t iterations;
+        uint16_t repetitions;
+
+        // Nanoseconds per operation over the fastest and the median run
+        double_t nsPerOp;
+        double_t medianNsPerOp;
+
+        // Work in one operation - zero where it does not apply
+        double_t flopsPerOp;
+        double_t bytesPerOp;
+        uint32_t samplesPerOp;
+
+        // Hardware counts per operation
+        double_t counters[NUM_COUNTERS];
+        bool counterValid[NUM_COUNTERS];
+    };
+};
+
+class Benchmark
+{
+public:
+    // Constructor - each timed run lasts at least minSeconds and is repeated repetitions times
+    // Only operations whose group or name contain filter are run
+    Benchmark(double_t minSeconds = 0.1, uint16_t repetitions = 5, const char* filter = "");
+
+    // Time an operation and add it to the report
+    // flopsPerOp, bytesPerOp and samplesPerOp describe the work of one call
+    // and may be zero where they do not apply
+    template<typename Operation>
+    void run(const char* group, const char* name, const std::string &shape, const char* type,
+             double_t flopsPerOp, double_t bytesPerOp, uint32_t samplesPerOp, Operation &&operation);
+
+    // Print the report as a table
+    void print() const;
+
+    // Write the report as JSON
+    // Returns false if the file cannot be written
+    bool writeJson(const char* path, const char* simdLevel) const;
+
+    // Get every result so far
+    const std::vector<Bench::Result>& getResults() const { return results; }
+
+private:
+    Benchmark(const Benchmark &other) = delete;
+    Benchmark& operator=(const Benchmark &other) = delete;
+
+    double_t minSeconds;
+    uint16_t repetitions;
+    std::string filter;
+
+    Bench::PerfCounters perf;
+    std::vector<Bench::Result> results;
+};
+
+// Constructor - opens every event this machine and user may count
+inline Bench::PerfCounters::PerfCounters()
+    : leader(-1),
+      numOpen(0)
+{
+    for (uint8_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        files[i] = -1;
+    }
+
+#ifdef __linux__
+    const uint32_t types[NUM_COUNTERS] =
+    {
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HARDWARE,
+        PERF_TYPE_HW_CACHE
+    };
+    const uint64_t configs[NUM_COUNTERS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_REFERENCES,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+    };
+
+    for (uint8_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.disabled = (leader < 0) ? 1 : 0;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+
+        files[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+
+        if (files[i] >= 0)
+        {
+            if (leader < 0)
+            {
+                leader = files[i];
+            }
+            ++numOpen;
+        }
+    }
+#endif
+}
+
+// Destructor - closes the events
+inline Bench::PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (uint8_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        if (files[i] >= 0)
+        {
+            close(files[i]);
+        }
+    }
+#endif
+}
+
+// Zero and start every event
+inline void Bench::PerfCounters::start()
+{
+#ifdef __linux__
+    if (leader >= 0)
+    {
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+}
+
+// Stop every event and read the counts
+inline void Bench::PerfCounters::stop(uint64_t (&counts)[NUM_COUNTERS], bool (&valid)[NUM_COUNTERS])
+{
+#ifdef __linux__
+    if (leader >= 0)
+    {
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+#endif
+
+    for (uint8_t i = 0; i < NUM_COUNTERS; ++i)
+    {
+        counts[i] = 0;
+        valid[i] = false;
+
+#ifdef __linux__
+        if (files[i] >= 0)
+        {
+            valid[i] = read(files[i], &counts[i], sizeof(counts[i])) == sizeof(counts[i]);
+        }
+#endif
+    }
+}
+
+// Constructor - each timed run lasts at least minSeconds and is repeated repetitions times
+inline Benchmark::Benchmark(double_t minSeconds, uint16_t repetitions, const char* filter)
+    : minSeconds(minSeconds),
+      repetitions(repetitions < 1 ? 1 : repetitions),
+      filter(filter)
+{
+
+}
+
+// Time an operation and add it to the report
+template<typename Operation>
+inline void Benchmark::run(const char* group, const char* name, const std::string &shape, const char* type,
+                           double_t flopsPerOp, double_t bytesPerOp, uint32_t samplesPerOp, Operation &&operation)
+{
+    if (!filter.empty() &&
+        std::string(group).find(filter) == std::string::npos &&
+        std::string(name).find(filter) == std::string::npos)
+    {
+        return;
+    }
+
+    typedef std::chrono::steady_clock Clock;
+
+    // Warm the caches and the per-thread buffers, then double the number of
+    // operations per run until a run is long enough to time
+    operation();
+
+    uint64_t iterations = 1;
+    while (true)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            operation();
+        }
+        double_t seconds = std::chrono::duration<double_t>(Clock::now() - start).count();
+
+        if (seconds >= minSeconds || iterations >= (1ull << 40))
+        {
+            break;
+        }
+
+        // Jump most of the way once the run is long enough to extrapolate
+        iterations = (seconds > minSeconds / 16.0) ? (uint64_t)ceil(iterations * 1.2 * minSeconds / seconds)
+                                                   : iterations * 2;
+    }
+
+    // Timed runs - the counters span all of them
+    std::vector<double_t> nsPerOp(repetitions);
+    uint64_t counts[Bench::NUM_COUNTERS];
+    bool valid[Bench::NUM_COUNTERS];
+
+    perf.start();
+    for (uint16_t rep = 0; rep < repetitions; ++rep)
+    {
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+        {
+            operation();
+        }
+        nsPerOp[rep] = std::chrono::duration<double_t, std::nano>(Clock::now() - start).count() / (double_t)iterations;
+    }
+    perf.stop(counts, valid);
+
+    std::sort(nsPerOp.begin(), nsPerOp.end());
+
+    Bench::Result result;
+    result.group = group;
+    result.name = name;
+    result.shape = shape;
+    result.type = type;
+    result.iterations = iterations;
+    result.repetitions = repetitions;
+    result.nsPerOp = nsPerOp.front();
+    result.medianNsPerOp = nsPerOp[repetitions / 2];
+    result.flopsPerOp = flopsPerOp;
+    result.bytesPerOp = bytesPerOp;
+    result.samplesPerOp = samplesPerOp;
+
+    for (uint8_t i = 0; i < Bench::NUM_COUNTERS; ++i)
+    {
+        result.counters[i] = (double_t)counts[i] / (double_t)(iterations * repetitions);
+        result.counterValid[i] = valid[i];
+    }
+
+    results.push_back(result);
+
+    // Print as it goes so a long sweep shows progress
+    printf("%-10s %-22s %-18s %-6s %12.1f ns", group, name, shape.c_str(), type, result.nsPerOp);
+    if (flopsPerOp > 0.0)
+    {
+        printf(" %9.2f GFLOP/s", flopsPerOp / result.nsPerOp);
+    }
+    if (bytesPerOp > 0.0)
+    {
+        printf(" %9.2f GB/s", bytesPerOp / result.nsPerOp);
+    }
+    if (samplesPerOp > 0)
+    {
+        printf(" %12.0f samples/s %10.1f ns/sample", samplesPerOp * 1e9 / result.nsPerOp, result.nsPerOp / samplesPerOp);
+    }
+    if (result.counterValid[Bench::CYCLES] && result.counterValid[Bench::INSTRUCTIONS] && result.counters[Bench::CYCLES] > 0.0)
+    {
+        printf(" %5.2f IPC", result.counters[Bench::INSTRUCTIONS] / result.counters[Bench::CYCLES]);
+    }
+    if (result.counterValid[Bench::CACHE_MISSES])
+    {
+        printf(" %10.1f misses", result.counters[Bench::CACHE_MISSES]);
+    }
+    printf("\n");
+}
+
+// Print the report as a table
+inline void Benchmark::print() const
+{
+    printf("\n%-10s %-22s %-18s %-6s %12s %12s %10s %14s %10s\n",
+           "Group", "Name", "Shape", "Type", "ns/op", "median", "GFLOP/s", "samples/s", "ns/sample");
+
+    for (const Bench::Result &result : results)
+    {
+        printf("%-10s %-22s %-18s %-6s %12.1f %12.1f %10.2f %14.0f %10.1f\n",
+               result.group.c_str(), result.name.c_str(), result.shape.c_str(), result.type.c_str(),
+               result.nsPerOp, result.medianNsPerOp,
+               result.flopsPerOp / result.nsPerOp,
+               result.samplesPerOp * 1e9 / result.nsPerOp,
+               result.samplesPerOp > 0 ? result.nsPerOp / result.samplesPerOp : 0.0);
+    }
+
+    if (!perf.isAvailable())
+    {
+        printf("Hardware counters unavailable\n");
+    }
+}
+
+// Write the report as JSON
+inline bool Benchmark::writeJson(const char* path, const char* simdLevel) const
+{
+    FILE* file = fopen(path, "w");
+
+    if (file == nullptr)
+    {
+#if _DEBUG
+        printf("Benchmark could not write %s\n", path);
+#endif
+        return false;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"simd\": \"%s\",\n", simdLevel);
+    fprintf(file, "  \"min_seconds\": %g,\n", minSeconds);
+    fprintf(file, "  \"repetitions\": %u,\n", (uint32_t)repetitions);
+    fprintf(file, "  \"counters_available\": %s,\n", perf.isAvailable() ? "true" : "false");
+    fprintf(file, "  \"results\": [\n");
+
+    for (size_t r = 0; r < results.size(); ++r)
+    {
+        const Bench::Result &result = results[r];
+
+        fprintf(file, "    {\"group\": \"%s\", \"name\": \"%s\", \"shape\": \"%s\", \"type\": \"%s\", ",
+                result.group.c_str(), result.name.c_str(), result.shape.c_str(), result.type.c_str());
+        fprintf(file, "\"iterations\": %llu, \"ns_per_op\": %.3f, \"median_ns_per_op\": %.3f, ",
+                (unsigned long long)result.iterations, result.nsPerOp, result.medianNsPerOp);
+        fprintf(file, "\"gflops\": %.4f, \"gbytes_per_sec\": %.4f, ",
+                result.flopsPerOp / result.nsPerOp, result.bytesPerOp / result.nsPerOp);
+
+        if (result.samplesPerOp > 0)
+        {
+            fprintf(file, "\"samples_per_sec\": %.1f, \"ns_per_sample\": %.3f, ",
+                    result.samplesPerOp * 1e9 / result.nsPerOp, result.nsPerOp / result.samplesPerOp);
+        }
+        else
+        {
+            fprintf(file, "\"samples_per_sec\": null, \"ns_per_sample\": null, ");
+        }
+
+        // Hardware counts per operation
+        fprintf(file, "\"counters\": {");
+        for (uint8_t i = 0; i < Bench::NUM_COUNTERS; ++i)
+        {
+            fprintf(file, "%s\"%s\": ", i > 0 ? ", " : "", Bench::COUNTER_NAMES[i]);
+
+            if (result.counterValid[i])
+            {
+                fprintf(file, "%.1f", result.counters[i]);
+            }
+            else
+            {
+                fprintf(file, "null");
+            }
+        }
+        fprintf(file, "}}%s\n", (r + 1 < results.size()) ? "," : "");
+    }
+
+    fprintf(file, "  ]\n");
+    fprintf(file, "}\n");
+
+    return fclose(file) == 0;
+}
+
+#endif
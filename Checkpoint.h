@@ -0,0 +1,492 @@
+//-----------------------------------------------------------------------------
+// File: Checkpoint.h
+// Author: Edward Koch
+// Description: Holds the declaration of the CheckpointFile Class
+//              Versioned binary checkpoints of a Neural Net's Weights and Bias
+//              A checkpoint can be copied into a Neural Net, or memory mapped
+//              and used in place so a serving process starts without reading
+//              or converting the weights
+//
+// Checkpoint Layout (native byte order)
+//   Header                 128 bytes - magic, version, dims, dtype, step, checksum
+//   Input Weights          numHidden x numInputs, row-major
+//   Input Bias             numHidden
+//   Hidden Weights         numOutputs x numHidden, row-major
+//   Hidden Bias            numOutputs
+// Every blob starts on a BLOB_ALIGNMENT boundary and is zero padded to one,
+// so a mapped blob can be used directly as Matrix storage
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Snapshots, Atomic Writes and Training Step
+//-----------------------------------------------------------------------------
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "MappedFile.h"
+#include "Matrix.h"
+#include "NeuralNet.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <string.h>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Checkpoint
+{
+    // "NNCK" read as a native 32 bit value - a checkpoint written with the
+    // other byte order fails this check
+    const uint32_t MAGIC = ((uint32_t)'K' << 24) | ((uint32_t)'C' << 16) | ((uint32_t)'N' << 8) | (uint32_t)'N';
+
+    // Format version - bumped whenever the layout changes
+    // 2 - training step added, header grown to 128 bytes
+    const uint16_t VERSION = 2;
+
+    // Alignment of every blob - a whole Matrix storage alignment
+    const uint64_t BLOB_ALIGNMENT = MATRIX_ALIGNMENT;
+
+    // Input Weights, Input Bias, Hidden Weights and Hidden Bias
+    const uint8_t NUM_BLOBS = 4;
+
+    // Element type of the blobs
+    enum class DType : uint8_t
+    {
+        FLOAT32 = 1,
+        FLOAT64 = 2
+    };
+
+    template<typename T>
+    constexpr DType dtypeOf()
+    {
+        return (sizeof(T) == 4) ? DType::FLOAT32 : DType::FLOAT64;
+    }
+
+    // Size of one element of a blob, or 0 for an unknown type
+    inline uint64_t dtypeSize(uint8_t dtype)
+    {
+        return (dtype == (uint8_t)DType::FLOAT32) ? 4 :
+               (dtype == (uint8_t)DType::FLOAT64) ? 8 : 0;
+    }
+
+    // Round a size up to a whole number of blob alignments
+    constexpr uint64_t alignUp(uint64_t size)
+    {
+        return ((size + BLOB_ALIGNMENT - 1) / BLOB_ALIGNMENT) * BLOB_ALIGNMENT;
+    }
+
+    // Fixed size header at the start of every checkpoint
+    struct Header
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint8_t dtype;
+        uint8_t activation;
+
+        uint16_t numInputs;
+        uint16_t numHidden;
+        uint16_t numOutputs;
+        uint16_t reserved;
+
+        double learningRate;
+
+        // Checksum of every byte after the header
+        uint64_t checksum;
+
+        // Offset of each blob from the start of the file
+        uint64_t blobOffsets[NUM_BLOBS];
+
+        // Number of batches trained when the checkpoint was taken
+        uint64_t step;
+
+        // Zero - room for later versions
+        uint8_t padding[56];
+    };
+
+    static_assert(sizeof(Header) % BLOB_ALIGNMENT == 0, "The header must fill whole blob alignments");
+
+    // Number of elements in each blob
+    inline void blobLengths(uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint64_t(&lengths)[NUM_BLOBS])
+    {
+        lengths[0] = (uint64_t)numHidden * numInputs;
+        lengths[1] = numHidden;
+        lengths[2] = (uint64_t)numOutputs * numHidden;
+        lengths[3] = numOutputs;
+    }
+
+    // FNV-1a over 64 bit words - size must be a multiple of 8
+    inline uint64_t checksum(const uint8_t* bytes, uint64_t size)
+    {
+        uint64_t hash = 0xCBF29CE484222325ull;
+
+        for (uint64_t i = 0; i + 8 <= size; i += 8)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i, 8);
+
+            hash ^= word;
+            hash *= 0x100000001B3ull;
+        }
+
+        return hash;
+    }
+};
+
+class CheckpointFile
+{
+public:
+    // Constructor - nothing open
+    CheckpointFile();
+
+    // Write the Weights and Bias of a Neural Net to a checkpoint, trained for step batches
+    // Returns false if the file cannot be written
+    template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+    static bool save(const char* path, const NeuralNet<numInputs, numHidden, numOutputs, T> &net, uint64_t step = 0);
+
+    // Copy the Weights and Bias of a Neural Net into the bytes of a checkpoint
+    // The checksum is left for write(), so the copy is all the caller pays for
+    template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+    static void snapshot(const NeuralNet<numInputs, numHidden, numOutputs, T> &net, uint64_t step, std::vector<uint8_t> &bytes);
+
+    // Checksum a snapshot and replace the file at path with it atomically
+    // The bytes go to path.tmp, are flushed to disk and then renamed over path,
+    // so a crash leaves either the old or the new checkpoint, never a torn one
+    // Returns false if the file cannot be written
+    static bool write(const char* path, std::vector<uint8_t> &bytes);
+
+    // Map a checkpoint and validate its header - and its checksum if verify is set
+    // Returns false if the file is missing, truncated, corrupt or another version
+    bool open(const char* path, bool verify = true);
+
+    // Unmap the checkpoint - every Neural Net attached to it must stop using it
+    void close();
+
+    // Check if a valid checkpoint is open
+    bool isOpen() const { return file.isOpen(); }
+
+    // Get the header of the open checkpoint
+    const Checkpoint::Header& getHeader() const { return header; }
+
+    // Copy the checkpoint into a Neural Net's own Weights and Bias
+    // Returns false if the shape, type or activation does not match
+    template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+    bool load(NeuralNet<numInputs, numHidden, numOutputs, T> &net) const;
+
+    // Use the mapped Weights and Bias in place - nothing is read until it is
+    // touched, and training writes private copies of pages, never the file
+    // The checkpoint must stay open for as long as the Neural Net uses them
+    // Returns false if the shape, type or activation does not match
+    template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+    bool attach(NeuralNet<numInputs, numHidden, numOutputs, T> &net);
+
+private:
+    CheckpointFile(const CheckpointFile &other) = delete;
+    CheckpointFile& operator=(const CheckpointFile &other) = delete;
+
+    // Check the open checkpoint was saved from a Neural Net of this shape
+    template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+    bool matches(const NeuralNet<numInputs, numHidden, numOutputs, T> &net) const;
+
+    MappedFile file;
+    Checkpoint::Header header;
+};
+
+// Constructor - nothing open
+inline CheckpointFile::CheckpointFile()
+    : header()
+{
+
+}
+
+// Write the Weights and Bias of a Neural Net to a checkpoint, trained for step batches
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool CheckpointFile::save(const char* path, const NeuralNet<numInputs, numHidden, numOutputs, T> &net, uint64_t step)
+{
+    std::vector<uint8_t> bytes;
+
+    snapshot(net, step, bytes);
+
+    return write(path, bytes);
+}
+
+// Copy the Weights and Bias of a Neural Net into the bytes of a checkpoint
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void CheckpointFile::snapshot(const NeuralNet<numInputs, numHidden, numOutputs, T> &net, uint64_t step, std::vector<uint8_t> &bytes)
+{
+    const T* blobs[Checkpoint::NUM_BLOBS] = { net.getInputWeights().getData(), net.getInputBias().getData(),
+                                              net.getHiddenWeights().getData(), net.getHiddenBias().getData() };
+
+    uint64_t lengths[Checkpoint::NUM_BLOBS];
+    Checkpoint::blobLengths(numInputs, numHidden, numOutputs, lengths);
+
+    Checkpoint::Header fileHeader = {};
+    fileHeader.magic = Checkpoint::MAGIC;
+    fileHeader.version = Checkpoint::VERSION;
+    fileHeader.dtype = (uint8_t)Checkpoint::dtypeOf<T>();
+    fileHeader.activation = (uint8_t)net.getActivation();
+    fileHeader.numInputs = numInputs;
+    fileHeader.numHidden = numHidden;
+    fileHeader.numOutputs = numOutputs;
+    fileHeader.learningRate = (double)net.getLearningRate();
+    fileHeader.step = step;
+
+    // Lay the blobs out one after another on aligned offsets
+    uint64_t size = sizeof(Checkpoint::Header);
+
+    for (uint8_t blob = 0; blob < Checkpoint::NUM_BLOBS; ++blob)
+    {
+        fileHeader.blobOffsets[blob] = size;
+        size += Checkpoint::alignUp(lengths[blob] * sizeof(T));
+    }
+
+    // Build the whole file so the checksum is taken over exactly what is written
+    // A reused buffer of the right size only has its blobs overwritten - the
+    // padding is already zero
+    if (bytes.size() != size)
+    {
+        bytes.assign((size_t)size, 0);
+    }
+
+    for (uint8_t blob = 0; blob < Checkpoint::NUM_BLOBS; ++blob)
+    {
+        memcpy(&bytes[(size_t)fileHeader.blobOffsets[blob]], blobs[blob], (size_t)(lengths[blob] * sizeof(T)));
+    }
+
+    memcpy(bytes.data(), &fileHeader, sizeof(Checkpoint::Header));
+}
+
+// Checksum a snapshot and replace the file at path with it atomically
+inline bool CheckpointFile::write(const char* path, std::vector<uint8_t> &bytes)
+{
+    if (bytes.size() < sizeof(Checkpoint::Header))
+    {
+#if _DEBUG
+        printf("CheckpointFile - Write: Snapshot of %s is empty\n", path);
+#endif
+        return false;
+    }
+
+    Checkpoint::Header fileHeader;
+    memcpy(&fileHeader, bytes.data(), sizeof(Checkpoint::Header));
+    fileHeader.checksum = Checkpoint::checksum(bytes.data() + sizeof(Checkpoint::Header), bytes.size() - sizeof(Checkpoint::Header));
+    memcpy(bytes.data(), &fileHeader, sizeof(Checkpoint::Header));
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    bool written = true;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(tmpPath.c_str(), GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        written = false;
+    }
+    else
+    {
+        for (uint64_t offset = 0; written && offset < bytes.size(); )
+        {
+            DWORD chunk = (bytes.size() - offset > 0x40000000) ? 0x40000000 : (DWORD)(bytes.size() - offset);
+            DWORD numWritten = 0;
+
+            written = WriteFile(file, bytes.data() + offset, chunk, &numWritten, NULL) && numWritten > 0;
+            offset += numWritten;
+        }
+
+        // Flush to disk before the rename makes the file visible
+        written = FlushFileBuffers(file) && written;
+        CloseHandle(file);
+
+        // A checkpoint still mapped by this process cannot be replaced on Windows
+        written = written && MoveFileExA(tmpPath.c_str(), path, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    }
+#else
+    int file = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (file < 0)
+    {
+        written = false;
+    }
+    else
+    {
+        for (uint64_t offset = 0; written && offset < bytes.size(); )
+        {
+            ssize_t numWritten = ::write(file, bytes.data() + offset, (size_t)(bytes.size() - offset));
+
+            written = numWritten > 0;
+            offset += (numWritten > 0) ? (uint64_t)numWritten : 0;
+        }
+
+        // Flush to disk before the rename makes the file visible
+        written = (fsync(file) == 0) && written;
+        written = (::close(file) == 0) && written;
+
+        written = written && rename(tmpPath.c_str(), path) == 0;
+
+        // Flush the directory so the rename itself survives a crash
+        std::string directory(path);
+        size_t slash = directory.find_last_of('/');
+        directory = (slash == std::string::npos) ? std::string(".") : directory.substr(0, slash + 1);
+
+        int dir = ::open(directory.c_str(), O_RDONLY);
+        if (dir >= 0)
+        {
+            fsync(dir);
+            ::close(dir);
+        }
+    }
+#endif
+
+    if (!written)
+    {
+#if _DEBUG
+        printf("CheckpointFile - Write: Unable to write %s\n", path);
+#endif
+        remove(tmpPath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Map a checkpoint and validate its header - and its checksum if verify is set
+inline bool CheckpointFile::open(const char* path, bool verify)
+{
+    close();
+
+    // Copy-on-write so attached Neural Nets can keep training
+    if (!file.open(path, true))
+    {
+#if _DEBUG
+        printf("CheckpointFile - Open: Unable to map %s\n", path);
+#endif
+        return false;
+    }
+
+    if (file.getSize() < sizeof(Checkpoint::Header))
+    {
+#if _DEBUG
+        printf("CheckpointFile - Open: %s is too small to be a checkpoint\n", path);
+#endif
+        close();
+        return false;
+    }
+
+    memcpy(&header, file.getData(), sizeof(Checkpoint::Header));
+
+    uint64_t elementSize = Checkpoint::dtypeSize(header.dtype);
+
+    if (header.magic != Checkpoint::MAGIC || header.version != Checkpoint::VERSION || elementSize == 0)
+    {
+#if _DEBUG
+        printf("CheckpointFile - Open: %s is not a version %u checkpoint\n", path, Checkpoint::VERSION);
+#endif
+        close();
+        return false;
+    }
+
+    // Every blob must be aligned and lie inside the file
+    uint64_t lengths[Checkpoint::NUM_BLOBS];
+    Checkpoint::blobLengths(header.numInputs, header.numHidden, header.numOutputs, lengths);
+
+    for (uint8_t blob = 0; blob < Checkpoint::NUM_BLOBS; ++blob)
+    {
+        uint64_t offset = header.blobOffsets[blob];
+
+        if (offset % Checkpoint::BLOB_ALIGNMENT != 0 || offset < sizeof(Checkpoint::Header) ||
+            offset > file.getSize() || file.getSize() - offset < lengths[blob] * elementSize)
+        {
+#if _DEBUG
+            printf("CheckpointFile - Open: %s is truncated\n", path);
+#endif
+            close();
+            return false;
+        }
+    }
+
+    if (verify && Checkpoint::checksum(file.getData() + sizeof(Checkpoint::Header), file.getSize() - sizeof(Checkpoint::Header)) != header.checksum)
+    {
+#if _DEBUG
+        printf("CheckpointFile - Open: %s failed its checksum\n", path);
+#endif
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+// Unmap the checkpoint - every Neural Net attached to it must stop using it
+inline void CheckpointFile::close()
+{
+    file.close();
+    header = Checkpoint::Header();
+}
+
+// Copy the checkpoint into a Neural Net's own Weights and Bias
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool CheckpointFile::load(NeuralNet<numInputs, numHidden, numOutputs, T> &net) const
+{
+    if (!matches(net))
+    {
+        return false;
+    }
+
+    const uint8_t* data = file.getData();
+
+    net.setWeights((const T*)(data + header.blobOffsets[0]), (const T*)(data + header.blobOffsets[1]),
+                   (const T*)(data + header.blobOffsets[2]), (const T*)(data + header.blobOffsets[3]));
+    net.setLearningRate((T)header.learningRate);
+
+    return true;
+}
+
+// Use the mapped Weights and Bias in place
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool CheckpointFile::attach(NeuralNet<numInputs, numHidden, numOutputs, T> &net)
+{
+    if (!matches(net))
+    {
+        return false;
+    }
+
+    uint8_t* data = file.getWritableData();
+
+    net.attachWeights((T*)(data + header.blobOffsets[0]), (T*)(data + header.blobOffsets[1]),
+                      (T*)(data + header.blobOffsets[2]), (T*)(data + header.blobOffsets[3]));
+    net.setLearningRate((T)header.learningRate);
+
+    return true;
+}
+
+// Check the open checkpoint was saved from a Neural Net of this shape
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline bool CheckpointFile::matches(const NeuralNet<numInputs, numHidden, numOutputs, T> &net) const
+{
+    if (!isOpen())
+    {
+#if _DEBUG
+        printf("CheckpointFile - Matches: No checkpoint is open\n");
+#endif
+        return false;
+    }
+
+    if (header.numInputs != numInputs || header.numHidden != numHidden || header.numOutputs != numOutputs ||
+        header.dtype != (uint8_t)Checkpoint::dtypeOf<T>() || header.activation != (uint8_t)net.getActivation())
+    {
+#if _DEBUG
+        printf("CheckpointFile - Matches: Checkpoint is %u-%u-%u (dtype %u, activation %u), not %u-%u-%u (dtype %u, activation %u)\n",
+               header.numInputs, header.numHidden, header.numOutputs, header.dtype, header.activation,
+               numInputs, numHidden, numOutputs, (uint8_t)Checkpoint::dtypeOf<T>(), (uint8_t)net.getActivation());
+#endif
+        return false;
+    }
+
+    return true;
+}
+
+#endif
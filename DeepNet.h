@@ -0,0 +1,626 @@
+//-----------------------------------------------------------------------------
+// File: DeepNet.h
+// Author: Edward Koch
+// Description: Holds the declaration of the DeepNet Class
+//              A Neural Net of any depth - the layer sizes are a template
+//              parameter pack, e.g. DeepNet<float, 784, 128, 64, 10>, and the
+//              feed forward and back propagation of every layer is generated
+//              at compile time by recursing over the pack
+//
+//              The weights, and every workspace, each live in one LinearArena
+//              sized exactly at compile time, so the matrices of a network sit
+//              side by side in memory and training never allocates
+//
+//              Each layer's delta - its activation derivative times its error -
+//              is back propagated through its weights to the layer before it,
+//              and the learning rate only scales the adjustments. With a unit
+//              output derivative (SOFTMAX) DeepNet<T, in, hidden, out> trains
+//              like NeuralNet<in, hidden, out, T>, which back propagates the
+//              raw output error
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Back Propagation without Transposed Copies
+// E. Koch    10/17/26    Pluggable Optimizers
+// E. Koch    10/17/26    Back Propagate Deltas
+//-----------------------------------------------------------------------------
+#ifndef DEEP_NET_H
+#define DEEP_NET_H
+
+#include "Matrix.h"
+#include "MatrixStorage.h"
+#include "NeuralNet.h"
+#include "Optimizer.h"
+
+#include <math.h>
+#include <random>
+#include <stdint.h>
+#include <type_traits>
+
+namespace Layers
+{
+    // Size of the first layer of a pack
+    template<uint16_t first, uint16_t... rest>
+    struct First
+    {
+        static const uint16_t value = first;
+    };
+
+    // Weights and Bias of a layer and of every layer after it
+    // numInputs is the size of the previous layer, numOutputs the size of this one
+    template<typename T, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    struct Weights
+    {
+        typedef Weights<T, numOutputs, rest...> Next;
+
+        static const uint16_t NET_OUTPUTS = Next::NET_OUTPUTS;
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, numInputs) +
+                                          Storage::matrixBytes<T>(numOutputs, 1) + Next::BYTES;
+
+        Matrix<numOutputs, numInputs, T> weights;
+        Matrix<numOutputs, 1, T> bias;
+
+        Next next;
+    };
+
+    // Output Layer
+    template<typename T, uint16_t numInputs, uint16_t numOutputs>
+    struct Weights<T, numInputs, numOutputs>
+    {
+        static const uint16_t NET_OUTPUTS = numOutputs;
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, numInputs) +
+                                          Storage::matrixBytes<T>(numOutputs, 1);
+
+        Matrix<numOutputs, numInputs, T> weights;
+        Matrix<numOutputs, 1, T> bias;
+    };
+
+    // Optimizer moments of a layer and of every layer after it - empty until used
+    template<typename T, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    struct State
+    {
+        typedef State<T, numOutputs, rest...> Next;
+
+        // Reset to the state of a new optimizer
+        void clear() { weights.clear(); bias.clear(); next.clear(); }
+
+        Moments<numOutputs, numInputs, T> weights;
+        Moments<numOutputs, 1, T> bias;
+
+        Next next;
+    };
+
+    // Output Layer
+    template<typename T, uint16_t numInputs, uint16_t numOutputs>
+    struct State<T, numInputs, numOutputs>
+    {
+        // Reset to the state of a new optimizer
+        void clear() { weights.clear(); bias.clear(); }
+
+        Moments<numOutputs, numInputs, T> weights;
+        Moments<numOutputs, 1, T> bias;
+    };
+
+    // Activations of a layer and of every layer after it - one sample per column
+    template<typename T, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    struct Values
+    {
+        typedef Values<T, batchSize, numOutputs, rest...> Next;
+
+        static const uint16_t NET_OUTPUTS = Next::NET_OUTPUTS;
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, batchSize) + Next::BYTES;
+
+        // Activations of the Output Layer
+        Matrix<NET_OUTPUTS, batchSize, T>& getOutputs() { return next.getOutputs(); }
+        const Matrix<NET_OUTPUTS, batchSize, T>& getOutputs() const { return next.getOutputs(); }
+
+        Matrix<numOutputs, batchSize, T> values;
+
+        Next next;
+    };
+
+    // Output Layer
+    template<typename T, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs>
+    struct Values<T, batchSize, numInputs, numOutputs>
+    {
+        static const uint16_t NET_OUTPUTS = numOutputs;
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, batchSize);
+
+        // Activations of the Output Layer
+        Matrix<NET_OUTPUTS, batchSize, T>& getOutputs() { return values; }
+        const Matrix<NET_OUTPUTS, batchSize, T>& getOutputs() const { return values; }
+
+        Matrix<numOutputs, batchSize, T> values;
+    };
+
+    // Back Propagation scratch of a layer and of every layer after it
+    template<typename T, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    struct Gradients
+    {
+        typedef Gradients<T, batchSize, numOutputs, rest...> Next;
+
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, batchSize) * 2 +
+                                          Storage::matrixBytes<T>(First<rest...>::value, batchSize) +
+                                          Storage::matrixBytes<T>(numOutputs, numInputs) +
+                                          Storage::matrixBytes<T>(numOutputs, 1) + Next::BYTES;
+
+        Matrix<numOutputs, batchSize, T> error;
+        Matrix<numOutputs, batchSize, T> gradient;
+
+        // Derivative * Error of the next layer without the learning rate - what
+        // is back propagated through the next layer's Weights to this one
+        Matrix<First<rest...>::value, batchSize, T> nextDelta;
+
+        // Adjustments accumulated over every sample in the batch
+        Matrix<numOutputs, numInputs, T> weightsAdjustment;
+        Matrix<numOutputs, 1, T> biasAdjustment;
+
+        Next next;
+    };
+
+    // Output Layer
+    template<typename T, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs>
+    struct Gradients<T, batchSize, numInputs, numOutputs>
+    {
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(numOutputs, batchSize) * 2 +
+                                          Storage::matrixBytes<T>(numOutputs, numInputs) +
+                                          Storage::matrixBytes<T>(numOutputs, 1);
+
+        Matrix<numOutputs, batchSize, T> error;
+        Matrix<numOutputs, batchSize, T> gradient;
+
+        // Adjustments accumulated over every sample in the batch
+        Matrix<numOutputs, numInputs, T> weightsAdjustment;
+        Matrix<numOutputs, 1, T> biasAdjustment;
+    };
+
+};
+
+template <typename T, uint16_t... layerSizes>
+class DeepNet
+{
+    static_assert(sizeof...(layerSizes) >= 2, "DeepNet needs at least an input and an output layer");
+
+public:
+    typedef Layers::Weights<T, layerSizes...> LayerWeights;
+    typedef Layers::State<T, layerSizes...> LayerState;
+
+    static const uint16_t NUM_INPUTS = Layers::First<layerSizes...>::value;
+    static const uint16_t NUM_OUTPUTS = LayerWeights::NET_OUTPUTS;
+
+    // Number of weight layers - one less than the number of layer sizes
+    static const uint16_t NUM_LAYERS = sizeof...(layerSizes) - 1;
+
+    // Inference Workspace - each input is packed as one column so a batch
+    // is pushed through every layer as a single matrix-matrix product
+    // Every matrix is carved out of the workspace's own arena
+    template<uint16_t batchSize>
+    class GuessBatch
+    {
+    public:
+        GuessBatch();
+
+        // Pack an input into a column of the batch
+        void setInputs(uint16_t col, const T(&inputs)[NUM_INPUTS]);
+
+        // Read the guessed outputs from a column of the batch
+        void getOutputs(uint16_t col, T(&outputs)[NUM_OUTPUTS]) const;
+
+        // Get the number of bytes reserved for the workspace
+        uint64_t getBytes() const { return arena.getCapacity(); }
+
+    private:
+        friend class DeepNet;
+
+        GuessBatch(const GuessBatch &other) = delete;
+        GuessBatch& operator=(const GuessBatch &other) = delete;
+
+        struct Contents
+        {
+            Matrix<NUM_INPUTS, batchSize, T> inputValues;
+            Layers::Values<T, batchSize, layerSizes...> values;
+        };
+
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(NUM_INPUTS, batchSize) +
+                                          Layers::Values<T, batchSize, layerSizes...>::BYTES;
+
+        // Declared first so it outlives the matrices carved from it
+        Storage::LinearArena arena;
+        Contents contents;
+    };
+
+    // Single Input Inference Workspace - one per thread sharing the Neural Net
+    typedef GuessBatch<1> Workspace;
+
+    // Mini-batch Workspace - each sample is packed as one column so a batch
+    // is pushed through every layer as a single matrix-matrix product
+    // Every matrix is carved out of the workspace's own arena
+    template<uint16_t batchSize>
+    class Batch
+    {
+    public:
+        Batch();
+
+        // Pack an input and expected answer into a column of the batch
+        void setSample(uint16_t col, const T(&inputs)[NUM_INPUTS], const T(&answers)[NUM_OUTPUTS]);
+
+        // Get the number of bytes reserved for the workspace
+        uint64_t getBytes() const { return arena.getCapacity(); }
+
+    private:
+        friend class DeepNet;
+
+        Batch(const Batch &other) = delete;
+        Batch& operator=(const Batch &other) = delete;
+
+        struct Contents
+        {
+            Matrix<NUM_INPUTS, batchSize, T> inputValues;
+            Matrix<NUM_OUTPUTS, batchSize, T> answerValues;
+            Layers::Values<T, batchSize, layerSizes...> values;
+            Layers::Gradients<T, batchSize, layerSizes...> gradients;
+        };
+
+        static constexpr uint64_t BYTES = Storage::matrixBytes<T>(NUM_INPUTS, batchSize) +
+                                          Storage::matrixBytes<T>(NUM_OUTPUTS, batchSize) +
+                                          Layers::Values<T, batchSize, layerSizes...>::BYTES +
+                                          Layers::Gradients<T, batchSize, layerSizes...>::BYTES;
+
+        // Declared first so it outlives the matrices carved from it
+        Storage::LinearArena arena;
+        Contents contents;
+    };
+
+    DeepNet(std::mt19937 rngIn,
+            NN::Activations activation = NN::Activations::SIGMOID,
+            T learningRate = 0.001);
+
+    // Set the Learning Rate
+    void setLearningRate(T lr) { learningRate = lr; }
+
+    // Get the Learning Rate
+    T getLearningRate() const { return learningRate; }
+
+    // Set how the adjustments are applied to the Weights - clears any running moments
+    void setOptimizer(const typename Optimizer<T>::Settings &settings);
+
+    // Get how the adjustments are applied to the Weights
+    const Optimizer<T>& getOptimizer() const { return optimizer; }
+
+    // Get the Activation Function
+    NN::Activations getActivation() const { return activation; }
+
+    // Get the Weights and Bias of a layer - 0 is fed by the inputs
+    template<uint16_t layer>
+    const auto& getLayer() const { return layerOf<layer>(layers); }
+
+    // Get the number of bytes reserved for the Weights and Bias
+    uint64_t getWeightBytes() const { return arena.getCapacity(); }
+
+    // Randomize the Weights
+    void randomize(T min, T max);
+
+    // Generate an output array based on an input array
+    void guess(const T(&inputs)[NUM_INPUTS], T(&outputs)[NUM_OUTPUTS]);
+
+    // Generate an output array based on an input array - activations are kept
+    // in the given workspace so threads can share one set of weights
+    void guess(const T(&inputs)[NUM_INPUTS], T(&outputs)[NUM_OUTPUTS], Workspace &workspace) const;
+
+    // Feed every input packed into the batch forward together
+    template<uint16_t batchSize>
+    void guessBatch(GuessBatch<batchSize> &batch) const;
+
+    // Train the Neural net on one sample
+    void train(const T(&inputs)[NUM_INPUTS], const T(&answers)[NUM_OUTPUTS]);
+
+    // Train the Neural net on a packed mini-batch in one update
+    // The adjustments are summed over the batch, so one batch update matches the
+    // size of batchSize single-sample updates at the same learning rate
+    template<uint16_t batchSize>
+    void trainBatch(Batch<batchSize> &batch);
+
+private:
+    DeepNet(const DeepNet &other) = delete;
+    DeepNet& operator=(const DeepNet &other) = delete;
+
+    // Find the Weights of a layer
+    template<uint16_t layer, typename Node>
+    static auto& layerOf(Node &node);
+
+    // Randomize the Weights of a layer and every layer after it
+    template<uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    void randomize(Layers::Weights<T, numInputs, numOutputs, rest...> &layer, T min, T max);
+
+    // Calculate the activations of a layer and every layer after it
+    template<typename Hidden, typename Output, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    static void feedForward(const Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                            const Matrix<numInputs, batchSize, T> &inputs,
+                            Layers::Values<T, batchSize, numInputs, numOutputs, rest...> &values);
+
+    // Calculate the adjustments of a layer and every layer after it
+    // The later layers go first - their error is back propagated to this one
+    template<typename Hidden, typename Output, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    void backPropagate(const Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                       const Matrix<numInputs, batchSize, T> &inputs,
+                       const Layers::Values<T, batchSize, numInputs, numOutputs, rest...> &values,
+                       const Matrix<NUM_OUTPUTS, batchSize, T> &answers,
+                       Layers::Gradients<T, batchSize, numInputs, numOutputs, rest...> &gradients) const;
+
+    // Apply the adjustments of a layer and every layer after it
+    template<uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+    void applyAdjustments(Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                          Layers::State<T, numInputs, numOutputs, rest...> &layerState,
+                          const Layers::Gradients<T, batchSize, numInputs, numOutputs, rest...> &gradients) const;
+
+    // Get the scale of the adjustments - the optimizer applies the learning
+    // rate itself when it keeps moments
+    T getStepScale() const { return optimizer.usesMoments() ? (T)1.0 : learningRate; }
+
+    // Random Number Generator
+    std::mt19937 rng;
+
+    // Activation Function to use
+    NN::Activations activation;
+
+    // Learning Rate
+    T learningRate;
+
+    // Weight Update Rule
+    Optimizer<T> optimizer;
+
+    // Weights and Bias of every layer - declared after the arena they are carved from
+    Storage::LinearArena arena;
+    LayerWeights layers;
+
+    // Running moments of every Weight and Bias - allocated by the optimizer on first use
+    LayerState state;
+
+    // Workspaces for guess and train
+    Workspace guessScratch;
+    Batch<1> trainScratch;
+};
+
+// Constructor - carves every layer out of the arena
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline DeepNet<T, layerSizes...>::GuessBatch<batchSize>::GuessBatch()
+    : arena(BYTES),
+      contents(Storage::constructIn<Contents>(arena))
+{
+
+}
+
+// Pack an input into a column of the batch
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline void DeepNet<T, layerSizes...>::GuessBatch<batchSize>::setInputs(uint16_t col, const T(&inputs)[NUM_INPUTS])
+{
+    contents.inputValues.setColumn(col, inputs);
+}
+
+// Read the guessed outputs from a column of the batch
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline void DeepNet<T, layerSizes...>::GuessBatch<batchSize>::getOutputs(uint16_t col, T(&outputs)[NUM_OUTPUTS]) const
+{
+    contents.values.getOutputs().getColumn(col, outputs);
+}
+
+// Constructor - carves every layer out of the arena
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline DeepNet<T, layerSizes...>::Batch<batchSize>::Batch()
+    : arena(BYTES),
+      contents(Storage::constructIn<Contents>(arena))
+{
+
+}
+
+// Pack an input and expected answer into a column of the batch
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline void DeepNet<T, layerSizes...>::Batch<batchSize>::setSample(uint16_t col, const T(&inputs)[NUM_INPUTS], const T(&answers)[NUM_OUTPUTS])
+{
+    contents.inputValues.setColumn(col, inputs);
+    contents.answerValues.setColumn(col, answers);
+}
+
+// Constructor - every Weight and Bias starts at 0
+template <typename T, uint16_t... layerSizes>
+inline DeepNet<T, layerSizes...>::DeepNet(std::mt19937 rngIn, NN::Activations activation, T learningRate)
+    : rng(rngIn),
+      activation(activation),
+      learningRate(learningRate),
+      arena(LayerWeights::BYTES),
+      layers(Storage::constructIn<LayerWeights>(arena))
+{
+
+}
+
+// Set how the adjustments are applied to the Weights - clears any running moments
+template <typename T, uint16_t... layerSizes>
+inline void DeepNet<T, layerSizes...>::setOptimizer(const typename Optimizer<T>::Settings &settings)
+{
+    optimizer.setSettings(settings);
+    state.clear();
+}
+
+// Randomize the Weights
+template <typename T, uint16_t... layerSizes>
+inline void DeepNet<T, layerSizes...>::randomize(T min, T max)
+{
+    randomize(layers, min, max);
+}
+
+// Generate an output array based on an input array
+template <typename T, uint16_t... layerSizes>
+inline void DeepNet<T, layerSizes...>::guess(const T(&inputs)[NUM_INPUTS], T(&outputs)[NUM_OUTPUTS])
+{
+    guess(inputs, outputs, guessScratch);
+}
+
+// Generate an output array based on an input array using the given workspace
+template <typename T, uint16_t... layerSizes>
+inline void DeepNet<T, layerSizes...>::guess(const T(&inputs)[NUM_INPUTS], T(&outputs)[NUM_OUTPUTS], Workspace &workspace) const
+{
+    workspace.setInputs(0, inputs);
+    guessBatch(workspace);
+    workspace.getOutputs(0, outputs);
+}
+
+// Feed every input packed into the batch forward together
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline void DeepNet<T, layerSizes...>::guessBatch(GuessBatch<batchSize> &batch) const
+{
+    NN::withActivation<T>(activation, [&](auto hiddenActivation, auto outputActivation)
+    {
+        feedForward<decltype(hiddenActivation), decltype(outputActivation)>(layers, batch.contents.inputValues, batch.contents.values);
+    });
+}
+
+// Train the Neural net on one sample
+template <typename T, uint16_t... layerSizes>
+inline void DeepNet<T, layerSizes...>::train(const T(&inputs)[NUM_INPUTS], const T(&answers)[NUM_OUTPUTS])
+{
+    trainScratch.setSample(0, inputs, answers);
+    trainBatch(trainScratch);
+}
+
+// Train the Neural net on a packed mini-batch in one update
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize>
+inline void DeepNet<T, layerSizes...>::trainBatch(Batch<batchSize> &batch)
+{
+    typename Batch<batchSize>::Contents &contents = batch.contents;
+
+    NN::withActivation<T>(activation, [&](auto hiddenActivation, auto outputActivation)
+    {
+        typedef decltype(hiddenActivation) Hidden;
+        typedef decltype(outputActivation) Output;
+
+        // Feed every sample forward at once
+        feedForward<Hidden, Output>(layers, contents.inputValues, contents.values);
+
+        // Calculate every adjustment from the current weights
+        backPropagate<Hidden, Output>(layers, contents.inputValues, contents.values, contents.answerValues, contents.gradients);
+    });
+
+    // Apply the accumulated adjustments
+    optimizer.beginStep(learningRate);
+    applyAdjustments(layers, state, contents.gradients);
+}
+
+// Find the Weights of a layer
+template <typename T, uint16_t... layerSizes>
+template <uint16_t layer, typename Node>
+inline auto& DeepNet<T, layerSizes...>::layerOf(Node &node)
+{
+    if constexpr (layer == 0)
+    {
+        return node;
+    }
+    else
+    {
+        return layerOf<layer - 1>(node.next);
+    }
+}
+
+// Randomize the Weights of a layer and every layer after it
+template <typename T, uint16_t... layerSizes>
+template <uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+inline void DeepNet<T, layerSizes...>::randomize(Layers::Weights<T, numInputs, numOutputs, rest...> &layer, T min, T max)
+{
+    layer.weights.randomize(rng, min, max);
+    layer.bias.randomize(rng, min, max);
+
+    if constexpr (sizeof...(rest) > 0)
+    {
+        randomize(layer.next, min, max);
+    }
+}
+
+// Calculate the activations of a layer and every layer after it
+template <typename T, uint16_t... layerSizes>
+template <typename Hidden, typename Output, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+inline void DeepNet<T, layerSizes...>::feedForward(const Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                                                   const Matrix<numInputs, batchSize, T> &inputs,
+                                                   Layers::Values<T, batchSize, numInputs, numOutputs, rest...> &values)
+{
+    if constexpr (sizeof...(rest) > 0)
+    {
+        // Values = act(Weights * Inputs + Bias)
+        layer.weights.multiply(inputs, values.values, Kernels::BiasActivation<T, Hidden>{ layer.bias.getData() });
+
+        feedForward<Hidden, Output>(layer.next, values.values, values.next);
+    }
+    else
+    {
+        // Outputs = act(Weights * Inputs + Bias)
+        layer.weights.multiply(inputs, values.values, Kernels::BiasActivation<T, Output>{ layer.bias.getData() });
+
+        if (Output::NORMALIZE_COLUMNS)
+        {
+            values.values.softmaxColumns();
+        }
+    }
+}
+
+// Calculate the adjustments of a layer and every layer after it
+template <typename T, uint16_t... layerSizes>
+template <typename Hidden, typename Output, uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+inline void DeepNet<T, layerSizes...>::backPropagate(const Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                                                     const Matrix<numInputs, batchSize, T> &inputs,
+                                                     const Layers::Values<T, batchSize, numInputs, numOutputs, rest...> &values,
+                                                     const Matrix<NUM_OUTPUTS, batchSize, T> &answers,
+                                                     Layers::Gradients<T, batchSize, numInputs, numOutputs, rest...> &gradients) const
+{
+    if constexpr (sizeof...(rest) > 0)
+    {
+        backPropagate<Hidden, Output>(layer.next, values.values, values.next, answers, gradients.next);
+
+        // Delta of the next layer = its Derivative * its Error
+        typedef typename std::conditional<sizeof...(rest) == 1, Output, Hidden>::type NextActivation;
+        gradients.nextDelta.template activationGradient<NextActivation>(values.next.values, gradients.next.error, (T)1.0);
+
+        // Error - the delta back propagated through the next layer's Weights, read transposed in place
+        layer.next.weights.transposeMultiply(gradients.nextDelta, gradients.error);
+
+        // Gradient = Derivative * Error * Learning Rate (unless the optimizer applies it)
+        gradients.gradient.template activationGradient<Hidden>(values.values, gradients.error, getStepScale());
+    }
+    else
+    {
+        // Error = Answers - Outputs
+        gradients.error = answers;
+        gradients.error.sub(values.values);
+
+        // Gradient = Derivative * Error * Learning Rate (unless the optimizer applies it)
+        gradients.gradient.template activationGradient<Output>(values.values, gradients.error, getStepScale());
+    }
+
+    // Weight Adjustments - summed over the batch by the matrix product
+    gradients.gradient.multiplyTransposed(inputs, gradients.weightsAdjustment);
+    gradients.gradient.sumColumns(gradients.biasAdjustment);
+}
+
+// Apply the adjustments of a layer and every layer after it
+template <typename T, uint16_t... layerSizes>
+template <uint16_t batchSize, uint16_t numInputs, uint16_t numOutputs, uint16_t... rest>
+inline void DeepNet<T, layerSizes...>::applyAdjustments(Layers::Weights<T, numInputs, numOutputs, rest...> &layer,
+                                                        Layers::State<T, numInputs, numOutputs, rest...> &layerState,
+                                                        const Layers::Gradients<T, batchSize, numInputs, numOutputs, rest...> &gradients) const
+{
+    optimizer.update(layer.weights, gradients.weightsAdjustment, layerState.weights);
+    optimizer.update(layer.bias, gradients.biasAdjustment, layerState.bias);
+
+    if constexpr (sizeof...(rest) > 0)
+    {
+        applyAdjustments(layer.next, layerState.next, gradients.next);
+    }
+}
+
+#endif
@@ -0,0 +1,233 @@
+//-----------------------------------------------------------------------------
+// File: IdxFile.h
+// Author: Edward Koch
+// Description: Holds the declaration of the IdxFile Class
+//              Zero-copy reader for the unsigned byte IDX files used by the
+//              MNIST dataset - the file is memory mapped, the header is
+//              validated and every item is a view straight into the mapping
+//
+// IDX Layout (big-endian)
+//   0x00 0x00 <type> <numDims>   magic number - type 0x08 is unsigned byte
+//   uint32 x numDims             size of each dimension, items first
+//   data                         items one after another, row-major
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Shared Header Parsing
+//-----------------------------------------------------------------------------
+#ifndef IDX_FILE_H
+#define IDX_FILE_H
+
+#include "MappedFile.h"
+#include "MatrixSimd.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace Idx
+{
+    // Data type byte of an unsigned byte IDX file
+    const uint8_t TYPE_UBYTE = 0x08;
+
+    // Most dimensions supported - enough for labels (1), images (3) or volumes (4)
+    const uint8_t MAX_DIMS = 4;
+
+    // Largest possible header - magic number and MAX_DIMS sizes
+    const uint64_t MAX_HEADER_SIZE = 4 + 4 * MAX_DIMS;
+
+    // Read a big-endian 32 bit value
+    inline uint32_t readBigEndian(const uint8_t* bytes)
+    {
+        return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | (uint32_t)bytes[3];
+    }
+
+    // Parsed IDX header
+    struct Header
+    {
+        uint8_t numDims;
+        uint32_t dims[MAX_DIMS];
+
+        // Bytes in one item - the product of every dimension after the first
+        uint64_t itemSize;
+
+        // Bytes before the first item
+        uint64_t size;
+    };
+
+    // Parse and validate the header at the start of an IDX file of fileSize bytes
+    // available is the number of bytes readable at bytes (at most the whole file)
+    // Returns false if it is not an unsigned byte IDX file or any item is missing
+    inline bool parseHeader(const uint8_t* bytes, uint64_t available, uint64_t fileSize, Header &header)
+    {
+        // Magic number
+        if (available < 4 || bytes[0] != 0 || bytes[1] != 0 || bytes[2] != TYPE_UBYTE ||
+            bytes[3] == 0 || bytes[3] > MAX_DIMS)
+        {
+            return false;
+        }
+
+        header.numDims = bytes[3];
+        header.size = 4 + 4 * (uint64_t)header.numDims;
+
+        if (available < header.size)
+        {
+            return false;
+        }
+
+        // Dimensions
+        header.itemSize = 1;
+
+        for (uint8_t dim = 0; dim < header.numDims; ++dim)
+        {
+            header.dims[dim] = readBigEndian(bytes + 4 + 4 * dim);
+
+            if (dim > 0)
+            {
+                header.itemSize *= header.dims[dim];
+            }
+        }
+
+        // Every item must be present
+        return header.itemSize > 0 && (fileSize - header.size) / header.itemSize >= header.dims[0];
+    }
+};
+
+class IdxFile
+{
+public:
+    // Constructor - nothing open
+    IdxFile();
+
+    // Map an IDX file and validate its header
+    // Returns false if the file is missing, truncated or not unsigned bytes
+    bool open(const char* path);
+
+    // Unmap the file - every item view becomes invalid
+    void close();
+
+    // Check if a valid file is open
+    bool isOpen() const { return items != nullptr; }
+
+    // Get the number of dimensions, including the item dimension
+    uint8_t getNumDims() const { return numDims; }
+
+    // Get the size of one dimension
+    uint32_t getDim(uint8_t dim) const { return (dim < numDims) ? dims[dim] : 0; }
+
+    // Get the number of items - the first dimension
+    uint32_t getCount() const { return (numDims > 0) ? dims[0] : 0; }
+
+    // Get the number of bytes in one item - the product of the other dimensions
+    uint64_t getItemSize() const { return itemSize; }
+
+    // Get a zero-copy view of one item
+    const uint8_t* getItem(uint32_t index) const;
+
+    // Convert numItems consecutive items to T in SIMD batches - dst[i] = byte * scale
+    template<typename T>
+    void normalize(uint32_t first, uint32_t numItems, T* dst, T scale) const;
+
+private:
+    IdxFile(const IdxFile &other) = delete;
+    IdxFile& operator=(const IdxFile &other) = delete;
+
+    MappedFile file;
+
+    // Header
+    uint8_t numDims;
+    uint32_t dims[Idx::MAX_DIMS];
+    uint64_t itemSize;
+
+    // First byte of the first item
+    const uint8_t* items;
+};
+
+// Constructor - nothing open
+inline IdxFile::IdxFile()
+    : numDims(0),
+      dims{ 0 },
+      itemSize(0),
+      items(nullptr)
+{
+
+}
+
+// Map an IDX file and validate its header
+// Returns false if the file is missing, truncated or not unsigned bytes
+inline bool IdxFile::open(const char* path)
+{
+    close();
+
+    if (!file.open(path))
+    {
+#if _DEBUG
+        printf("IdxFile - Open: Unable to map %s\n", path);
+#endif
+        return false;
+    }
+
+    Idx::Header header;
+
+    if (!Idx::parseHeader(file.getData(), file.getSize(), file.getSize(), header))
+    {
+#if _DEBUG
+        printf("IdxFile - Open: %s is not a complete unsigned byte IDX file\n", path);
+#endif
+        close();
+        return false;
+    }
+
+    numDims = header.numDims;
+    for (uint8_t dim = 0; dim < numDims; ++dim)
+    {
+        dims[dim] = header.dims[dim];
+    }
+    itemSize = header.itemSize;
+    items = file.getData() + header.size;
+
+    return true;
+}
+
+// Unmap the file - every item view becomes invalid
+inline void IdxFile::close()
+{
+    file.close();
+
+    numDims = 0;
+    itemSize = 0;
+    items = nullptr;
+}
+
+// Get a zero-copy view of one item
+inline const uint8_t* IdxFile::getItem(uint32_t index) const
+{
+    if (index >= getCount())
+    {
+#if _DEBUG
+        printf("IdxFile - Get Item: Invalid Index %u\n", index);
+#endif
+        return nullptr;
+    }
+
+    return items + (uint64_t)index * itemSize;
+}
+
+// Convert numItems consecutive items to T in SIMD batches - dst[i] = byte * scale
+// dst must hold numItems * getItemSize() elements
+template<typename T>
+inline void IdxFile::normalize(uint32_t first, uint32_t numItems, T* dst, T scale) const
+{
+    if ((uint64_t)first + numItems > getCount())
+    {
+#if _DEBUG
+        printf("IdxFile - Normalize: Invalid Range %u + %u\n", first, numItems);
+#endif
+        return;
+    }
+
+    Simd::ops<T>().fromBytes(dst, items + (uint64_t)first * itemSize, scale, (uint64_t)numItems * itemSize);
+}
+
+#endif
@@ -0,0 +1,200 @@
+//-----------------------------------------------------------------------------
+// File: MappedFile.h
+// Author: Edward Koch
+// Description: Holds the declaration of the MappedFile Class
+//              Maps a whole file read-only into memory so it can be used in
+//              place - pages are only read from disk when first touched
+//
+//              A copy-on-write mapping may also be written - written pages
+//              become private to the process and the file never changes
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Copy-on-write Mappings
+//-----------------------------------------------------------------------------
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile
+{
+public:
+    // Constructor - nothing mapped
+    MappedFile();
+
+    // Destructor - unmaps the file
+    ~MappedFile();
+
+    // Map a whole file read-only, or copy-on-write so it can be modified in place
+    // Returns false if it cannot be opened or mapped
+    bool open(const char* path, bool copyOnWrite = false);
+
+    // Unmap the file - every pointer into it becomes invalid
+    void close();
+
+    // Check if a file is mapped
+    bool isOpen() const { return data != nullptr; }
+
+    // Get the first byte of the mapped file
+    const uint8_t* getData() const { return data; }
+
+    // Get the first byte of a copy-on-write mapping - null for a read-only one
+    uint8_t* getWritableData() const { return writable ? data : nullptr; }
+
+    // Get the number of bytes in the mapped file
+    uint64_t getSize() const { return size; }
+
+private:
+    MappedFile(const MappedFile &other) = delete;
+    MappedFile& operator=(const MappedFile &other) = delete;
+
+    uint8_t* data;
+    uint64_t size;
+    bool writable;
+
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int file;
+#endif
+};
+
+// Constructor - nothing mapped
+inline MappedFile::MappedFile()
+    : data(nullptr),
+      size(0),
+      writable(false),
+#ifdef _WIN32
+      file(INVALID_HANDLE_VALUE),
+      mapping(NULL)
+#else
+      file(-1)
+#endif
+{
+
+}
+
+// Destructor - unmaps the file
+inline MappedFile::~MappedFile()
+{
+    close();
+}
+
+// Map a whole file read-only, or copy-on-write so it can be modified in place
+// Returns false if it cannot be opened or mapped
+inline bool MappedFile::open(const char* path, bool copyOnWrite)
+{
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    size = (uint64_t)fileSize.QuadPart;
+
+    mapping = CreateFileMappingA(file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        close();
+        return false;
+    }
+
+    data = (uint8_t*)MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        close();
+        return false;
+    }
+#else
+    file = ::open(path, O_RDONLY);
+    if (file < 0)
+    {
+        return false;
+    }
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+    {
+        close();
+        return false;
+    }
+    size = (uint64_t)fileStat.st_size;
+
+    // A private mapping never writes back to the file
+    void* mapped = mmap(nullptr, (size_t)size, copyOnWrite ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapped == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    // Start read-ahead now, the whole file is about to be walked in order
+    madvise(mapped, (size_t)size, MADV_WILLNEED);
+
+    data = (uint8_t*)mapped;
+#endif
+
+    writable = copyOnWrite;
+
+    return true;
+}
+
+// Unmap the file - every pointer into it becomes invalid
+inline void MappedFile::close()
+{
+#ifdef _WIN32
+    if (data != nullptr)
+    {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != NULL)
+    {
+        CloseHandle(mapping);
+        mapping = NULL;
+    }
+    if (file != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    if (data != nullptr)
+    {
+        munmap((void*)data, (size_t)size);
+    }
+    if (file >= 0)
+    {
+        ::close(file);
+        file = -1;
+    }
+#endif
+
+    data = nullptr;
+    size = 0;
+    writable = false;
+}
+
+#endif
@@ -10,6 +10,17 @@
 //-----------------------------------------------------------------------------
 // E. Koch    07/12/24    Initial Creation 
 // E. Koch    11/30/24    Starting Fresh
+// E. Koch    10/17/26    Blocked GEMM Kernel for multiply
+// E. Koch    10/17/26    SIMD Element-wise Kernels and Aligned Storage
+// E. Koch    10/17/26    Column Access and Broadcasts for Mini-batches
+// E. Koch    10/17/26    Raw Data Access
+// E. Koch    10/17/26    Templated Element Type
+// E. Koch    10/17/26    Heap Backed Storage with Move Semantics
+// E. Koch    10/17/26    Multiplication by Compact Byte Matrices
+// E. Koch    10/17/26    External Storage
+// E. Koch    10/17/26    Fused Epilogues and Activation Gradients
+// E. Koch    10/17/26    Column Softmax
+// E. Koch    10/17/26    Transposed Multiplication and Rank-1 Updates
 //-----------------------------------------------------------------------------
 #ifndef MATRIX_H
 #define MATRIX_H
@@ -20,7 +31,11 @@
 #include <stdint.h>
 #include <stdio.h>
 
-template<uint16_t numRows, uint16_t numCols>
+#include "MatrixKernels.h"
+#include "MatrixSimd.h"
+#include "MatrixStorage.h"
+
+template<uint16_t numRows, uint16_t numCols, typename T = double_t>
 class Matrix
 {
 public:
@@ -28,22 +43,29 @@ public:
     Matrix();
 
     // Constructor - initialize from array
-    Matrix(const double_t(&initArr)[numRows * numCols]);
+    Matrix(const T(&initArr)[numRows * numCols]);
 
     // Copy Constructor
-    Matrix(const Matrix<numRows, numCols> &m);
+    Matrix(const Matrix<numRows, numCols, T> &m);
+
+    // Move Constructor - takes the other Matrix's storage and leaves it empty
+    // An empty Matrix must be assigned to before it is used again
+    Matrix(Matrix<numRows, numCols, T> &&other) noexcept;
 
     // Destructor
     ~Matrix();
 
     // Copy Assignment
-    Matrix<numRows, numCols>& operator=(const Matrix<numRows, numCols> &other);
+    Matrix<numRows, numCols, T>& operator=(const Matrix<numRows, numCols, T> &other);
+
+    // Move Assignment - swaps storage with the other Matrix
+    Matrix<numRows, numCols, T>& operator=(Matrix<numRows, numCols, T> &&other) noexcept;
 
     // Fill the Matrix based on an array
-    void fill(const double_t(&initArr)[numRows * numCols]);
+    void fill(const T(&initArr)[numRows * numCols]);
 
     // Populate an array with the Matrix values
-    void toArray(double_t (&arr)[numRows * numCols]);
+    void toArray(T (&arr)[numRows * numCols]) const;
 
     // Get the number of rows in the Matrix
     uint16_t getRows() const { return numRows; }
@@ -51,139 +73,236 @@ public:
     // Get the number of rows in the Matrix
     uint16_t getCols() const { return numCols; }
 
+    // Get the number of elements in the Matrix
+    uint64_t getLength() const { return length; }
+
+    // Get the underlying row-major array
+    T* getData() { return matrix; }
+    const T* getData() const { return matrix; }
+
+    // Use external storage in place of our own, e.g. weights in a mapped file
+    // The storage must be MATRIX_ALIGNMENT aligned, hold numRows * numCols
+    // elements and outlive the Matrix - it is never freed by the Matrix
+    void attach(T* data);
+
     // Get the value of an element
-    double_t getElement(uint16_t row, uint16_t col) const;
+    T getElement(uint16_t row, uint16_t col) const;
 
     // Set the value of an element
-    void setElement(uint16_t row, uint16_t col, double_t value);
+    void setElement(uint16_t row, uint16_t col, T value);
+
+    // Fill a single column based on an array
+    void setColumn(uint16_t col, const T(&arr)[numRows]);
+
+    // Populate an array with a single column
+    void getColumn(uint16_t col, T(&arr)[numRows]) const;
 
     // Set all values to 0
     void clear();
 
     // Randomize the values of the matrix given a range
-    void randomize(std::mt19937 &rng, double_t min, double_t max);
+    void randomize(std::mt19937 &rng, T min, T max);
 
     // Apply function to each element
-    void applyFunction(double_t (*func)(double_t));
+    void applyFunction(T (*func)(T));
 
     // Print the matrix
     void print();
 
     // Scalar addition
-    void add(double_t addor);
+    void add(T addor);
 
     // Element-wise addition
-    void add(const Matrix<numRows, numCols> &addor);
+    void add(const Matrix<numRows, numCols, T> &addor);
 
     // Scalar subtraction
-    void sub(double_t addor);
+    void sub(T addor);
 
     // Element-wise subtraction
-    void sub(const Matrix<numRows, numCols>& addor);
+    void sub(const Matrix<numRows, numCols, T>& addor);
 
     // Scalar Multiplicaiton
-    void scale(double_t scalar);
+    void scale(T scalar);
 
     // Element-wise Multiplicaiton
-    void scale(const Matrix<numRows, numCols> &scalar);
+    void scale(const Matrix<numRows, numCols, T> &scalar);
+
+    // Column-wise addition - adds the column vector to every column
+    void addColumnVector(const Matrix<numRows, 1, T> &column);
+
+    // Sum all columns together into a column vector
+    void sumColumns(Matrix<numRows, 1, T> &result) const;
+
+    // Normalise each column to a probability distribution (softmax)
+    void softmaxColumns();
 
     // Dot-Product Multiplication - Other must have the same number of rows as our columns
+    // The epilogue (e.g. Kernels::BiasActivation) is applied to each result as it is finished
+    template<uint16_t otherCols, typename Epilogue = Kernels::Identity<T>>
+    void multiply(const Matrix<numCols, otherCols, T> &other, Matrix<numRows, otherCols, T>& result, const Epilogue &epilogue = Epilogue()) const;
+
+    // Dot-Product Multiplication by a numCols x otherCols row-major byte matrix,
+    // each byte scaled by otherScale as the kernel reads it (e.g. raw pixels)
+    template<uint16_t otherCols, typename Epilogue = Kernels::Identity<T>>
+    void multiply(const uint8_t* other, T otherScale, Matrix<numRows, otherCols, T>& result, const Epilogue &epilogue = Epilogue()) const;
+
+    // Set to the gradient of a layer in one pass - derivative(outputs) * errors * scale
+    // Activation is any type with a static T derivative(T) of the activated output
+    template<typename Activation>
+    void activationGradient(const Matrix<numRows, numCols, T> &outputs, const Matrix<numRows, numCols, T> &errors, T scale);
+
+    // Dot-Product Multiplication by our transpose - result = this^T * other
+    // Other must have the same number of rows as we do
     template<uint16_t otherCols>
-    void multiply(const Matrix<numCols, otherCols> &other, Matrix<numRows, otherCols>& result);
+    void transposeMultiply(const Matrix<numRows, otherCols, T> &other, Matrix<numCols, otherCols, T>& result) const;
+
+    // Dot-Product Multiplication by the transpose of other - result = this * other^T
+    // Other must have the same number of columns as we do
+    template<uint16_t otherRows>
+    void multiplyTransposed(const Matrix<otherRows, numCols, T> &other, Matrix<numRows, otherRows, T>& result) const;
+
+    // Rank-1 Update - add scale * column * row^T to every element
+    void addOuterProduct(const Matrix<numRows, 1, T> &column, const Matrix<numCols, 1, T> &row, T scale = (T)1.0);
 
     // Transpose the Matrix
-    void transpose(Matrix<numCols, numRows>& result);
+    void transpose(Matrix<numCols, numRows, T>& result) const;
 
 private:
     // Templated Matrix Friend
-    template<uint16_t friendRows, uint16_t friendCols>
+    template<uint16_t friendRows, uint16_t friendCols, typename friendT>
     friend class Matrix;
 
     // Length of 1D array - Rows * Cols
-    static const uint64_t length = numRows * numCols;
+    static const uint64_t length = (uint64_t)numRows * numCols;
 
-    // matrix representation - 1D array for memory access 
-    double_t matrix[length];
+    // matrix representation - 1D array for memory access
+    // Allocated from an arena and aligned to a cache line so vector loads
+    // never split a line, null once moved from
+    T* matrix;
+
+    // Arena the storage was allocated from - null for attached storage
+    Storage::Arena* arena;
+
+    // Allocate uninitialized storage from the calling thread's current arena
+    void allocate();
+
+    // Return the storage to its arena
+    void release();
 
     // Map 2D coordinates to 1D array index
     uint64_t getIndex(uint16_t row, uint16_t col) const;
 };
 
 // Constructor - initialize to 0
-template<uint16_t numRows, uint16_t numCols>
-inline Matrix<numRows, numCols>::Matrix()
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>::Matrix()
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] = 0.0;
-    }
+    allocate();
+    Simd::ops<T>().set(matrix, (T)0.0, length);
 }
 
 // Constructor - initialize from array
-template<uint16_t numRows, uint16_t numCols>
-inline Matrix<numRows, numCols>::Matrix(const double_t(&initArr)[numRows * numCols])
-    : length(numRows* numCols)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>::Matrix(const T(&initArr)[numRows * numCols])
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] = initArr[i];
-    }
+    allocate();
+    Simd::ops<T>().copy(matrix, initArr, length);
 }
 
 // Copy Constructor
-template<uint16_t numRows, uint16_t numCols>
-inline Matrix<numRows, numCols>::Matrix(const Matrix<numRows, numCols> &other)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>::Matrix(const Matrix<numRows, numCols, T> &other)
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] = other.matrix[i];
-    }
+    allocate();
+    Simd::ops<T>().copy(matrix, other.matrix, length);
 }
 
-// Destructor
-template<uint16_t numRows, uint16_t numCols>
-inline Matrix<numRows, numCols>::~Matrix()
+// Move Constructor - takes the other Matrix's storage and leaves it empty
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>::Matrix(Matrix<numRows, numCols, T> &&other) noexcept
+    : matrix(other.matrix),
+      arena(other.arena)
 {
+    other.matrix = nullptr;
+    other.arena = nullptr;
+}
 
+// Destructor
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>::~Matrix()
+{
+    release();
 }
 
 // Copy Assignment
-template<uint16_t numRows, uint16_t numCols>
-inline Matrix<numRows, numCols>& Matrix<numRows, numCols>::operator=(const Matrix<numRows, numCols> &other)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>& Matrix<numRows, numCols, T>::operator=(const Matrix<numRows, numCols, T> &other)
 {
     if (this != &other)
     {
-        for (uint64_t i = 0; i < length; ++i)
+        // An empty Matrix gets fresh storage
+        if (matrix == nullptr)
         {
-            matrix[i] = other.matrix[i];
+            allocate();
         }
+
+        Simd::ops<T>().copy(matrix, other.matrix, length);
     }
     return *this;
 }
 
+// Move Assignment - swaps storage with the other Matrix
+// The old storage is released when the other Matrix is destroyed
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline Matrix<numRows, numCols, T>& Matrix<numRows, numCols, T>::operator=(Matrix<numRows, numCols, T> &&other) noexcept
+{
+    T* otherMatrix = other.matrix;
+    Storage::Arena* otherArena = other.arena;
+
+    other.matrix = matrix;
+    other.arena = arena;
+
+    matrix = otherMatrix;
+    arena = otherArena;
+
+    return *this;
+}
+
 // Fill the Matrix based on an array
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::fill(const double_t (&initArr)[numRows * numCols])
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::fill(const T (&initArr)[numRows * numCols])
 {
-    for (uint64_t i = 0; i < length; ++i)
+    Simd::ops<T>().copy(matrix, initArr, length);
+}
+
+// Use external storage in place of our own, e.g. weights in a mapped file
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::attach(T* data)
+{
+    if (data == nullptr || ((uintptr_t)data % MATRIX_ALIGNMENT) != 0)
     {
-        matrix[i] = initArr[i];
+#if _DEBUG
+        printf("Matrix<%u, %u> - Attach: Storage is not %u byte aligned\n", numRows, numCols, MATRIX_ALIGNMENT);
+#endif
+        return;
     }
+
+    release();
+
+    matrix = data;
+    arena = nullptr;
 }
 
 // Populate an array with the Matrix values
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::toArray(double_t (&arr)[numRows * numCols])
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::toArray(T (&arr)[numRows * numCols]) const
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        arr[i] = matrix[i];
-    }
+    Simd::ops<T>().copy(arr, matrix, length);
 }
 
 // Get the value of an element
-template<uint16_t numRows, uint16_t numCols>
-inline double_t Matrix<numRows, numCols>::getElement(uint16_t row, uint16_t col) const
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline T Matrix<numRows, numCols, T>::getElement(uint16_t row, uint16_t col) const
 { 
     uint64_t index = getIndex(row, col);
     if (index >= length)
@@ -199,8 +318,8 @@ inline double_t Matrix<numRows, numCols>::getElement(uint16_t row, uint16_t col)
 
 
 // Set the value of an element
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::setElement(uint16_t row, uint16_t col, double_t value)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::setElement(uint16_t row, uint16_t col, T value)
 {
     uint64_t index = getIndex(row, col);
     if (index >= length)
@@ -214,21 +333,54 @@ inline void Matrix<numRows, numCols>::setElement(uint16_t row, uint16_t col, dou
     matrix[index] = value;
 }
 
-// Set all values to 0
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::clear()
+// Fill a single column based on an array
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::setColumn(uint16_t col, const T(&arr)[numRows])
 {
-    for (uint64_t i = 0; i < length; ++i)
+    if (col >= numCols)
     {
-        matrix[i] = 0.0;
+#if _DEBUG
+        printf("Matrix<%u, %u> - Set Column: Invalid Column %u\n", numRows, numCols, col);
+#endif
+        return;
+    }
+
+    for (uint16_t row = 0; row < numRows; ++row)
+    {
+        matrix[getIndex(row, col)] = arr[row];
     }
 }
 
+// Populate an array with a single column
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::getColumn(uint16_t col, T(&arr)[numRows]) const
+{
+    if (col >= numCols)
+    {
+#if _DEBUG
+        printf("Matrix<%u, %u> - Get Column: Invalid Column %u\n", numRows, numCols, col);
+#endif
+        return;
+    }
+
+    for (uint16_t row = 0; row < numRows; ++row)
+    {
+        arr[row] = matrix[getIndex(row, col)];
+    }
+}
+
+// Set all values to 0
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::clear()
+{
+    Simd::ops<T>().set(matrix, (T)0.0, length);
+}
+
 // Randomize the values of the matrix given a range
-template<uint16_t numRows, uint16_t numCols>
-inline void  Matrix<numRows, numCols>::randomize(std::mt19937 &rng, double_t min, double_t max)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void  Matrix<numRows, numCols, T>::randomize(std::mt19937 &rng, T min, T max)
 {
-    std::uniform_real_distribution<double_t> uniformDist(min, max);
+    std::uniform_real_distribution<T> uniformDist(min, max);
 
     for (uint64_t i = 0; i < length; ++i)
     {
@@ -237,8 +389,8 @@ inline void  Matrix<numRows, numCols>::randomize(std::mt19937 &rng, double_t min
 }
 
 // Apply function to each element
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::applyFunction(double_t (*func)(double_t))
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::applyFunction(T (*func)(T))
 {
     for (uint64_t i = 0; i < length; ++i)
     {
@@ -247,8 +399,8 @@ inline void Matrix<numRows, numCols>::applyFunction(double_t (*func)(double_t))
 }
 
 // Print the matrix
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::print()
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::print()
 {
     for (uint16_t row = 0; row < numRows; ++row)
     {
@@ -264,70 +416,89 @@ inline void Matrix<numRows, numCols>::print()
 }
 
 // Scalar addition
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::add(double_t addor)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::add(T addor)
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] += addor;
-    }
+    Simd::ops<T>().addScalar(matrix, addor, length);
 }
 
 // Element-wise addition
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::add(const Matrix<numRows, numCols> &addor)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::add(const Matrix<numRows, numCols, T> &addor)
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] += addor.matrix[i];
-    }
+    Simd::ops<T>().add(matrix, addor.matrix, length);
 }
 
 // Scalar subtraction
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::sub(double_t addor)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::sub(T addor)
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] -= addor;
-    }
+    Simd::ops<T>().addScalar(matrix, -addor, length);
 }
 
 // Element-wise subtraction
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::sub(const Matrix<numRows, numCols>& addor)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::sub(const Matrix<numRows, numCols, T>& addor)
 {
-    for (uint64_t i = 0; i < length; ++i)
-    {
-        matrix[i] -= addor.matrix[i];
-    }
+    Simd::ops<T>().sub(matrix, addor.matrix, length);
 }
 
 // Scalar Multiplicaiton
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::scale(double_t scalar)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::scale(T scalar)
 {
-    for (uint64_t i = 0; i < length; ++i)
+    Simd::ops<T>().mulScalar(matrix, scalar, length);
+}
+
+// Element-wise Multiplicaiton
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::scale(const Matrix<numRows, numCols, T> &scalar)
+{
+    Simd::ops<T>().mul(matrix, scalar.matrix, length);
+}
+
+// Column-wise addition - adds the column vector to every column
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::addColumnVector(const Matrix<numRows, 1, T> &column)
+{
+    // Each row gets the same value added across all of its columns
+    for (uint16_t row = 0; row < numRows; ++row)
     {
-        matrix[i] *= scalar;
+        Simd::ops<T>().addScalar(&matrix[getIndex(row, 0)], column.matrix[row], numCols);
     }
 }
 
-// Element-wise Multiplicaiton
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::scale(const Matrix<numRows, numCols> &scalar)
+// Normalise each column to a probability distribution (softmax)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::softmaxColumns()
 {
-    for (uint64_t i = 0; i < length; ++i)
+    Kernels::softmaxColumns(matrix, numRows, numCols);
+}
+
+// Sum all columns together into a column vector
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::sumColumns(Matrix<numRows, 1, T> &result) const
+{
+    for (uint16_t row = 0; row < numRows; ++row)
     {
-        matrix[i] *= scalar.matrix[i];
+        const T* rowValues = &matrix[getIndex(row, 0)];
+
+        T value = 0.0;
+        for (uint16_t col = 0; col < numCols; ++col)
+        {
+            value += rowValues[col];
+        }
+
+        result.matrix[row] = value;
     }
 }
 
 // Dot-Product Multiplication - Other must have the same number of rows as our columns
+// The epilogue (e.g. Kernels::BiasActivation) is applied to each result as it is finished
 // Stores result in provided matrix
-template<uint16_t numRows, uint16_t numCols>
-template<uint16_t otherCols>
-inline void Matrix<numRows, numCols>::multiply(const Matrix<numCols, otherCols> &other, Matrix<numRows, otherCols> &result)
+template<uint16_t numRows, uint16_t numCols, typename T>
+template<uint16_t otherCols, typename Epilogue>
+inline void Matrix<numRows, numCols, T>::multiply(const Matrix<numCols, otherCols, T> &other, Matrix<numRows, otherCols, T> &result, const Epilogue &epilogue) const
 {
     // Self    Other       Result
     // 2x3     3x4         2x4
@@ -337,39 +508,64 @@ inline void Matrix<numRows, numCols>::multiply(const Matrix<numCols, otherCols>
     //                     (00,00 + 01,10 + 02,20) (00,01 + 01,11 + 02,21) ... (00,03 + 01,13 + 02,23)
     //                     (10,00 + 11,10 + 12,20) (10,01 + 11,11 + 12,21) ... (10,03 + 11,13 + 12,23)
 
-    result.clear();
+    // Dispatch at compile time on the dimensions - GEMV, outer product or blocked GEMM
+    Kernels::Gemm<T, numRows, numCols, otherCols>::run(matrix, other.matrix, result.matrix, (T)1.0, epilogue);
+}
 
-    // Temp Variables
-    double_t value = 0;
-    uint64_t myIdx = 0;
+// Dot-Product Multiplication by a numCols x otherCols row-major byte matrix,
+// each byte scaled by otherScale as the kernel reads it (e.g. raw pixels)
+// The bytes are converted while the kernel packs or streams them, so no
+// full precision copy of other is ever made
+// Stores result in provided matrix
+template<uint16_t numRows, uint16_t numCols, typename T>
+template<uint16_t otherCols, typename Epilogue>
+inline void Matrix<numRows, numCols, T>::multiply(const uint8_t* other, T otherScale, Matrix<numRows, otherCols, T> &result, const Epilogue &epilogue) const
+{
+    Kernels::Gemm<T, numRows, numCols, otherCols>::run(matrix, other, result.matrix, otherScale, epilogue);
+}
 
-    // For each row in the resulting Matrix
-    for (uint16_t resRow = 0; resRow < numRows; ++resRow)
-    {
-        // For each col in the resulting Matrix
-        for (uint16_t resCol = 0; resCol < otherCols; ++resCol)
-        {
-            // Initialize value to 0
-            value = 0;
+// Set to the gradient of a layer in one pass - derivative(outputs) * errors * scale
+// Replaces a copy, an element-wise function and two scales
+template<uint16_t numRows, uint16_t numCols, typename T>
+template<typename Activation>
+inline void Matrix<numRows, numCols, T>::activationGradient(const Matrix<numRows, numCols, T> &outputs, const Matrix<numRows, numCols, T> &errors, T scale)
+{
+    Kernels::activationGradient<T, Activation>(outputs.matrix, errors.matrix, scale, matrix, length);
+}
 
-            // For each row/column pair in self and other
-            for (uint16_t i = 0; i < numCols; ++i)
-            {
-                myIdx = getIndex(resRow, i);
+// Dot-Product Multiplication by our transpose - result = this^T * other
+// Our columns are read in place, no transposed copy is made
+// Stores result in provided matrix
+template<uint16_t numRows, uint16_t numCols, typename T>
+template<uint16_t otherCols>
+inline void Matrix<numRows, numCols, T>::transposeMultiply(const Matrix<numRows, otherCols, T> &other, Matrix<numCols, otherCols, T> &result) const
+{
+    Kernels::GemmTransposedA<T, numCols, numRows, otherCols>::run(matrix, other.matrix, result.matrix);
+}
 
-                value += (matrix[myIdx] * other.getElement(i, resCol));
-            }
+// Dot-Product Multiplication by the transpose of other - result = this * other^T
+// The columns of other are read in place, no transposed copy is made
+// Stores result in provided matrix
+template<uint16_t numRows, uint16_t numCols, typename T>
+template<uint16_t otherRows>
+inline void Matrix<numRows, numCols, T>::multiplyTransposed(const Matrix<otherRows, numCols, T> &other, Matrix<numRows, otherRows, T> &result) const
+{
+    Kernels::GemmTransposedB<T, numRows, numCols, otherRows>::run(matrix, other.matrix, result.matrix);
+}
 
-            // Set value in result matrix
-            result.setElement(resRow, resCol, value);
-        }
-    }
+// Rank-1 Update - add scale * column * row^T to every element
+// Equivalent to multiplying column by the transpose of row and adding the
+// result, without storing either
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::addOuterProduct(const Matrix<numRows, 1, T> &column, const Matrix<numCols, 1, T> &row, T scale)
+{
+    Kernels::rank1Update(matrix, column.matrix, row.matrix, scale, numRows, numCols);
 }
 
 // Transpose the Matrix
 // Stores result in provided matrix
-template<uint16_t numRows, uint16_t numCols>
-inline void Matrix<numRows, numCols>::transpose(Matrix<numCols, numRows>& result)
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::transpose(Matrix<numCols, numRows, T>& result) const
 {
     result.clear();
 
@@ -385,8 +581,29 @@ inline void Matrix<numRows, numCols>::transpose(Matrix<numCols, numRows>& result
     }
 }
 
-template<uint16_t numRows, uint16_t numCols>
-inline uint64_t Matrix<numRows, numCols>::getIndex(uint16_t row, uint16_t col) const
+// Allocate uninitialized storage from the calling thread's current arena
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::allocate()
+{
+    arena = Storage::currentArena();
+    matrix = (T*)arena->allocate(length * sizeof(T));
+}
+
+// Return the storage to its arena
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline void Matrix<numRows, numCols, T>::release()
+{
+    if (matrix != nullptr && arena != nullptr)
+    {
+        arena->deallocate(matrix, length * sizeof(T));
+    }
+
+    matrix = nullptr;
+    arena = nullptr;
+}
+
+template<uint16_t numRows, uint16_t numCols, typename T>
+inline uint64_t Matrix<numRows, numCols, T>::getIndex(uint16_t row, uint16_t col) const
 {
     // Map 2D coordinates to 1D array index
     return (uint64_t)row * (uint64_t)numCols + (uint64_t)col;
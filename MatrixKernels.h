@@ -0,0 +1,569 @@
+//-----------------------------------------------------------------------------
+// File: MatrixKernels.h
+// Author: Edward Koch
+// Description: Holds the raw-pointer compute kernels used by the Matrix Class
+//              Matrix Multiplication is dispatched at compile time on the
+//              template dimensions to a GEMV, outer product or a cache
+//              blocked GEMM with packed panels and a register micro-kernel
+//
+//              B may be stored as a narrower type (e.g. uint8_t pixels) with a
+//              scale - it is converted as it is read or packed, so a full
+//              precision copy of B is never made
+//
+//              An epilogue functor can be applied to every element of C as it
+//              is finished (e.g. bias and activation), so a layer's output is
+//              written once instead of once per element-wise pass - it is
+//              given runs of finished elements so the activation vectorises
+//
+//              Either operand can be read as its transpose in place - the
+//              blocked GEMM transposes while packing and the vector shapes
+//              share a layout with their transpose - so backpropagation never
+//              materialises a transposed copy
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Templated Element Type
+// E. Koch    10/17/26    Fused Conversion of Compact B
+// E. Koch    10/17/26    Fused Epilogues and Activation Gradients
+// E. Koch    10/17/26    Vectorised Epilogues and Softmax
+// E. Koch    10/17/26    Transposed Operands and Rank-1 Updates
+// E. Koch    10/17/26    SIMD Register Tiles
+//-----------------------------------------------------------------------------
+#ifndef MATRIX_KERNELS_H
+#define MATRIX_KERNELS_H
+
+#include "MatrixSimd.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+namespace Kernels
+{
+    ///////////////////////
+    // GEMM Blocking     //
+    ///////////////////////
+    // Register tile - MR x NR accumulators held by the micro-kernel
+    // NR spans one AVX-512 register (or two AVX2 registers) of elements
+    const uint16_t GEMM_MR = Simd::GEMM_MR;
+
+    template<typename T>
+    struct GemmTile
+    {
+        static const uint16_t NR = Simd::GEMM_NR_BYTES / sizeof(T);
+    };
+
+    // Depth of a packed panel - MR x KC of A and KC x NR of B stay in L1
+    const uint16_t GEMM_KC = 256;
+
+    // Rows of A packed per block - MC x KC of A stays in L2
+    const uint16_t GEMM_MC = 96;
+
+    // Columns of B packed per block - KC x NC of B stays in L3
+    const uint16_t GEMM_NC = 2048;
+
+    // Shape of a multiplication, chosen at compile time from the dimensions
+    enum class GemmShape : uint8_t
+    {
+        GEMV,       // Matrix * Column Vector
+        OUTER,      // Column Vector * Row Vector
+        VECMAT,     // Row Vector * Matrix
+        BLOCKED     // General Matrix * Matrix
+    };
+
+    // Storage of an operand - a TRANSPOSED operand is stored as the transpose
+    // of the operand the product needs and is read across instead of down
+    enum class Operand : uint8_t
+    {
+        NORMAL,
+        TRANSPOSED
+    };
+
+    constexpr GemmShape gemmShape(uint16_t m, uint16_t k, uint16_t n)
+    {
+        return (n == 1) ? GemmShape::GEMV :
+               (k == 1) ? GemmShape::OUTER :
+               (m == 1) ? GemmShape::VECMAT :
+                          GemmShape::BLOCKED;
+    }
+
+    constexpr uint16_t minDim(uint16_t a, uint16_t b)
+    {
+        return (a < b) ? a : b;
+    }
+
+    // Round a dimension up to a multiple of the register tile
+    constexpr uint64_t roundUp(uint64_t value, uint64_t multiple)
+    {
+        return ((value + multiple - 1) / multiple) * multiple;
+    }
+
+    ///////////////////////
+    // Epilogues         //
+    ///////////////////////
+    // Applied in place to runs of finished elements of C - values[i] is the
+    // complete product in row (row + i * rowStep) of C, the neuron for a layer
+    // with one input per column. A run along a row of C has a rowStep of 0,
+    // a run down a column vector has a rowStep of 1
+
+    // No epilogue - the plain product
+    template<typename T>
+    struct Identity
+    {
+        void operator()(T* values, uint32_t count, uint32_t row, uint32_t rowStep) const
+        {
+            (void)values;
+            (void)count;
+            (void)row;
+            (void)rowStep;
+        }
+    };
+
+    // Layer output - act(value + bias[row])
+    // Activation is any type with a static void apply(T* values, uint64_t count)
+    template<typename T, typename Activation>
+    struct BiasActivation
+    {
+        const T* bias;
+
+        void operator()(T* values, uint32_t count, uint32_t row, uint32_t rowStep) const
+        {
+            for (uint32_t i = 0; i < count; ++i)
+            {
+                values[i] += bias[row + i * rowStep];
+            }
+
+            Activation::apply(values, count);
+        }
+    };
+
+    // Layer gradient in one pass - gradient = derivative(outputs) * errors * scale
+    // Activation is any type with a static T derivative(T) of the activated output
+    template<typename T, typename Activation>
+    inline void activationGradient(const T* outputs, const T* errors, T scale, T* gradient, uint64_t len)
+    {
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            gradient[i] = Activation::derivative(outputs[i]) * errors[i] * scale;
+        }
+    }
+
+    // Normalise each column of a rows x cols matrix to exp(a) / sum(exp(a))
+    // Works a row at a time so every pass is contiguous - the column maxima
+    // are subtracted first so exp cannot overflow
+    template<typename T>
+    inline void softmaxColumns(T* a, uint16_t rows, uint16_t cols)
+    {
+        thread_local std::vector<T> scratch;
+
+        if (scratch.size() < cols)
+        {
+            scratch.resize(cols);
+        }
+
+        T* columnValues = scratch.data();
+
+        // Column maxima
+        for (uint16_t col = 0; col < cols; ++col)
+        {
+            columnValues[col] = a[col];
+        }
+        for (uint16_t row = 1; row < rows; ++row)
+        {
+            const T* aRow = a + (uint64_t)row * cols;
+
+            for (uint16_t col = 0; col < cols; ++col)
+            {
+                columnValues[col] = (aRow[col] > columnValues[col]) ? aRow[col] : columnValues[col];
+            }
+        }
+
+        // exp(a - max)
+        for (uint16_t row = 0; row < rows; ++row)
+        {
+            T* aRow = a + (uint64_t)row * cols;
+
+            for (uint16_t col = 0; col < cols; ++col)
+            {
+                aRow[col] -= columnValues[col];
+            }
+
+            Simd::ops<T>().exp(aRow, aRow, cols);
+        }
+
+        // Column sums, inverted so the last pass is a multiply
+        Simd::ops<T>().copy(columnValues, a, cols);
+
+        for (uint16_t row = 1; row < rows; ++row)
+        {
+            Simd::ops<T>().add(columnValues, a + (uint64_t)row * cols, cols);
+        }
+        for (uint16_t col = 0; col < cols; ++col)
+        {
+            columnValues[col] = (T)1.0 / columnValues[col];
+        }
+
+        for (uint16_t row = 0; row < rows; ++row)
+        {
+            Simd::ops<T>().mul(a + (uint64_t)row * cols, columnValues, cols);
+        }
+    }
+
+    // Per-thread packing buffer - grown on first use and reused afterwards
+    template<typename T>
+    inline T* packBuffer(uint8_t slot, uint64_t size)
+    {
+        thread_local std::vector<T> buffers[2];
+
+        if (buffers[slot].size() < size)
+        {
+            buffers[slot].resize(size);
+        }
+
+        return buffers[slot].data();
+    }
+
+    // Pack an mc x kc block of A (row stride lda) into MR row panels
+    // Each panel is stored k-major so the micro-kernel reads it sequentially
+    // A TRANSPOSED block is stored kc x mc, so each k reads a contiguous run
+    // Rows past mc are zero padded
+    template<Operand layout = Operand::NORMAL, typename T>
+    inline void packA(const T* a, uint64_t lda, uint16_t mc, uint16_t kc, T* packed)
+    {
+        for (uint16_t ir = 0; ir < mc; ir += GEMM_MR)
+        {
+            uint16_t mr = minDim(GEMM_MR, mc - ir);
+
+            for (uint16_t k = 0; k < kc; ++k)
+            {
+                for (uint16_t i = 0; i < mr; ++i)
+                {
+                    packed[i] = (layout == Operand::NORMAL) ? a[(uint64_t)(ir + i) * lda + k]
+                                                            : a[(uint64_t)k * lda + ir + i];
+                }
+                for (uint16_t i = mr; i < GEMM_MR; ++i)
+                {
+                    packed[i] = (T)0.0;
+                }
+                packed += GEMM_MR;
+            }
+        }
+    }
+
+    // Pack a kc x nc block of B (row stride ldb) into NR column panels
+    // Each panel is stored k-major so the micro-kernel reads it sequentially
+    // Elements are converted to T and scaled by bScale as they are packed
+    // A TRANSPOSED block is stored nc x kc
+    // Columns past nc are zero padded
+    template<Operand layout = Operand::NORMAL, typename T, typename S>
+    inline void packB(const S* b, uint64_t ldb, uint16_t kc, uint16_t nc, T bScale, T* packed)
+    {
+        const uint16_t NR = GemmTile<T>::NR;
+
+        for (uint16_t jr = 0; jr < nc; jr += NR)
+        {
+            uint16_t nr = minDim(NR, nc - jr);
+
+            for (uint16_t k = 0; k < kc; ++k)
+            {
+                for (uint16_t j = 0; j < nr; ++j)
+                {
+                    S value = (layout == Operand::NORMAL) ? b[(uint64_t)k * ldb + jr + j]
+                                                          : b[(uint64_t)(jr + j) * ldb + k];
+                    packed[j] = (T)value * bScale;
+                }
+                for (uint16_t j = nr; j < NR; ++j)
+                {
+                    packed[j] = (T)0.0;
+                }
+                packed += NR;
+            }
+        }
+    }
+
+    // Register micro-kernel - MR x NR tile of C from packed panels of A and B
+    // The tile is accumulated by the SIMD kernel of the CPU, which holds it in
+    // named vector registers, only the valid mr x nr corner is written back
+    // On the last slice of K (finish) the epilogue is applied as it is written
+    template<typename T, typename Epilogue>
+    inline void microKernel(uint16_t kc, const T* aPanel, const T* bPanel,
+                            T* c, uint64_t ldc, uint16_t mr, uint16_t nr, bool accumulate,
+                            bool finish, uint32_t row, const Epilogue &epilogue)
+    {
+        const uint16_t NR = GemmTile<T>::NR;
+
+        T acc[GEMM_MR][NR];
+
+        Simd::ops<T>().gemmTile(&acc[0][0], aPanel, bPanel, kc);
+
+        for (uint16_t i = 0; i < mr; ++i)
+        {
+            T* cRow = c + (uint64_t)i * ldc;
+
+            if (accumulate)
+            {
+                for (uint16_t j = 0; j < nr; ++j)
+                {
+                    acc[i][j] += cRow[j];
+                }
+            }
+
+            for (uint16_t j = 0; j < nr; ++j)
+            {
+                cRow[j] = acc[i][j];
+            }
+
+            if (finish)
+            {
+                epilogue(cRow, nr, row + i, 0);
+            }
+        }
+    }
+
+    // Dot product of two contiguous arrays - independent accumulators
+    // break the add dependency chain so the loop can be pipelined
+    // b is converted to T as it is read
+    template<typename T, typename S>
+    inline T dot(const T* a, const S* b, uint64_t len)
+    {
+        T acc0 = (T)0.0;
+        T acc1 = (T)0.0;
+        T acc2 = (T)0.0;
+        T acc3 = (T)0.0;
+
+        uint64_t blocked = len - (len % 4);
+
+        uint64_t i = 0;
+        for (; i < blocked; i += 4)
+        {
+            acc0 += a[i] * (T)b[i];
+            acc1 += a[i + 1] * (T)b[i + 1];
+            acc2 += a[i + 2] * (T)b[i + 2];
+            acc3 += a[i + 3] * (T)b[i + 3];
+        }
+        for (; i < len; ++i)
+        {
+            acc0 += a[i] * (T)b[i];
+        }
+
+        return (acc0 + acc1) + (acc2 + acc3);
+    }
+
+    // C(MxN) = epilogue(A(MxK) * (bScale * B(KxN))) - all row-major and contiguous
+    // B is T, or a compact type converted to T inside the kernel
+    template<typename T, uint16_t M, uint16_t K, uint16_t N, GemmShape shape = gemmShape(M, K, N)>
+    struct Gemm;
+
+    // Matrix * Column Vector - one dot product per row of A
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct Gemm<T, M, K, N, GemmShape::GEMV>
+    {
+        template<typename S, typename Epilogue = Identity<T>>
+        static void run(const T* a, const S* b, T* c, T bScale = (T)1.0, const Epilogue &epilogue = Epilogue())
+        {
+            for (uint32_t row = 0; row < M; ++row)
+            {
+                c[row] = dot(a + (uint64_t)row * K, b, K) * bScale;
+            }
+
+            epilogue(c, M, 0, 1);
+        }
+    };
+
+    // Column Vector * Row Vector - each row of C is a scaled copy of B
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct Gemm<T, M, K, N, GemmShape::OUTER>
+    {
+        template<typename S, typename Epilogue = Identity<T>>
+        static void run(const T* a, const S* b, T* c, T bScale = (T)1.0, const Epilogue &epilogue = Epilogue())
+        {
+            for (uint32_t row = 0; row < M; ++row)
+            {
+                T aVal = a[row] * bScale;
+                T* cRow = c + (uint64_t)row * N;
+
+                for (uint32_t col = 0; col < N; ++col)
+                {
+                    cRow[col] = aVal * (T)b[col];
+                }
+
+                epilogue(cRow, N, row, 0);
+            }
+        }
+    };
+
+    // Row Vector * Matrix - accumulate scaled rows of B so B is read row-wise
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct Gemm<T, M, K, N, GemmShape::VECMAT>
+    {
+        template<typename S, typename Epilogue = Identity<T>>
+        static void run(const T* a, const S* b, T* c, T bScale = (T)1.0, const Epilogue &epilogue = Epilogue())
+        {
+            for (uint32_t col = 0; col < N; ++col)
+            {
+                c[col] = (T)0.0;
+            }
+
+            for (uint32_t k = 0; k < K; ++k)
+            {
+                T aVal = a[k] * bScale;
+                const S* bRow = b + (uint64_t)k * N;
+
+                for (uint32_t col = 0; col < N; ++col)
+                {
+                    c[col] += aVal * (T)bRow[col];
+                }
+            }
+
+            epilogue(c, N, 0, 0);
+        }
+    };
+
+    // General Matrix * Matrix - Goto style blocking
+    //   jc loop: NC wide column blocks of B and C
+    //   pc loop: KC deep slices, B block packed once per slice
+    //   ic loop: MC tall row blocks of A, packed once per slice
+    //   jr/ir loops: MR x NR register tiles handled by the micro-kernel
+    // Transposed operands are transposed by the packing, so the micro-kernel
+    // and the order of every sum are the same as for a plain product
+    template<typename T, uint16_t M, uint16_t K, uint16_t N,
+             Operand aLayout = Operand::NORMAL, Operand bLayout = Operand::NORMAL>
+    struct GemmBlocked
+    {
+        // Block sizes clamped to the problem so small matrices pack tightly
+        static const uint16_t MC = (M < GEMM_MC) ? M : GEMM_MC;
+        static const uint16_t KC = (K < GEMM_KC) ? K : GEMM_KC;
+        static const uint16_t NC = (N < GEMM_NC) ? N : GEMM_NC;
+
+        template<typename S, typename Epilogue = Identity<T>>
+        static void run(const T* a, const S* b, T* c, T bScale = (T)1.0, const Epilogue &epilogue = Epilogue())
+        {
+            const uint16_t NR = GemmTile<T>::NR;
+
+            T* aPacked = packBuffer<T>(0, roundUp(MC, GEMM_MR) * KC);
+            T* bPacked = packBuffer<T>(1, roundUp(NC, NR) * KC);
+
+            for (uint32_t jc = 0; jc < N; jc += NC)
+            {
+                uint16_t nc = minDim(NC, N - jc);
+
+                for (uint32_t pc = 0; pc < K; pc += KC)
+                {
+                    uint16_t kc = minDim(KC, K - pc);
+
+                    if (bLayout == Operand::NORMAL)
+                    {
+                        packB(b + (uint64_t)pc * N + jc, N, kc, nc, bScale, bPacked);
+                    }
+                    else
+                    {
+                        packB<Operand::TRANSPOSED>(b + (uint64_t)jc * K + pc, K, kc, nc, bScale, bPacked);
+                    }
+
+                    for (uint32_t ic = 0; ic < M; ic += MC)
+                    {
+                        uint16_t mc = minDim(MC, M - ic);
+
+                        if (aLayout == Operand::NORMAL)
+                        {
+                            packA(a + (uint64_t)ic * K + pc, K, mc, kc, aPacked);
+                        }
+                        else
+                        {
+                            packA<Operand::TRANSPOSED>(a + (uint64_t)pc * M + ic, M, mc, kc, aPacked);
+                        }
+
+                        for (uint16_t jr = 0; jr < nc; jr += NR)
+                        {
+                            uint16_t nr = minDim(NR, nc - jr);
+
+                            for (uint16_t ir = 0; ir < mc; ir += GEMM_MR)
+                            {
+                                uint16_t mr = minDim(GEMM_MR, mc - ir);
+
+                                microKernel(kc,
+                                            aPacked + (uint64_t)ir * kc,
+                                            bPacked + (uint64_t)jr * kc,
+                                            c + (uint64_t)(ic + ir) * N + jc + jr, N,
+                                            mr, nr,
+                                            pc > 0, pc + kc >= K, ic + ir, epilogue);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    };
+
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct Gemm<T, M, K, N, GemmShape::BLOCKED> : GemmBlocked<T, M, K, N>
+    {
+    };
+
+    // C(MxN) = A^T * B - A is stored K x M and read in place
+    // A vector operand has the same layout as its transpose, so only the
+    // general shape needs a transposing pack
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct GemmTransposedA
+    {
+        static void run(const T* a, const T* b, T* c)
+        {
+            if constexpr (N == 1)
+            {
+                // A^T * b is the row vector b^T * A - accumulates rows of A
+                Gemm<T, 1, K, M>::run(b, a, c);
+            }
+            else if constexpr (M == 1 || K == 1)
+            {
+                Gemm<T, M, K, N>::run(a, b, c);
+            }
+            else
+            {
+                GemmBlocked<T, M, K, N, Operand::TRANSPOSED>::run(a, b, c);
+            }
+        }
+    };
+
+    // C(MxN) = A * B^T - B is stored N x K and read in place
+    template<typename T, uint16_t M, uint16_t K, uint16_t N>
+    struct GemmTransposedB
+    {
+        static void run(const T* a, const T* b, T* c)
+        {
+            if constexpr (M == 1)
+            {
+                // a^T * B^T is the column vector B * a - one dot product per row of B
+                Gemm<T, N, K, 1>::run(b, a, c);
+            }
+            else if constexpr (N == 1 || K == 1)
+            {
+                Gemm<T, M, K, N>::run(a, b, c);
+            }
+            else
+            {
+                GemmBlocked<T, M, K, N, Operand::NORMAL, Operand::TRANSPOSED>::run(a, b, c);
+            }
+        }
+    };
+
+    // Rank-1 update - A(MxN) += scale * x * y^T
+    // Each row of A takes a scaled copy of y, so the outer product is never stored
+    template<typename T>
+    inline void rank1Update(T* a, const T* x, const T* y, T scale, uint32_t rows, uint32_t cols)
+    {
+        for (uint32_t row = 0; row < rows; ++row)
+        {
+            T xVal = x[row] * scale;
+            T* aRow = a + (uint64_t)row * cols;
+
+            for (uint32_t col = 0; col < cols; ++col)
+            {
+                aRow[col] += xVal * y[col];
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,1079 @@
+//-----------------------------------------------------------------------------
+// File: MatrixSimd.h
+// Author: Edward Koch
+// Description: Holds the vectorised element-wise kernels used by the Matrix
+//              Class along with the runtime CPU detection that selects
+//              between the AVX-512, AVX2, SSE2 and scalar implementations
+//
+//              Activations (exp, sigmoid, tanh, GELU) use a range reduced
+//              polynomial exp instead of the C library, at a selectable
+//              accuracy, so they vectorise like the arithmetic kernels
+//
+//              Optimizer updates (momentum, RMSProp, Adam) are fused so the
+//              weights, the step and the running moments are read and
+//              written in a single pass
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Single Precision Kernels
+// E. Koch    10/17/26    VNNI Target for Int8 Kernels
+// E. Koch    10/17/26    Byte Conversion Kernels
+// E. Koch    10/17/26    Fast-math Activation Kernels
+// E. Koch    10/17/26    Fused Optimizer Kernels
+// E. Koch    10/17/26    Named Operation Table Fields
+// E. Koch    10/17/26    GEMM Register Tiles
+//-----------------------------------------------------------------------------
+#ifndef MATRIX_SIMD_H
+#define MATRIX_SIMD_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define MATRIX_SIMD_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define MATRIX_SIMD_X86 0
+#endif
+
+// MSVC compiles any intrinsic without extra flags, GCC and Clang need the
+// target enabled per function so the rest of the program stays baseline
+#if defined(_MSC_VER) && !defined(__clang__)
+#define MATRIX_TARGET_SSE2
+#define MATRIX_TARGET_AVX2
+#define MATRIX_TARGET_AVX512
+#define MATRIX_TARGET_AVX512VNNI
+#else
+#define MATRIX_TARGET_SSE2 __attribute__((target("sse2")))
+#define MATRIX_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define MATRIX_TARGET_AVX512 __attribute__((target("avx512f")))
+#define MATRIX_TARGET_AVX512VNNI __attribute__((target("avx512f,avx512vnni")))
+#endif
+
+// Byte alignment of Matrix storage - one cache line, enough for AVX-512
+#define MATRIX_ALIGNMENT 64
+
+namespace Simd
+{
+    // Instruction sets in increasing order of width
+    enum class Level : uint8_t
+    {
+        SCALAR,
+        SSE2,
+        AVX2,
+        AVX512
+    };
+
+    // Query the widest instruction set supported by both the CPU and the OS
+    inline Level detectLevel()
+    {
+#if MATRIX_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] = { 0 };
+
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+
+        __cpuid(info, 1);
+        bool sse2 = (info[3] & (1 << 26)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        bool fma = (info[2] & (1 << 12)) != 0;
+
+        bool avx2 = false;
+        bool avx512 = false;
+
+        if (maxLeaf >= 7)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+            avx512 = (info[1] & (1 << 16)) != 0;
+        }
+
+        // The OS must save the YMM (and ZMM) state on context switches
+        uint64_t xcr0 = osxsave ? _xgetbv(0) : 0;
+        bool osYmm = (xcr0 & 0x06) == 0x06;
+        bool osZmm = (xcr0 & 0xE6) == 0xE6;
+
+        if (avx512 && osZmm)
+        {
+            return Level::AVX512;
+        }
+        if (avx && avx2 && fma && osYmm)
+        {
+            return Level::AVX2;
+        }
+        if (sse2)
+        {
+            return Level::SSE2;
+        }
+#else
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+        {
+            return Level::AVX512;
+        }
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        {
+            return Level::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return Level::SSE2;
+        }
+#endif
+#endif
+        return Level::SCALAR;
+    }
+
+    // Accuracy of the polynomial activation kernels
+    enum class Accuracy : uint8_t
+    {
+        FAST,       // ~5e-5 relative error in exp (float), ~1e-7 (double)
+        PRECISE     // Within a few ulp of the C library
+    };
+
+    // Element-wise operations on contiguous arrays
+    template<typename T>
+    struct Ops
+    {
+        // a[i] += b[i]
+        void (*add)(T* a, const T* b, uint64_t len);
+
+        // a[i] -= b[i]
+        void (*sub)(T* a, const T* b, uint64_t len);
+
+        // a[i] *= b[i]
+        void (*mul)(T* a, const T* b, uint64_t len);
+
+        // a[i] += value
+        void (*addScalar)(T* a, T value, uint64_t len);
+
+        // a[i] *= value
+        void (*mulScalar)(T* a, T value, uint64_t len);
+
+        // a[i] = value
+        void (*set)(T* a, T value, uint64_t len);
+
+        // a[i] = b[i]
+        void (*copy)(T* a, const T* b, uint64_t len);
+
+        // a[i] = b[i] * scale - widens unsigned bytes such as pixels
+        void (*fromBytes)(T* a, const uint8_t* b, T scale, uint64_t len);
+
+        // a[i] = exp(b[i]) - a may be b
+        void (*exp)(T* a, const T* b, uint64_t len);
+
+        // a[i] = 1 / (1 + exp(-b[i])) - a may be b
+        void (*sigmoid)(T* a, const T* b, uint64_t len);
+
+        // a[i] = tanh(b[i]) - a may be b
+        void (*tanh)(T* a, const T* b, uint64_t len);
+
+        // a[i] = gelu(b[i]) with the tanh approximation - a may be b
+        void (*gelu)(T* a, const T* b, uint64_t len);
+
+        // a[i] = gelu'(b[i]) - from the input, as gelu is not invertible
+        void (*geluDerivative)(T* a, const T* b, uint64_t len);
+
+        // Fused optimizer updates - step is the descent direction (the negative
+        // gradient) and g = step[i] - l2 * w[i] adds weight decay to it
+
+        // velocity[i] = decay * velocity[i] + g, w[i] += velocityRate * velocity[i] + stepRate * g
+        void (*momentum)(T* w, T* velocity, const T* step, T decay, T l2, T velocityRate, T stepRate, uint64_t len);
+
+        // meanSquare[i] = decay * meanSquare[i] + (1 - decay) * g^2
+        // w[i] += rate * g / (sqrt(meanSquare[i]) + epsilon)
+        void (*rmsProp)(T* w, T* meanSquare, const T* step, T decay, T rate, T epsilon, T l2, uint64_t len);
+
+        // mean[i] = beta1 * mean[i] + (1 - beta1) * g, meanSquare[i] = beta2 * meanSquare[i] + (1 - beta2) * g^2
+        // w[i] = weightScale * w[i] + rate * mean[i] / (sqrt(meanSquare[i]) + epsilon)
+        void (*adam)(T* w, T* mean, T* meanSquare, const T* step, T beta1, T beta2, T rate, T epsilon, T l2, T weightScale, uint64_t len);
+
+        // acc = the GEMM_MR x NR tile of packed A panel * packed B panel over kc
+        // NR = GEMM_NR_BYTES / sizeof(T), acc is row major with NR columns
+        void (*gemmTile)(T* acc, const T* aPanel, const T* bPanel, uint64_t kc);
+
+        // Instruction set these operations were built for
+        Level level;
+
+        // Accuracy the activation kernels were built for
+        Accuracy accuracy;
+    };
+
+    ///////////////////////
+    // Kernel Generation //
+    ///////////////////////
+    // Stamps out the element-wise kernels for one instruction set
+    // Full vectors are processed first and the remainder falls back to scalar
+#define MATRIX_SIMD_KERNELS(ISA, TARGET, T, REG, WIDTH, LOAD, STORE, SET1, ADD, SUB, MUL)  \
+    TARGET inline void add##ISA(T* a, const T* b, uint64_t len)                             \
+    {                                                                                       \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, ADD(LOAD(a + i), LOAD(b + i)));                                    \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] += b[i];                                                                   \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void sub##ISA(T* a, const T* b, uint64_t len)                             \
+    {                                                                                       \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, SUB(LOAD(a + i), LOAD(b + i)));                                    \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] -= b[i];                                                                   \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void mul##ISA(T* a, const T* b, uint64_t len)                             \
+    {                                                                                       \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, MUL(LOAD(a + i), LOAD(b + i)));                                    \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] *= b[i];                                                                   \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void addScalar##ISA(T* a, T value, uint64_t len)                          \
+    {                                                                                       \
+        REG v = SET1(value);                                                                \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, ADD(LOAD(a + i), v));                                              \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] += value;                                                                  \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void mulScalar##ISA(T* a, T value, uint64_t len)                          \
+    {                                                                                       \
+        REG v = SET1(value);                                                                \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, MUL(LOAD(a + i), v));                                              \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] *= value;                                                                  \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void set##ISA(T* a, T value, uint64_t len)                                \
+    {                                                                                       \
+        REG v = SET1(value);                                                                \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, v);                                                                \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] = value;                                                                   \
+        }                                                                                   \
+    }                                                                                       \
+    TARGET inline void copy##ISA(T* a, const T* b, uint64_t len)                            \
+    {                                                                                       \
+        uint64_t i = 0;                                                                     \
+        for (; i + WIDTH <= len; i += WIDTH)                                                \
+        {                                                                                   \
+            STORE(a + i, LOAD(b + i));                                                      \
+        }                                                                                   \
+        for (; i < len; ++i)                                                                \
+        {                                                                                   \
+            a[i] = b[i];                                                                    \
+        }                                                                                   \
+    }
+
+    // Identity helpers so the scalar fallback can share the generator
+    template<typename T> inline T scalarLoad(const T* p) { return *p; }
+    template<typename T> inline void scalarStore(T* p, T v) { *p = v; }
+    template<typename T> inline T scalarSet1(T v) { return v; }
+    template<typename T> inline T scalarAdd(T a, T b) { return a + b; }
+    template<typename T> inline T scalarSub(T a, T b) { return a - b; }
+    template<typename T> inline T scalarMul(T a, T b) { return a * b; }
+
+    // Each generated kernel is overloaded on the element type
+    MATRIX_SIMD_KERNELS(Generic, , double_t, double_t, 1,
+                        scalarLoad, scalarStore, scalarSet1, scalarAdd, scalarSub, scalarMul)
+
+    MATRIX_SIMD_KERNELS(Generic, , float, float, 1,
+                        scalarLoad, scalarStore, scalarSet1, scalarAdd, scalarSub, scalarMul)
+
+#if MATRIX_SIMD_X86
+    // Unaligned loads and stores - as fast as aligned ones on aligned data,
+    // and still correct for arrays that are not owned by a Matrix
+    MATRIX_SIMD_KERNELS(Sse2, MATRIX_TARGET_SSE2, double_t, __m128d, 2,
+                        _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd)
+
+    MATRIX_SIMD_KERNELS(Avx2, MATRIX_TARGET_AVX2, double_t, __m256d, 4,
+                        _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd)
+
+    MATRIX_SIMD_KERNELS(Avx512, MATRIX_TARGET_AVX512, double_t, __m512d, 8,
+                        _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd, _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd)
+
+    MATRIX_SIMD_KERNELS(Sse2, MATRIX_TARGET_SSE2, float, __m128, 4,
+                        _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps)
+
+    MATRIX_SIMD_KERNELS(Avx2, MATRIX_TARGET_AVX2, float, __m256, 8,
+                        _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps)
+
+    MATRIX_SIMD_KERNELS(Avx512, MATRIX_TARGET_AVX512, float, __m512, 16,
+                        _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps, _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps)
+#endif
+
+#undef MATRIX_SIMD_KERNELS
+
+    ///////////////////////
+    // Byte Conversion   //
+    ///////////////////////
+    // Widening needs different shuffles per instruction set and element type,
+    // so these kernels are written out rather than generated
+    template<typename T>
+    inline void fromBytesGeneric(T* a, const uint8_t* b, T scale, uint64_t len)
+    {
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            a[i] = (T)b[i] * scale;
+        }
+    }
+
+#if MATRIX_SIMD_X86
+    // SSE2 has no zero extending moves - bytes are unpacked against zero instead
+    MATRIX_TARGET_SSE2 inline void fromBytesSse2(double_t* a, const uint8_t* b, double_t scale, uint64_t len)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128d v = _mm_set1_pd(scale);
+
+        uint64_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            __m128i shorts = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + i)), zero);
+            __m128i low = _mm_unpacklo_epi16(shorts, zero);
+            __m128i high = _mm_unpackhi_epi16(shorts, zero);
+
+            _mm_storeu_pd(a + i, _mm_mul_pd(_mm_cvtepi32_pd(low), v));
+            _mm_storeu_pd(a + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(low, 8)), v));
+            _mm_storeu_pd(a + i + 4, _mm_mul_pd(_mm_cvtepi32_pd(high), v));
+            _mm_storeu_pd(a + i + 6, _mm_mul_pd(_mm_cvtepi32_pd(_mm_srli_si128(high, 8)), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+
+    MATRIX_TARGET_SSE2 inline void fromBytesSse2(float* a, const uint8_t* b, float scale, uint64_t len)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        __m128 v = _mm_set1_ps(scale);
+
+        uint64_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            __m128i shorts = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(b + i)), zero);
+
+            _mm_storeu_ps(a + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(shorts, zero)), v));
+            _mm_storeu_ps(a + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(shorts, zero)), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+
+    MATRIX_TARGET_AVX2 inline void fromBytesAvx2(double_t* a, const uint8_t* b, double_t scale, uint64_t len)
+    {
+        __m256d v = _mm256_set1_pd(scale);
+
+        uint64_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            __m256i ints = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(b + i)));
+
+            _mm256_storeu_pd(a + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(ints)), v));
+            _mm256_storeu_pd(a + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(ints, 1)), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+
+    MATRIX_TARGET_AVX2 inline void fromBytesAvx2(float* a, const uint8_t* b, float scale, uint64_t len)
+    {
+        __m256 v = _mm256_set1_ps(scale);
+
+        uint64_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            __m256i ints = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(b + i)));
+
+            _mm256_storeu_ps(a + i, _mm256_mul_ps(_mm256_cvtepi32_ps(ints), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+
+    MATRIX_TARGET_AVX512 inline void fromBytesAvx512(double_t* a, const uint8_t* b, double_t scale, uint64_t len)
+    {
+        __m512d v = _mm512_set1_pd(scale);
+
+        uint64_t i = 0;
+        for (; i + 8 <= len; i += 8)
+        {
+            __m256i ints = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(b + i)));
+
+            _mm512_storeu_pd(a + i, _mm512_mul_pd(_mm512_cvtepi32_pd(ints), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+
+    MATRIX_TARGET_AVX512 inline void fromBytesAvx512(float* a, const uint8_t* b, float scale, uint64_t len)
+    {
+        __m512 v = _mm512_set1_ps(scale);
+
+        uint64_t i = 0;
+        for (; i + 16 <= len; i += 16)
+        {
+            __m512i ints = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*)(b + i)));
+
+            _mm512_storeu_ps(a + i, _mm512_mul_ps(_mm512_cvtepi32_ps(ints), v));
+        }
+        fromBytesGeneric(a + i, b + i, scale, len - i);
+    }
+#endif
+
+    ///////////////////////
+    // Activations       //
+    ///////////////////////
+    // exp(x) = 2^n * e^r with n = round(x / ln2) and |r| <= ln2 / 2
+    // e^r is a Taylor polynomial whose degree sets the accuracy, 2^n is
+    // built directly in the exponent bits, so only add, multiply and shift
+    // are needed and every instruction set shares one generator
+    constexpr double_t inverseFactorial(int k)
+    {
+        return (k <= 1) ? 1.0 : inverseFactorial(k - 1) / (double_t)k;
+    }
+
+    template<typename T>
+    struct ExpConstants;
+
+    template<>
+    struct ExpConstants<float>
+    {
+        // Inputs are clamped so 2^n stays a normal number
+        static constexpr float MIN_INPUT = -87.0f;
+        static constexpr float MAX_INPUT = 88.0f;
+
+        static constexpr float LOG2E = 1.44269504088896341f;
+
+        // ln2 split so n * LN2_HIGH is exact
+        static constexpr float LN2_HIGH = 0.693359375f;
+        static constexpr float LN2_LOW = -2.12194440e-4f;
+
+        // Adding 1.5 * 2^23 rounds to an integer in the low mantissa bits
+        static constexpr float SHIFTER = 12582912.0f;
+
+        // n plus 2^23 + 127 leaves the biased exponent in the low mantissa bits
+        static constexpr float EXPONENT_BIAS = 8388735.0f;
+
+        // Taylor coefficients of e^r - 1 / k!
+        static constexpr float TAYLOR[7] = { (float)inverseFactorial(0), (float)inverseFactorial(1), (float)inverseFactorial(2),
+                                             (float)inverseFactorial(3), (float)inverseFactorial(4), (float)inverseFactorial(5),
+                                             (float)inverseFactorial(6) };
+    };
+
+    template<>
+    struct ExpConstants<double_t>
+    {
+        static constexpr double_t MIN_INPUT = -708.0;
+        static constexpr double_t MAX_INPUT = 709.0;
+
+        static constexpr double_t LOG2E = 1.44269504088896338700;
+
+        static constexpr double_t LN2_HIGH = 6.93147180369123816490e-01;
+        static constexpr double_t LN2_LOW = 1.90821492927058770002e-10;
+
+        // 1.5 * 2^52
+        static constexpr double_t SHIFTER = 6755399441055744.0;
+
+        // 2^52 + 1023
+        static constexpr double_t EXPONENT_BIAS = 4503599627371519.0;
+
+        static constexpr double_t TAYLOR[13] = { inverseFactorial(0), inverseFactorial(1), inverseFactorial(2),
+                                                 inverseFactorial(3), inverseFactorial(4), inverseFactorial(5),
+                                                 inverseFactorial(6), inverseFactorial(7), inverseFactorial(8),
+                                                 inverseFactorial(9), inverseFactorial(10), inverseFactorial(11),
+                                                 inverseFactorial(12) };
+    };
+
+    // Degree of the e^r polynomial - the truncation error is r^(d+1) / (d+1)!
+    template<typename T>
+    constexpr int expDegree(Accuracy accuracy)
+    {
+        return (sizeof(T) == sizeof(float)) ? ((accuracy == Accuracy::FAST) ? 4 : 6)
+                                            : ((accuracy == Accuracy::FAST) ? 6 : 12);
+    }
+
+    // GELU tanh approximation - x * sigmoid(x * (GELU_LINEAR + GELU_CUBIC * x^2))
+    // GELU_LINEAR = 2 * sqrt(2 / pi), GELU_CUBIC = GELU_LINEAR * 0.044715
+    const double_t GELU_LINEAR = 1.5957691216057308;
+    const double_t GELU_CUBIC = 0.0713548162726009;
+
+    // Scalar helpers for the generic activations
+    template<typename T> inline T scalarDiv(T a, T b) { return a / b; }
+    template<typename T> inline T scalarMin(T a, T b) { return (a < b) ? a : b; }
+    template<typename T> inline T scalarMax(T a, T b) { return (a > b) ? a : b; }
+    template<typename T> inline T fmaddGeneric(T a, T b, T c) { return a * b + c; }
+
+    // 2^n from n + EXPONENT_BIAS - shifts the biased exponent into place
+    inline float pow2Generic(float biased)
+    {
+        uint32_t bits;
+        memcpy(&bits, &biased, sizeof(bits));
+        bits <<= 23;
+
+        float result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    inline double_t pow2Generic(double_t biased)
+    {
+        uint64_t bits;
+        memcpy(&bits, &biased, sizeof(bits));
+        bits <<= 52;
+
+        double_t result;
+        memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+#if MATRIX_SIMD_X86
+    // SSE2 has no fused multiply-add
+    MATRIX_TARGET_SSE2 inline __m128 fmaddSse2(__m128 a, __m128 b, __m128 c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    MATRIX_TARGET_SSE2 inline __m128d fmaddSse2(__m128d a, __m128d b, __m128d c) { return _mm_add_pd(_mm_mul_pd(a, b), c); }
+    MATRIX_TARGET_AVX2 inline __m256 fmaddAvx2(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+    MATRIX_TARGET_AVX2 inline __m256d fmaddAvx2(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+    MATRIX_TARGET_AVX512 inline __m512 fmaddAvx512(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+    MATRIX_TARGET_AVX512 inline __m512d fmaddAvx512(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+
+    MATRIX_TARGET_SSE2 inline __m128 pow2Sse2(__m128 biased) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(biased), 23)); }
+    MATRIX_TARGET_SSE2 inline __m128d pow2Sse2(__m128d biased) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(biased), 52)); }
+    MATRIX_TARGET_AVX2 inline __m256 pow2Avx2(__m256 biased) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(biased), 23)); }
+    MATRIX_TARGET_AVX2 inline __m256d pow2Avx2(__m256d biased) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52)); }
+    MATRIX_TARGET_AVX512 inline __m512 pow2Avx512(__m512 biased) { return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_castps_si512(biased), 23)); }
+    MATRIX_TARGET_AVX512 inline __m512d pow2Avx512(__m512d biased) { return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(biased), 52)); }
+#endif
+
+    // Stamps out the activation kernels for one instruction set
+    // expVector is shared by every kernel, the scalar remainder uses the
+    // generic expVector so the whole array gets the same approximation
+    // tanh(x) = expm1(2x) / (expm1(2x) + 2) - e^r - 1 is summed without its
+    // constant term, so small |x| keeps its precision instead of cancelling
+    // The input clamp passes x second - x86 min and max return their second
+    // operand when either is NaN, so a NaN input stays NaN on every ISA
+#define MATRIX_SIMD_ACTIVATIONS(ISA, TARGET, T, REG, WIDTH, LOAD, STORE, SET1, ADD, SUB, MUL, DIV, MIN, MAX)  \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG expVector##ISA(REG x)                                                             \
+    {                                                                                                   \
+        typedef ExpConstants<T> C;                                                                      \
+        x = MIN(SET1(C::MAX_INPUT), MAX(SET1(C::MIN_INPUT), x));                                        \
+        REG n = SUB(fmadd##ISA(x, SET1(C::LOG2E), SET1(C::SHIFTER)), SET1(C::SHIFTER));                 \
+        REG r = fmadd##ISA(n, SET1(-C::LN2_HIGH), x);                                                   \
+        r = fmadd##ISA(n, SET1(-C::LN2_LOW), r);                                                        \
+        REG p = SET1(C::TAYLOR[expDegree<T>(accuracy)]);                                                \
+        for (int k = expDegree<T>(accuracy) - 1; k >= 0; --k)                                           \
+        {                                                                                               \
+            p = fmadd##ISA(p, r, SET1(C::TAYLOR[k]));                                                   \
+        }                                                                                               \
+        return MUL(p, pow2##ISA(ADD(n, SET1(C::EXPONENT_BIAS))));                                       \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG expm1Vector##ISA(REG x)                                                           \
+    {                                                                                                   \
+        typedef ExpConstants<T> C;                                                                      \
+        x = MIN(SET1(C::MAX_INPUT), MAX(SET1(C::MIN_INPUT), x));                                        \
+        REG n = SUB(fmadd##ISA(x, SET1(C::LOG2E), SET1(C::SHIFTER)), SET1(C::SHIFTER));                 \
+        REG r = fmadd##ISA(n, SET1(-C::LN2_HIGH), x);                                                   \
+        r = fmadd##ISA(n, SET1(-C::LN2_LOW), r);                                                        \
+        REG p = SET1(C::TAYLOR[expDegree<T>(accuracy)]);                                                \
+        for (int k = expDegree<T>(accuracy) - 1; k >= 1; --k)                                           \
+        {                                                                                               \
+            p = fmadd##ISA(p, r, SET1(C::TAYLOR[k]));                                                   \
+        }                                                                                               \
+        REG scale = pow2##ISA(ADD(n, SET1(C::EXPONENT_BIAS)));                                          \
+        return fmadd##ISA(scale, MUL(p, r), SUB(scale, SET1((T)1.0)));                                  \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG sigmoidVector##ISA(REG x)                                                         \
+    {                                                                                                   \
+        REG one = SET1((T)1.0);                                                                         \
+        return DIV(one, ADD(one, expVector##ISA<accuracy>(SUB(SET1((T)0.0), x))));                      \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG tanhVector##ISA(REG x)                                                            \
+    {                                                                                                   \
+        REG e = expm1Vector##ISA<accuracy>(ADD(x, x));                                                  \
+        return DIV(e, ADD(e, SET1((T)2.0)));                                                            \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG geluVector##ISA(REG x)                                                            \
+    {                                                                                                   \
+        REG u = MUL(x, fmadd##ISA(MUL(x, x), SET1((T)GELU_CUBIC), SET1((T)GELU_LINEAR)));               \
+        return MUL(x, sigmoidVector##ISA<accuracy>(u));                                                 \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline REG geluDerivativeVector##ISA(REG x)                                                  \
+    {                                                                                                   \
+        REG one = SET1((T)1.0);                                                                         \
+        REG x2 = MUL(x, x);                                                                             \
+        REG s = sigmoidVector##ISA<accuracy>(MUL(x, fmadd##ISA(x2, SET1((T)GELU_CUBIC), SET1((T)GELU_LINEAR)))); \
+        REG du = fmadd##ISA(x2, SET1((T)(3.0 * GELU_CUBIC)), SET1((T)GELU_LINEAR));                     \
+        return fmadd##ISA(MUL(MUL(x, s), SUB(one, s)), du, s);                                          \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline void exp##ISA(T* a, const T* b, uint64_t len)                                         \
+    {                                                                                                   \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            STORE(a + i, expVector##ISA<accuracy>(LOAD(b + i)));                                        \
+        }                                                                                               \
+        for (; i < len; ++i)                                                                            \
+        {                                                                                               \
+            a[i] = expVectorGeneric<accuracy>(b[i]);                                                    \
+        }                                                                                               \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline void sigmoid##ISA(T* a, const T* b, uint64_t len)                                     \
+    {                                                                                                   \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            STORE(a + i, sigmoidVector##ISA<accuracy>(LOAD(b + i)));                                    \
+        }                                                                                               \
+        for (; i < len; ++i)                                                                            \
+        {                                                                                               \
+            a[i] = sigmoidVectorGeneric<accuracy>(b[i]);                                                \
+        }                                                                                               \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline void tanh##ISA(T* a, const T* b, uint64_t len)                                        \
+    {                                                                                                   \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            STORE(a + i, tanhVector##ISA<accuracy>(LOAD(b + i)));                                       \
+        }                                                                                               \
+        for (; i < len; ++i)                                                                            \
+        {                                                                                               \
+            a[i] = tanhVectorGeneric<accuracy>(b[i]);                                                   \
+        }                                                                                               \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline void gelu##ISA(T* a, const T* b, uint64_t len)                                        \
+    {                                                                                                   \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            STORE(a + i, geluVector##ISA<accuracy>(LOAD(b + i)));                                       \
+        }                                                                                               \
+        for (; i < len; ++i)                                                                            \
+        {                                                                                               \
+            a[i] = geluVectorGeneric<accuracy>(b[i]);                                                   \
+        }                                                                                               \
+    }                                                                                                   \
+    template<Accuracy accuracy>                                                                         \
+    TARGET inline void geluDerivative##ISA(T* a, const T* b, uint64_t len)                              \
+    {                                                                                                   \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            STORE(a + i, geluDerivativeVector##ISA<accuracy>(LOAD(b + i)));                             \
+        }                                                                                               \
+        for (; i < len; ++i)                                                                            \
+        {                                                                                               \
+            a[i] = geluDerivativeVectorGeneric<accuracy>(b[i]);                                         \
+        }                                                                                               \
+    }
+
+    MATRIX_SIMD_ACTIVATIONS(Generic, , double_t, double_t, 1,
+                            scalarLoad, scalarStore, scalarSet1, scalarAdd, scalarSub, scalarMul, scalarDiv, scalarMin, scalarMax)
+
+    MATRIX_SIMD_ACTIVATIONS(Generic, , float, float, 1,
+                            scalarLoad, scalarStore, scalarSet1, scalarAdd, scalarSub, scalarMul, scalarDiv, scalarMin, scalarMax)
+
+#if MATRIX_SIMD_X86
+    MATRIX_SIMD_ACTIVATIONS(Sse2, MATRIX_TARGET_SSE2, double_t, __m128d, 2,
+                            _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd, _mm_add_pd, _mm_sub_pd, _mm_mul_pd, _mm_div_pd, _mm_min_pd, _mm_max_pd)
+
+    MATRIX_SIMD_ACTIVATIONS(Avx2, MATRIX_TARGET_AVX2, double_t, __m256d, 4,
+                            _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd, _mm256_div_pd, _mm256_min_pd, _mm256_max_pd)
+
+    MATRIX_SIMD_ACTIVATIONS(Avx512, MATRIX_TARGET_AVX512, double_t, __m512d, 8,
+                            _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd, _mm512_add_pd, _mm512_sub_pd, _mm512_mul_pd, _mm512_div_pd, _mm512_min_pd, _mm512_max_pd)
+
+    MATRIX_SIMD_ACTIVATIONS(Sse2, MATRIX_TARGET_SSE2, float, __m128, 4,
+                            _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_sub_ps, _mm_mul_ps, _mm_div_ps, _mm_min_ps, _mm_max_ps)
+
+    MATRIX_SIMD_ACTIVATIONS(Avx2, MATRIX_TARGET_AVX2, float, __m256, 8,
+                            _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_sub_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_min_ps, _mm256_max_ps)
+
+    MATRIX_SIMD_ACTIVATIONS(Avx512, MATRIX_TARGET_AVX512, float, __m512, 16,
+                            _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps, _mm512_add_ps, _mm512_sub_ps, _mm512_mul_ps, _mm512_div_ps, _mm512_min_ps, _mm512_max_ps)
+#endif
+
+#undef MATRIX_SIMD_ACTIVATIONS
+
+    ///////////////////////
+    // Optimizers        //
+    ///////////////////////
+    // Every update reads the weights, the step and the moments once and writes
+    // the weights and moments once - the memory traffic of the update, rather
+    // than its arithmetic, bounds it
+    inline float scalarSqrt(float a) { return sqrtf(a); }
+    inline double_t scalarSqrt(double_t a) { return sqrt(a); }
+
+    template<typename T>
+    inline void momentumGeneric(T* w, T* velocity, const T* step, T decay, T l2, T velocityRate, T stepRate, uint64_t len)
+    {
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            T g = step[i] - l2 * w[i];
+            velocity[i] = decay * velocity[i] + g;
+            w[i] += velocityRate * velocity[i] + stepRate * g;
+        }
+    }
+
+    template<typename T>
+    inline void rmsPropGeneric(T* w, T* meanSquare, const T* step, T decay, T rate, T epsilon, T l2, uint64_t len)
+    {
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            T g = step[i] - l2 * w[i];
+            meanSquare[i] = decay * meanSquare[i] + ((T)1.0 - decay) * g * g;
+            w[i] += rate * g / (scalarSqrt(meanSquare[i]) + epsilon);
+        }
+    }
+
+    template<typename T>
+    inline void adamGeneric(T* w, T* mean, T* meanSquare, const T* step, T beta1, T beta2, T rate, T epsilon, T l2, T weightScale, uint64_t len)
+    {
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            T g = step[i] - l2 * w[i];
+            mean[i] = beta1 * mean[i] + ((T)1.0 - beta1) * g;
+            meanSquare[i] = beta2 * meanSquare[i] + ((T)1.0 - beta2) * g * g;
+            w[i] = weightScale * w[i] + rate * mean[i] / (scalarSqrt(meanSquare[i]) + epsilon);
+        }
+    }
+
+#if MATRIX_SIMD_X86
+    // Stamps out the optimizer kernels for one instruction set
+    // The remainder falls back to the generic kernels
+#define MATRIX_SIMD_OPTIMIZERS(ISA, TARGET, T, REG, WIDTH, LOAD, STORE, SET1, ADD, MUL, DIV, SQRT)    \
+    TARGET inline void momentum##ISA(T* w, T* velocity, const T* step, T decay, T l2, T velocityRate, T stepRate, uint64_t len) \
+    {                                                                                                   \
+        REG vDecay = SET1(decay);                                                                       \
+        REG vNegativeL2 = SET1(-l2);                                                                    \
+        REG vVelocityRate = SET1(velocityRate);                                                         \
+        REG vStepRate = SET1(stepRate);                                                                 \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            REG weights = LOAD(w + i);                                                                  \
+            REG g = fmadd##ISA(vNegativeL2, weights, LOAD(step + i));                                   \
+            REG v = fmadd##ISA(vDecay, LOAD(velocity + i), g);                                          \
+            STORE(velocity + i, v);                                                                     \
+            STORE(w + i, fmadd##ISA(vStepRate, g, fmadd##ISA(vVelocityRate, v, weights)));              \
+        }                                                                                               \
+        momentumGeneric(w + i, velocity + i, step + i, decay, l2, velocityRate, stepRate, len - i);     \
+    }                                                                                                   \
+    TARGET inline void rmsProp##ISA(T* w, T* meanSquare, const T* step, T decay, T rate, T epsilon, T l2, uint64_t len) \
+    {                                                                                                   \
+        REG vDecay = SET1(decay);                                                                       \
+        REG vGain = SET1((T)1.0 - decay);                                                               \
+        REG vRate = SET1(rate);                                                                         \
+        REG vEpsilon = SET1(epsilon);                                                                   \
+        REG vNegativeL2 = SET1(-l2);                                                                    \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            REG weights = LOAD(w + i);                                                                  \
+            REG g = fmadd##ISA(vNegativeL2, weights, LOAD(step + i));                                   \
+            REG s = fmadd##ISA(vDecay, LOAD(meanSquare + i), MUL(vGain, MUL(g, g)));                    \
+            STORE(meanSquare + i, s);                                                                   \
+            STORE(w + i, fmadd##ISA(vRate, DIV(g, ADD(SQRT(s), vEpsilon)), weights));                   \
+        }                                                                                               \
+        rmsPropGeneric(w + i, meanSquare + i, step + i, decay, rate, epsilon, l2, len - i);             \
+    }                                                                                                   \
+    TARGET inline void adam##ISA(T* w, T* mean, T* meanSquare, const T* step, T beta1, T beta2, T rate, T epsilon, T l2, T weightScale, uint64_t len) \
+    {                                                                                                   \
+        REG vBeta1 = SET1(beta1);                                                                       \
+        REG vGain1 = SET1((T)1.0 - beta1);                                                              \
+        REG vBeta2 = SET1(beta2);                                                                       \
+        REG vGain2 = SET1((T)1.0 - beta2);                                                              \
+        REG vRate = SET1(rate);                                                                         \
+        REG vEpsilon = SET1(epsilon);                                                                   \
+        REG vNegativeL2 = SET1(-l2);                                                                    \
+        REG vWeightScale = SET1(weightScale);                                                           \
+        uint64_t i = 0;                                                                                 \
+        for (; i + WIDTH <= len; i += WIDTH)                                                            \
+        {                                                                                               \
+            REG weights = LOAD(w + i);                                                                  \
+            REG g = fmadd##ISA(vNegativeL2, weights, LOAD(step + i));                                   \
+            REG m = fmadd##ISA(vBeta1, LOAD(mean + i), MUL(vGain1, g));                                 \
+            REG s = fmadd##ISA(vBeta2, LOAD(meanSquare + i), MUL(vGain2, MUL(g, g)));                   \
+            STORE(mean + i, m);                                                                         \
+            STORE(meanSquare + i, s);                                                                   \
+            STORE(w + i, fmadd##ISA(vRate, DIV(m, ADD(SQRT(s), vEpsilon)), MUL(vWeightScale, weights))); \
+        }                                                                                               \
+        adamGeneric(w + i, mean + i, meanSquare + i, step + i, beta1, beta2, rate, epsilon, l2, weightScale, len - i); \
+    }
+
+    MATRIX_SIMD_OPTIMIZERS(Sse2, MATRIX_TARGET_SSE2, double_t, __m128d, 2,
+                           _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd, _mm_add_pd, _mm_mul_pd, _mm_div_pd, _mm_sqrt_pd)
+
+    MATRIX_SIMD_OPTIMIZERS(Avx2, MATRIX_TARGET_AVX2, double_t, __m256d, 4,
+                           _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd, _mm256_mul_pd, _mm256_div_pd, _mm256_sqrt_pd)
+
+    MATRIX_SIMD_OPTIMIZERS(Avx512, MATRIX_TARGET_AVX512, double_t, __m512d, 8,
+                           _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd, _mm512_add_pd, _mm512_mul_pd, _mm512_div_pd, _mm512_sqrt_pd)
+
+    MATRIX_SIMD_OPTIMIZERS(Sse2, MATRIX_TARGET_SSE2, float, __m128, 4,
+                           _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps, _mm_mul_ps, _mm_div_ps, _mm_sqrt_ps)
+
+    MATRIX_SIMD_OPTIMIZERS(Avx2, MATRIX_TARGET_AVX2, float, __m256, 8,
+                           _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps, _mm256_mul_ps, _mm256_div_ps, _mm256_sqrt_ps)
+
+    MATRIX_SIMD_OPTIMIZERS(Avx512, MATRIX_TARGET_AVX512, float, __m512, 16,
+                           _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps, _mm512_add_ps, _mm512_mul_ps, _mm512_div_ps, _mm512_sqrt_ps)
+
+#undef MATRIX_SIMD_OPTIMIZERS
+#endif
+
+    ///////////////////////
+    // GEMM Tiles        //
+    ///////////////////////
+    // Register tile of the blocked GEMM - GEMM_MR rows of one cache line of columns
+    const uint16_t GEMM_MR = 4;
+    const uint16_t GEMM_NR_BYTES = 64;
+
+    // acc[i][j] = sum over k of aPanel[k][i] * bPanel[k][j] for an MR x NR tile
+    // from packed panels - plain loops left for the compiler to vectorise
+    template<typename T>
+    inline void gemmTileGeneric(T* acc, const T* aPanel, const T* bPanel, uint64_t kc)
+    {
+        const uint16_t NR = GEMM_NR_BYTES / sizeof(T);
+
+        for (uint16_t i = 0; i < GEMM_MR * NR; ++i)
+        {
+            acc[i] = (T)0.0;
+        }
+
+        for (uint64_t k = 0; k < kc; ++k)
+        {
+            for (uint16_t i = 0; i < GEMM_MR; ++i)
+            {
+                T aVal = aPanel[i];
+
+                for (uint16_t j = 0; j < NR; ++j)
+                {
+                    acc[i * NR + j] += aVal * bPanel[j];
+                }
+            }
+            aPanel += GEMM_MR;
+            bPanel += NR;
+        }
+    }
+
+#if MATRIX_SIMD_X86
+    // Stamps out the GEMM tile for one instruction set
+    // The accumulators are named registers rather than an array, so they stay
+    // in registers whatever the optimization level - one register of columns
+    // at a time, with even and odd k in separate accumulators to hide the
+    // latency of the multiply-add, eight live accumulators on every target
+#define MATRIX_SIMD_GEMM(ISA, TARGET, T, REG, WIDTH, LOAD, STORE, SET1, ADD)                      \
+    TARGET inline void gemmTile##ISA(T* acc, const T* aPanel, const T* bPanel, uint64_t kc)     \
+    {                                                                                           \
+        const uint16_t NR = GEMM_NR_BYTES / sizeof(T);                                          \
+        for (uint16_t j = 0; j < NR; j += WIDTH)                                                \
+        {                                                                                       \
+            const T* a = aPanel;                                                                \
+            const T* b = bPanel + j;                                                            \
+            REG even0 = SET1((T)0.0), even1 = even0, even2 = even0, even3 = even0;              \
+            REG odd0 = even0, odd1 = even0, odd2 = even0, odd3 = even0;                         \
+            uint64_t k = 0;                                                                     \
+            for (; k + 2 <= kc; k += 2)                                                         \
+            {                                                                                   \
+                REG bEven = LOAD(b);                                                            \
+                REG bOdd = LOAD(b + NR);                                                        \
+                even0 = fmadd##ISA(SET1(a[0]), bEven, even0);                                   \
+                even1 = fmadd##ISA(SET1(a[1]), bEven, even1);                                   \
+                even2 = fmadd##ISA(SET1(a[2]), bEven, even2);                                   \
+                even3 = fmadd##ISA(SET1(a[3]), bEven, even3);                                   \
+                odd0 = fmadd##ISA(SET1(a[GEMM_MR + 0]), bOdd, odd0);                            \
+                odd1 = fmadd##ISA(SET1(a[GEMM_MR + 1]), bOdd, odd1);                            \
+                odd2 = fmadd##ISA(SET1(a[GEMM_MR + 2]), bOdd, odd2);                            \
+                odd3 = fmadd##ISA(SET1(a[GEMM_MR + 3]), bOdd, odd3);                            \
+                a += 2 * GEMM_MR;                                                               \
+                b += 2 * NR;                                                                    \
+            }                                                                                   \
+            if (k < kc)                                                                         \
+            {                                                                                   \
+                REG bEven = LOAD(b);                                                            \
+                even0 = fmadd##ISA(SET1(a[0]), bEven, even0);                                   \
+                even1 = fmadd##ISA(SET1(a[1]), bEven, even1);                                   \
+                even2 = fmadd##ISA(SET1(a[2]), bEven, even2);                                   \
+                even3 = fmadd##ISA(SET1(a[3]), bEven, even3);                                   \
+            }                                                                                   \
+            STORE(acc + 0 * NR + j, ADD(even0, odd0));                                          \
+            STORE(acc + 1 * NR + j, ADD(even1, odd1));                                          \
+            STORE(acc + 2 * NR + j, ADD(even2, odd2));                                          \
+            STORE(acc + 3 * NR + j, ADD(even3, odd3));                                          \
+        }                                                                                       \
+    }
+
+    MATRIX_SIMD_GEMM(Sse2, MATRIX_TARGET_SSE2, double_t, __m128d, 2,
+                     _mm_loadu_pd, _mm_storeu_pd, _mm_set1_pd, _mm_add_pd)
+
+    MATRIX_SIMD_GEMM(Avx2, MATRIX_TARGET_AVX2, double_t, __m256d, 4,
+                     _mm256_loadu_pd, _mm256_storeu_pd, _mm256_set1_pd, _mm256_add_pd)
+
+    MATRIX_SIMD_GEMM(Avx512, MATRIX_TARGET_AVX512, double_t, __m512d, 8,
+                     _mm512_loadu_pd, _mm512_storeu_pd, _mm512_set1_pd, _mm512_add_pd)
+
+    MATRIX_SIMD_GEMM(Sse2, MATRIX_TARGET_SSE2, float, __m128, 4,
+                     _mm_loadu_ps, _mm_storeu_ps, _mm_set1_ps, _mm_add_ps)
+
+    MATRIX_SIMD_GEMM(Avx2, MATRIX_TARGET_AVX2, float, __m256, 8,
+                     _mm256_loadu_ps, _mm256_storeu_ps, _mm256_set1_ps, _mm256_add_ps)
+
+    MATRIX_SIMD_GEMM(Avx512, MATRIX_TARGET_AVX512, float, __m512, 16,
+                     _mm512_loadu_ps, _mm512_storeu_ps, _mm512_set1_ps, _mm512_add_ps)
+
+#undef MATRIX_SIMD_GEMM
+#endif
+
+    ///////////////////////
+    // Operation Tables  //
+    ///////////////////////
+    // Assigns every field of an operation table from one instruction set
+    // A new Ops field is added here once and so reaches every instruction set
+#define MATRIX_SIMD_SET_OPS(OPS, ISA, LEVEL, ACCURACY)                  \
+        OPS.add = add##ISA;                                             \
+        OPS.sub = sub##ISA;                                             \
+        OPS.mul = mul##ISA;                                             \
+        OPS.addScalar = addScalar##ISA;                                 \
+        OPS.mulScalar = mulScalar##ISA;                                 \
+        OPS.set = set##ISA;                                             \
+        OPS.copy = copy##ISA;                                           \
+        OPS.fromBytes = fromBytes##ISA;                                 \
+        OPS.exp = exp##ISA<ACCURACY>;                                   \
+        OPS.sigmoid = sigmoid##ISA<ACCURACY>;                           \
+        OPS.tanh = tanh##ISA<ACCURACY>;                                 \
+        OPS.gelu = gelu##ISA<ACCURACY>;                                 \
+        OPS.geluDerivative = geluDerivative##ISA<ACCURACY>;             \
+        OPS.momentum = momentum##ISA;                                   \
+        OPS.rmsProp = rmsProp##ISA;                                     \
+        OPS.adam = adam##ISA;                                           \
+        OPS.gemmTile = gemmTile##ISA;                                   \
+        OPS.level = LEVEL;                                              \
+        OPS.accuracy = ACCURACY;
+
+    // Fill an operation table with the kernels of an instruction set
+    template<typename T, Accuracy accuracy>
+    inline void setKernels(Ops<T> &ops, Level level)
+    {
+#if MATRIX_SIMD_X86
+        switch (level)
+        {
+        case Level::AVX512:
+            MATRIX_SIMD_SET_OPS(ops, Avx512, Level::AVX512, accuracy)
+            return;
+
+        case Level::AVX2:
+            MATRIX_SIMD_SET_OPS(ops, Avx2, Level::AVX2, accuracy)
+            return;
+
+        case Level::SSE2:
+            MATRIX_SIMD_SET_OPS(ops, Sse2, Level::SSE2, accuracy)
+            return;
+
+        default:
+            break;
+        }
+#else
+        (void)level;
+#endif
+
+        MATRIX_SIMD_SET_OPS(ops, Generic, Level::SCALAR, accuracy)
+    }
+
+#undef MATRIX_SIMD_SET_OPS
+
+    // Build the operation table for an instruction set
+    template<typename T>
+    inline Ops<T> makeOps(Level level, Accuracy accuracy = Accuracy::PRECISE)
+    {
+        Ops<T> ops;
+
+        if (accuracy == Accuracy::FAST)
+        {
+            setKernels<T, Accuracy::FAST>(ops, level);
+        }
+        else
+        {
+            setKernels<T, Accuracy::PRECISE>(ops, level);
+        }
+
+        return ops;
+    }
+
+    // Active operation table - selected from the CPU on first use
+    template<typename T>
+    inline Ops<T>& activeOps()
+    {
+        static Ops<T> ops = makeOps<T>(detectLevel());
+        return ops;
+    }
+
+    // Get the active element-wise operations
+    template<typename T>
+    inline const Ops<T>& ops()
+    {
+        return activeOps<T>();
+    }
+
+    // Restrict dispatch to a narrower instruction set (e.g. for benchmarking)
+    // Requests wider than the CPU supports are clamped to the detected level
+    // Not thread safe - call before any worker threads are started
+    inline void setLevel(Level level)
+    {
+        Level detected = detectLevel();
+
+        Level selected = (level < detected) ? level : detected;
+
+        activeOps<double_t>() = makeOps<double_t>(selected, activeOps<double_t>().accuracy);
+        activeOps<float>() = makeOps<float>(selected, activeOps<float>().accuracy);
+    }
+
+    // Select the accuracy of the activation kernels - PRECISE by default
+    // Not thread safe - call before any worker threads are started
+    inline void setAccuracy(Accuracy accuracy)
+    {
+        activeOps<double_t>() = makeOps<double_t>(activeOps<double_t>().level, accuracy);
+        activeOps<float>() = makeOps<float>(activeOps<float>().level, accuracy);
+    }
+};
+
+#endif
@@ -0,0 +1,173 @@
+//-----------------------------------------------------------------------------
+// File: MatrixStorage.h
+// Author: Edward Koch
+// Description: Holds the storage arenas that Matrix elements are allocated
+//              from - an aligned heap by default, or a linear arena that
+//              packs many matrices into one contiguous block
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Construction in an Arena
+//-----------------------------------------------------------------------------
+#ifndef MATRIX_STORAGE_H
+#define MATRIX_STORAGE_H
+
+#include "MatrixSimd.h"
+
+#include <new>
+#include <stdint.h>
+#include <stdio.h>
+
+namespace Storage
+{
+    // Source of Matrix storage - every block is MATRIX_ALIGNMENT aligned
+    class Arena
+    {
+    public:
+        virtual ~Arena() {}
+
+        // Allocate an aligned block of at least bytes
+        virtual void* allocate(uint64_t bytes) = 0;
+
+        // Return a block allocated by this arena
+        virtual void deallocate(void* block, uint64_t bytes) = 0;
+    };
+
+    // Aligned Heap - every block is allocated and freed on its own
+    class HeapArena : public Arena
+    {
+    public:
+        void* allocate(uint64_t bytes) override
+        {
+            return ::operator new((size_t)bytes, std::align_val_t(MATRIX_ALIGNMENT));
+        }
+
+        void deallocate(void* block, uint64_t bytes) override
+        {
+            (void)bytes;
+            ::operator delete(block, std::align_val_t(MATRIX_ALIGNMENT));
+        }
+    };
+
+    // Process wide aligned heap
+    inline Arena& heapArena()
+    {
+        static HeapArena arena;
+        return arena;
+    }
+
+    // Linear Arena - blocks are carved in order out of one contiguous buffer,
+    // so every matrix of a network sits side by side in memory
+    // Blocks are only released when the arena is destroyed, and the arena must
+    // outlive every Matrix allocated from it
+    // Requests past the capacity fall back to the aligned heap
+    // Not thread safe - fill it from one thread
+    class LinearArena : public Arena
+    {
+    public:
+        // Constructor - reserves capacity bytes up front
+        LinearArena(uint64_t capacity)
+            : buffer((uint8_t*)heapArena().allocate(capacity)),
+              capacity(capacity),
+              used(0)
+        {
+
+        }
+
+        // Destructor - releases every block at once
+        ~LinearArena()
+        {
+            heapArena().deallocate(buffer, capacity);
+        }
+
+        void* allocate(uint64_t bytes) override
+        {
+            uint64_t offset = ((used + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT) * MATRIX_ALIGNMENT;
+
+            if (offset + bytes > capacity)
+            {
+#if _DEBUG
+                printf("LinearArena - Allocate: %llu bytes exceeds capacity, using the heap\n", (unsigned long long)bytes);
+#endif
+                return heapArena().allocate(bytes);
+            }
+
+            used = offset + bytes;
+            return buffer + offset;
+        }
+
+        void deallocate(void* block, uint64_t bytes) override
+        {
+            // Blocks inside the buffer are released with the arena
+            if ((uint8_t*)block < buffer || (uint8_t*)block >= buffer + capacity)
+            {
+                heapArena().deallocate(block, bytes);
+            }
+        }
+
+        // Get the number of bytes handed out, including alignment padding
+        uint64_t getUsed() const { return used; }
+
+        // Get the number of bytes reserved
+        uint64_t getCapacity() const { return capacity; }
+
+    private:
+        LinearArena(const LinearArena &other) = delete;
+        LinearArena& operator=(const LinearArena &other) = delete;
+
+        uint8_t* buffer;
+        uint64_t capacity;
+        uint64_t used;
+    };
+
+    // Arena used by every Matrix constructed on the calling thread
+    inline Arena*& currentArena()
+    {
+        thread_local Arena* arena = &heapArena();
+        return arena;
+    }
+
+    // Route the storage of every Matrix constructed on this thread to an arena
+    // until the scope ends, e.g. around the construction of a Neural Net
+    class ArenaScope
+    {
+    public:
+        ArenaScope(Arena &arena)
+            : previous(currentArena())
+        {
+            currentArena() = &arena;
+        }
+
+        ~ArenaScope()
+        {
+            currentArena() = previous;
+        }
+
+    private:
+        ArenaScope(const ArenaScope &other) = delete;
+        ArenaScope& operator=(const ArenaScope &other) = delete;
+
+        Arena* previous;
+    };
+
+    // Construct an object whose matrices are all allocated from an arena
+    // The object is built directly in place of the returned value, so a
+    // member can be initialized with it while the arena scope is active
+    template<typename Contents>
+    inline Contents constructIn(Arena &arena)
+    {
+        ArenaScope scope(arena);
+        return Contents();
+    }
+
+    // Bytes a rows x cols Matrix of T takes in a LinearArena, including alignment padding
+    template<typename T>
+    constexpr uint64_t matrixBytes(uint64_t rows, uint64_t cols)
+    {
+        return ((rows * cols * sizeof(T) + MATRIX_ALIGNMENT - 1) / MATRIX_ALIGNMENT) * MATRIX_ALIGNMENT;
+    }
+};
+
+#endif
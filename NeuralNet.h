@@ -9,10 +9,30 @@
 // Author     Date        Description
 //-----------------------------------------------------------------------------
 // E. Koch    07/11/24    Initial Creation 
+// E. Koch    10/17/26    Mini-batch Training
+// E. Koch    10/17/26    Batched Inference
+// E. Koch    10/17/26    Thread Safe Const Inference
+// E. Koch    10/17/26    Lock-free Hogwild Training
+// E. Koch    10/17/26    Templated Element Type
+// E. Koch    10/17/26    Read Only Weight Access
+// E. Koch    10/17/26    Move Semantics
+// E. Koch    10/17/26    Compact Byte Inputs
+// E. Koch    10/17/26    Weight Loading for Checkpoints
+// E. Koch    10/17/26    Fused Bias, Activation and Gradient Kernels
+// E. Koch    10/17/26    Tanh, Leaky ReLU and Softmax Activations
+// E. Koch    10/17/26    Back Propagation without Transposed Copies
+// E. Koch    10/17/26    Phase Profiling
+// E. Koch    10/17/26    Stochastic Batches without Replacement
+// E. Koch    10/17/26    Pluggable Optimizers
+// E. Koch    10/17/26    Per-Sample Optimizer Updates
 //-----------------------------------------------------------------------------
 #ifndef NEURAL_NET_H
 #define NEURAL_NET_H
 
+#include "Optimizer.h"
+#include "Profiler.h"
+#include "Sampler.h"
+
 #include <ctime>
 #include <math.h>
 #include <random>
@@ -24,31 +44,40 @@ namespace NN
     enum class Activations : uint8_t
     {
         SIGMOID,
-        RELU
+        RELU,
+        TANH,
+        LEAKY_RELU,
+        SOFTMAX     // Sigmoid hidden layer, Softmax output trained with cross-entropy
     };
 
-    double_t sigmoid(double_t input)
+    // Slope of Leaky ReLU for negative inputs
+    const double_t LEAKY_RELU_SLOPE = 0.01;
+
+    template<typename T>
+    T sigmoid(T input)
     {
         // Sigmoid Approximation
         // return (input / (1 + abs(input)));
 
         // Actual Sigmoid
-        return ((1.0) / (1.0 + std::exp(-input)));
+        return ((T)1.0 / ((T)1.0 + std::exp(-input)));
     }
 
-    double_t sigmoidDerivative(double_t input)
+    template<typename T>
+    T sigmoidDerivative(T input)
     {
-        //double_t sigInput = sigmoid(input);
+        //T sigInput = sigmoid(input);
         //return (sigInput * (1.0 - sigInput));
 
         // because the sigmoid funciton is already applied to all value matricies
         // The sigmoid does not need to also be applied in the derivative
-        return (input * (1.0 - input));
+        return (input * ((T)1.0 - input));
     }
 
-    double_t relu(double_t input)
+    template<typename T>
+    T relu(T input)
     {
-        if (input < 0.0)
+        if (input < (T)0.0)
         {
             return 0;
         }
@@ -58,9 +87,10 @@ namespace NN
         }
     }
 
-    double_t reluDerivative(double_t input)
+    template<typename T>
+    T reluDerivative(T input)
     {
-        if (input < 0.0)
+        if (input < (T)0.0)
         {
             return 0;
         }
@@ -70,108 +100,402 @@ namespace NN
         }
     }
 
+    template<typename T>
+    T tanh(T input)
+    {
+        return std::tanh(input);
+    }
+
+    template<typename T>
+    T tanhDerivative(T input)
+    {
+        // Like the sigmoid, input is the already activated value
+        return ((T)1.0 - input * input);
+    }
+
+    template<typename T>
+    T leakyRelu(T input)
+    {
+        if (input < (T)0.0)
+        {
+            return input * (T)LEAKY_RELU_SLOPE;
+        }
+        else
+        {
+            return input;
+        }
+    }
+
+    template<typename T>
+    T leakyReluDerivative(T input)
+    {
+        // The slope is positive, so the activated value keeps the input's sign
+        if (input < (T)0.0)
+        {
+            return (T)LEAKY_RELU_SLOPE;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+    // Activation Functors - resolved at compile time so the matrix kernels
+    // can fuse the activation into the product and gradient loops
+    // apply activates a run of values in place, derivative takes an activated
+    // value, NORMALIZE_COLUMNS is set when each column of the layer must also
+    // be normalised once the whole layer is finished
+    template<typename T>
+    struct Sigmoid
+    {
+        static const bool NORMALIZE_COLUMNS = false;
+        static void apply(T* values, uint64_t count) { Simd::ops<T>().sigmoid(values, values, count); }
+        static T derivative(T output) { return sigmoidDerivative(output); }
+    };
+
+    template<typename T>
+    struct Relu
+    {
+        static const bool NORMALIZE_COLUMNS = false;
+        static void apply(T* values, uint64_t count)
+        {
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                values[i] = relu(values[i]);
+            }
+        }
+        static T derivative(T output) { return reluDerivative(output); }
+    };
+
+    template<typename T>
+    struct Tanh
+    {
+        static const bool NORMALIZE_COLUMNS = false;
+        static void apply(T* values, uint64_t count) { Simd::ops<T>().tanh(values, values, count); }
+        static T derivative(T output) { return tanhDerivative(output); }
+    };
+
+    template<typename T>
+    struct LeakyRelu
+    {
+        static const bool NORMALIZE_COLUMNS = false;
+        static void apply(T* values, uint64_t count)
+        {
+            for (uint64_t i = 0; i < count; ++i)
+            {
+                values[i] = leakyRelu(values[i]);
+            }
+        }
+        static T derivative(T output) { return leakyReluDerivative(output); }
+    };
+
+    // Softmax is applied to whole columns after the product - with a
+    // cross-entropy loss the output gradient is just Answers - Outputs
+    template<typename T>
+    struct Softmax
+    {
+        static const bool NORMALIZE_COLUMNS = true;
+        static void apply(T* values, uint64_t count) { (void)values; (void)count; }
+        static T derivative(T output) { (void)output; return 1; }
+    };
+
+    // Call function with the hidden and output layer functors of an
+    // Activation Function - one branch per call rather than an indirect call per element
+    template<typename T, typename Function>
+    void withActivation(Activations activation, Function &&function)
+    {
+        switch (activation)
+        {
+        case Activations::RELU:
+            function(Relu<T>(), Relu<T>());
+            break;
+
+        case Activations::TANH:
+            function(Tanh<T>(), Tanh<T>());
+            break;
+
+        case Activations::LEAKY_RELU:
+            function(LeakyRelu<T>(), LeakyRelu<T>());
+            break;
+
+        case Activations::SOFTMAX:
+            function(Sigmoid<T>(), Softmax<T>());
+            break;
+
+        case Activations::SIGMOID:
+        default:
+            function(Sigmoid<T>(), Sigmoid<T>());
+            break;
+        }
+    }
+
 
     // Round a double to prevent precision errors
-    double_t round(double_t intput)
+    template<typename T>
+    T round(T intput)
     {
-        return std::round(intput * 1000.0) / 1000.0;
+        return std::round(intput * (T)1000.0) / (T)1000.0;
     }
 
-    double_t square(double_t input)
+    template<typename T>
+    T square(T input)
     {
         return input * input;
     }
 
-    double_t invert(double_t input)
+    template<typename T>
+    T invert(T input)
     {
-        return 1.0 / input;
+        return (T)1.0 / input;
     }
 };
 
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T = double_t>
 class NeuralNet
 {
 public:
-    
+    // Number of inputs guessBatch feeds forward together
+    static const uint16_t GUESS_BATCH_SIZE = 32;
+
+    // Inference Workspace - each input is packed as one column so a batch
+    // is pushed through every layer as a single matrix-matrix product
+    template<uint16_t batchSize>
+    struct GuessBatch
+    {
+        // Pack an input into a column of the batch
+        void setInputs(uint16_t col, const T(&inputs)[numInputs]);
+
+        // Read the guessed outputs from a column of the batch
+        void getOutputs(uint16_t col, T(&outputs)[numOutputs]) const;
+
+        Matrix<numInputs, batchSize, T> inputValues;
+        Matrix<numHidden, batchSize, T> hiddenValues;
+        Matrix<numOutputs, batchSize, T> outputValues;
+    };
+
+    // Single Input Inference Workspace - one per thread sharing the Neural Net
+    typedef GuessBatch<1> Workspace;
+
+    // Compact Inference Workspace - inputs are packed as bytes (e.g. raw pixels)
+    // and only converted by the first layer product, an eighth of the memory
+    // traffic of double inputs
+    template<uint16_t batchSize>
+    struct ByteGuessBatch
+    {
+        // Constructor - every input byte is multiplied by inputScale
+        ByteGuessBatch(T inputScale = (T)(1.0 / 255.0));
+
+        // Pack an input into a column of the batch
+        void setInputs(uint16_t col, const uint8_t(&inputs)[numInputs]);
+
+        // Read the guessed outputs from a column of the batch
+        void getOutputs(uint16_t col, T(&outputs)[numOutputs]) const;
+
+        // numInputs x batchSize row-major, one input per column
+        std::vector<uint8_t> inputBytes;
+        T inputScale;
+
+        Matrix<numHidden, batchSize, T> hiddenValues;
+        Matrix<numOutputs, batchSize, T> outputValues;
+    };
+
+    // Mini-batch Workspace - each sample is packed as one column so a batch
+    // is pushed through every layer as a single matrix-matrix product
+    // Large for wide layers, so allocate it once and reuse it for every batch
+    template<uint16_t batchSize>
+    struct Batch
+    {
+        // Pack an input and expected answer into a column of the batch
+        void setSample(uint16_t col, const T(&inputs)[numInputs], const T(&answers)[numOutputs]);
+
+        // Feed Forward Values
+        Matrix<numInputs, batchSize, T> inputValues;
+        Matrix<numHidden, batchSize, T> hiddenValues;
+        Matrix<numOutputs, batchSize, T> outputValues;
+
+        // Back Propagation Values
+        Matrix<numOutputs, batchSize, T> answerValues;
+        Matrix<numOutputs, batchSize, T> outputError;
+        Matrix<numOutputs, batchSize, T> outputGradient;
+
+        Matrix<numHidden, batchSize, T> hiddenError;
+        Matrix<numHidden, batchSize, T> hiddenGradient;
+
+        // Adjustments accumulated over every sample in the batch
+        Matrix<numOutputs, numHidden, T> hiddenWeightsAdjustment;
+        Matrix<numOutputs, 1, T> hiddenBiasAdjustment;
+
+        Matrix<numHidden, numInputs, T> inputWeightsAdjustment;
+        Matrix<numHidden, 1, T> inputBiasAdjustment;
+    };
+
+
     NeuralNet(std::mt19937 rngIn, 
               NN::Activations activation = NN::Activations::SIGMOID, 
-              double_t learningRate = 0.001);
+              T learningRate = 0.001);
 
     ~NeuralNet();
 
+    // Copy - duplicates every weight and workspace
+    NeuralNet(const NeuralNet &other) = default;
+    NeuralNet& operator=(const NeuralNet &other) = default;
+
+    // Move - takes the other Neural Net's storage without copying it
+    NeuralNet(NeuralNet &&other) = default;
+    NeuralNet& operator=(NeuralNet &&other) = default;
+
     // Set the Learning Rate
-    void setLearningRate(double_t lr);
+    void setLearningRate(T lr);
+
+    // Get the Learning Rate
+    T getLearningRate() const { return learningRate; }
+
+    // Set how the adjustments are applied to the Weights - clears any running moments
+    void setOptimizer(const typename Optimizer<T>::Settings &settings);
+
+    // Get how the adjustments are applied to the Weights
+    const Optimizer<T>& getOptimizer() const { return optimizer; }
 
     // Randomize the Weights
-    void randomize(double_t min, double_t max);
+    void randomize(T min, T max);
 
     // Generate an output array based on an input array
-    void guess(const double_t (&inputs)[numInputs], double_t (&outputs)[numOutputs]);
+    void guess(const T (&inputs)[numInputs], T (&outputs)[numOutputs]);
+
+    // Generate an output array based on an input array - activations are kept
+    // in the given workspace so threads can share one set of weights
+    void guess(const T(&inputs)[numInputs], T(&outputs)[numOutputs], Workspace &workspace) const;
+
+    // Generate an output array based on a byte input array - each byte is
+    // multiplied by inputScale inside the first layer product
+    void guess(const uint8_t(&inputs)[numInputs], T inputScale, T(&outputs)[numOutputs], Workspace &workspace) const;
+
+    // Generate an output array based on an input array - activations are kept
+    // in a workspace owned by the calling thread
+    void guessConcurrent(const T(&inputs)[numInputs], T(&outputs)[numOutputs]) const;
+
+    // Generate an output array for every one of numRows input arrays
+    void guessBatch(const T(*inputs)[numInputs], T(*outputs)[numOutputs], uint32_t numRows);
+
+    // Generate the outputs for every input packed into the batch
+    template<uint16_t batchSize>
+    void guessBatch(GuessBatch<batchSize> &batch) const;
+
+    // Generate the outputs for every byte input packed into the batch
+    template<uint16_t batchSize>
+    void guessBatch(ByteGuessBatch<batchSize> &batch) const;
 
     // Train the Neural net based on an input array and an expected answer array
-    void train(const double_t(&inputs)[numInputs], const double_t(&answers)[numOutputs]);
+    void train(const T(&inputs)[numInputs], const T(&answers)[numOutputs]);
 
     // Train the Neural net based on many inputs and answers - using stochastic batches
-    void train(const double_t(*inputs)[numInputs], const double_t(*answers)[numOutputs], uint16_t numRows, uint16_t batchSize);
+    // Each call continues a shuffled pass over the rows, so every row is trained once per pass
+    void train(const T(*inputs)[numInputs], const T(*answers)[numOutputs], uint64_t numRows, uint32_t batchSize);
+
+    // Train the Neural net on a packed mini-batch - one weight update for the whole batch
+    template<uint16_t batchSize>
+    void trainBatch(Batch<batchSize> &batch);
+
+    // Feed a packed mini-batch forward and accumulate its adjustments without applying them
+    template<uint16_t batchSize>
+    void calculateBatchDelta(Batch<batchSize> &batch) const;
+
+    // Apply the adjustments accumulated by calculateBatchDelta
+    template<uint16_t batchSize>
+    void applyBatchDelta(Batch<batchSize> &batch);
+
+    // Train the Neural net on one sample while other threads train the same weights
+    // Lock-free (Hogwild) - the workspace must belong to the calling thread
+    // Always plain SGD - running moments cannot be shared without locks - and the
+    // hidden error is back propagated before the hidden weights are updated, so
+    // it is not the same step as train() and is compared only with itself
+    void trainHogwild(const T(&inputs)[numInputs], const T(&answers)[numOutputs], Batch<1> &workspace);
 
     // Get the largest error between a guessed output and a given answer
-    double_t test(const double_t(&inputs)[numInputs], const double_t(&answers)[numOutputs]);
+    T test(const T(&inputs)[numInputs], const T(&answers)[numOutputs]);
 
     // Get the largest error between a guessed output to every element in an input set and a given answer set
-    double_t test(const double_t(*inputs)[numInputs], const double_t(*answers)[numOutputs], uint16_t numRows);
+    T test(const T(*inputs)[numInputs], const T(*answers)[numOutputs], uint64_t numRows);
 
     // Print out the Weights and Bias of the Neural Net
     void print();
 
+    // Get the Activation Function used by every layer
+    NN::Activations getActivation() const { return activationFunciton; }
+
+    // Get the trained Weights and Bias of each layer (e.g. to quantize or save them)
+    const Matrix<numHidden, numInputs, T>& getInputWeights() const { return inputWeights; }
+    const Matrix<numHidden, 1, T>& getInputBias() const { return inputBias; }
+    const Matrix<numOutputs, numHidden, T>& getHiddenWeights() const { return hiddenWeights; }
+    const Matrix<numOutputs, 1, T>& getHiddenBias() const { return hiddenBias; }
+
+    // Replace the Weights and Bias of each layer with copies of row-major arrays
+    void setWeights(const T* newInputWeights, const T* newInputBias, const T* newHiddenWeights, const T* newHiddenBias);
+
+    // Use external Weights and Bias in place, e.g. from a mapped checkpoint
+    // Every array must be MATRIX_ALIGNMENT aligned and outlive its use here
+    void attachWeights(T* newInputWeights, T* newInputBias, T* newHiddenWeights, T* newHiddenBias);
+
 private:
     // Random Number Generator
     std::mt19937 rng;
 
+    // Order of the rows given to the stochastic train
+    Sampler sampler;
+
     // Activation Function to use
     NN::Activations activationFunciton;
 
-    // Activation Function
-    double_t(*actFunct)(double_t);
-    double_t(*actFunctDeriv)(double_t);
-
     // Learning Rate
-    double_t learningRate;
+    T learningRate;
+
+    // Weight Update Rule
+    Optimizer<T> optimizer;
 
     /////////////////////////////
     // Feed Fordward Matricies //
     /////////////////////////////
-    Matrix<numInputs, 1> inputValues;
+    Matrix<numInputs, 1, T> inputValues;
 
-    Matrix<numHidden, numInputs> inputWeights;
-    Matrix<numHidden, 1> inputBias;
+    Matrix<numHidden, numInputs, T> inputWeights;
+    Matrix<numHidden, 1, T> inputBias;
 
-    Matrix<numHidden, 1> hiddenValues;
+    Matrix<numHidden, 1, T> hiddenValues;
 
-    Matrix<numOutputs, numHidden> hiddenWeights;
-    Matrix<numOutputs, 1> hiddenBias;
+    Matrix<numOutputs, numHidden, T> hiddenWeights;
+    Matrix<numOutputs, 1, T> hiddenBias;
 
-    Matrix<numOutputs, 1> outputValues;
+    Matrix<numOutputs, 1, T> outputValues;
 
     ////////////////////////////////
     // Back Propagation Matricies //
     ////////////////////////////////
-    Matrix<numOutputs, 1> answerValues;
+    Matrix<numOutputs, 1, T> answerValues;
 
     // Error Calculation
-    double_t outputArray[numOutputs];
-    Matrix<numOutputs, 1> outputError;
+    T outputArray[numOutputs];
+    Matrix<numOutputs, 1, T> outputError;
 
-    Matrix<numHidden, numOutputs> hiddenWeightsTransposed;
-    Matrix<numHidden, 1> hiddenError;
+    Matrix<numHidden, 1, T> hiddenError;
 
     // Gradient Calculation
-    Matrix<numOutputs, 1> outputGradient;
-    Matrix<1, numHidden> hiddenValuesTransposed;
-    Matrix<numOutputs, numHidden> hiddenWeightsAdjustment;
+    Matrix<numOutputs, 1, T> outputGradient;
+    Matrix<numHidden, 1, T> hiddenGradient;
+
+    ///////////////////////
+    // Optimizer State   //
+    ///////////////////////
+    // Running moments of each Weight and Bias - empty unless the optimizer keeps moments
+    Moments<numHidden, numInputs, T> inputWeightsMoments;
+    Moments<numHidden, 1, T> inputBiasMoments;
+
+    Moments<numOutputs, numHidden, T> hiddenWeightsMoments;
+    Moments<numOutputs, 1, T> hiddenBiasMoments;
 
-    Matrix<numHidden, 1> hiddenGradient;
-    Matrix<1, numInputs> inputValuesTransposed;
-    Matrix<numHidden, numInputs> inputWeightsAdjustment;
+    ///////////////////////////////
+    // Batched Inference Scratch //
+    ///////////////////////////////
+    GuessBatch<GUESS_BATCH_SIZE> guessScratch;
 
     /////////////////////////////
     // Feed Fordward Functions //
@@ -182,17 +506,25 @@ private:
     // Calculate Output Values based on Hidden
     void hiddenToOutput();
 
+    // Calculate Output Values for a batch of packed Inputs
+    template<uint16_t batchSize>
+    void batchToOutput(Matrix<numInputs, batchSize, T> &inputs, Matrix<numHidden, batchSize, T> &hidden, Matrix<numOutputs, batchSize, T> &outputs) const;
+
+    // Calculate Output Values for a batch of packed byte Inputs
+    template<uint16_t batchSize>
+    void byteBatchToOutput(const uint8_t* inputs, T inputScale, Matrix<numHidden, batchSize, T> &hidden, Matrix<numOutputs, batchSize, T> &outputs) const;
+
     ////////////////////////////////
     // Back Propagation Functions //
     ////////////////////////////////
     // Calculate output error based on output and answers
-    void calculateOutputError(const double_t(&answers)[numOutputs]);
+    void calculateOutputError(const T(&answers)[numOutputs]);
 
     // Calculate output Gradient
     void calculateOutputGradient();
 
     // Calculate and apply the hidden weight and bias adjustments
-    void calculateHiddenDelta(const double_t(&answers)[numOutputs]);
+    void calculateHiddenDelta(const T(&answers)[numOutputs]);
 
     // Calculate hidden error based on output error and hidden weights
     void calculateHiddenError();
@@ -203,35 +535,19 @@ private:
     // Calculate and apply input weight and bias adjustments
     void calculateInputDelta();
 
+    // Get the scale of the adjustments - the optimizer applies the learning
+    // rate itself when it keeps moments
+    T getStepScale() const { return optimizer.usesMoments() ? (T)1.0 : learningRate; }
+
 
 };
 
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline NeuralNet<numInputs, numHidden, numOutputs>::NeuralNet(std::mt19937 rngIn, NN::Activations activation, double_t learningRate)
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline NeuralNet<numInputs, numHidden, numOutputs, T>::NeuralNet(std::mt19937 rngIn, NN::Activations activation, T learningRate)
     : rng(rngIn),
       activationFunciton(activation),
-      actFunct(0),
       learningRate(learningRate)
 {
-    // Choose Activation Function
-    switch (activationFunciton)
-    {
-    case NN::Activations::SIGMOID:
-        actFunct = NN::sigmoid;
-        actFunctDeriv = NN::sigmoidDerivative;
-        break;
-
-    case NN::Activations::RELU:
-        actFunct = NN::relu;
-        actFunctDeriv = NN::reluDerivative;
-        break;
-
-    default:
-        actFunct = NN::sigmoid;
-        actFunctDeriv = NN::sigmoidDerivative;
-        break;
-    }
-
     // Initialize Feedforward Matricies
     inputValues.clear();
     inputWeights.clear();
@@ -252,26 +568,38 @@ inline NeuralNet<numInputs, numHidden, numOutputs>::NeuralNet(std::mt19937 rngIn
     }
     outputError.clear();
 
-    hiddenWeightsTransposed.clear();
     hiddenError.clear();
 }
 
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline NeuralNet<numInputs, numHidden, numOutputs>::~NeuralNet()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline NeuralNet<numInputs, numHidden, numOutputs, T>::~NeuralNet()
 {
 
 }
 
 // Set the Learning Rate
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::setLearningRate(double_t lr)
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::setLearningRate(T lr)
 {
     learningRate = lr;
 }
 
+// Set how the adjustments are applied to the Weights - clears any running moments
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::setOptimizer(const typename Optimizer<T>::Settings &settings)
+{
+    optimizer.setSettings(settings);
+
+    inputWeightsMoments.clear();
+    inputBiasMoments.clear();
+
+    hiddenWeightsMoments.clear();
+    hiddenBiasMoments.clear();
+}
+
 // Randomize the Weights
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::randomize(double_t min, double_t max)
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::randomize(T min, T max)
 {
     inputWeights.randomize(rng, min, max);
     inputBias.randomize(rng, min, max);
@@ -280,9 +608,31 @@ inline void NeuralNet<numInputs, numHidden, numOutputs>::randomize(double_t min,
     hiddenBias.randomize(rng, min, max);
 }
 
+// Replace the Weights and Bias of each layer with copies of row-major arrays
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::setWeights(const T* newInputWeights, const T* newInputBias, const T* newHiddenWeights, const T* newHiddenBias)
+{
+    Simd::ops<T>().copy(inputWeights.getData(), newInputWeights, inputWeights.getLength());
+    Simd::ops<T>().copy(inputBias.getData(), newInputBias, inputBias.getLength());
+
+    Simd::ops<T>().copy(hiddenWeights.getData(), newHiddenWeights, hiddenWeights.getLength());
+    Simd::ops<T>().copy(hiddenBias.getData(), newHiddenBias, hiddenBias.getLength());
+}
+
+// Use external Weights and Bias in place, e.g. from a mapped checkpoint
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::attachWeights(T* newInputWeights, T* newInputBias, T* newHiddenWeights, T* newHiddenBias)
+{
+    inputWeights.attach(newInputWeights);
+    inputBias.attach(newInputBias);
+
+    hiddenWeights.attach(newHiddenWeights);
+    hiddenBias.attach(newHiddenBias);
+}
+
 // Generate an output array based on an input array
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::guess(const double_t(&inputs)[numInputs], double_t(&outputs)[numOutputs])
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guess(const T(&inputs)[numInputs], T(&outputs)[numOutputs])
 {
     // Reset all intermediate Values
     inputValues.clear();
@@ -302,13 +652,101 @@ inline void NeuralNet<numInputs, numHidden, numOutputs>::guess(const double_t(&i
 
 }
 
+// Generate an output array based on an input array - activations are kept
+// in the given workspace so threads can share one set of weights
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guess(const T(&inputs)[numInputs], T(&outputs)[numOutputs], Workspace &workspace) const
+{
+    // Populate Inputs
+    workspace.inputValues.fill(inputs);
+
+    // Feed Inputs through the Hidden Layer to the Outputs
+    batchToOutput(workspace.inputValues, workspace.hiddenValues, workspace.outputValues);
+
+    // Populate output array
+    workspace.outputValues.toArray(outputs);
+}
+
+// Generate an output array based on a byte input array - each byte is
+// multiplied by inputScale inside the first layer product
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guess(const uint8_t(&inputs)[numInputs], T inputScale, T(&outputs)[numOutputs], Workspace &workspace) const
+{
+    // A single input is already a column - it is read in place
+    byteBatchToOutput<1>(inputs, inputScale, workspace.hiddenValues, workspace.outputValues);
+
+    // Populate output array
+    workspace.outputValues.toArray(outputs);
+}
+
+// Generate an output array based on an input array - activations are kept
+// in a workspace owned by the calling thread
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guessConcurrent(const T(&inputs)[numInputs], T(&outputs)[numOutputs]) const
+{
+    // One workspace per thread per network shape - allocated on the thread's first guess
+    // It outlives any arena scope open around that guess, so it always uses the heap
+    Storage::ArenaScope scope(Storage::heapArena());
+    thread_local Workspace workspace;
+
+    guess(inputs, outputs, workspace);
+}
+
+// Generate an output array for every one of numRows input arrays
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guessBatch(const T(*inputs)[numInputs], T(*outputs)[numOutputs], uint32_t numRows)
+{
+    for (uint32_t first = 0; first < numRows; first += GUESS_BATCH_SIZE)
+    {
+        // The last batch may be partial - stale columns are computed but never read
+        uint16_t count = (numRows - first < GUESS_BATCH_SIZE) ? (uint16_t)(numRows - first) : GUESS_BATCH_SIZE;
+
+        for (uint16_t col = 0; col < count; ++col)
+        {
+            guessScratch.setInputs(col, inputs[first + col]);
+        }
+
+        guessBatch(guessScratch);
+
+        for (uint16_t col = 0; col < count; ++col)
+        {
+            guessScratch.getOutputs(col, outputs[first + col]);
+        }
+    }
+}
+
+// Generate the outputs for every input packed into the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guessBatch(GuessBatch<batchSize> &batch) const
+{
+    batchToOutput(batch.inputValues, batch.hiddenValues, batch.outputValues);
+}
+
+// Generate the outputs for every byte input packed into the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::guessBatch(ByteGuessBatch<batchSize> &batch) const
+{
+    byteBatchToOutput<batchSize>(batch.inputBytes.data(), batch.inputScale, batch.hiddenValues, batch.outputValues);
+}
+
 // Train the Neural net based on an input array and an expected answer array
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::train(const double_t(&inputs)[numInputs], const double_t(&answers)[numOutputs])
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::train(const T(&inputs)[numInputs], const T(&answers)[numOutputs])
 {
+    NN_PROFILE_SCOPE("train");
+    NN_PROFILE_COUNT("samplesTrained", 1);
+
     // Feed Inputs forward through the Neural Net
     guess(inputs, outputArray);
 
+    // Every layer of the sample is one optimizer step
+    if (!optimizer.isPlain())
+    {
+        optimizer.beginStep(learningRate);
+    }
+
     // Calculate and Apply Hidden Weight and bias  Adjustment - Based on expected output
     calculateHiddenDelta(answers);
 
@@ -317,24 +755,197 @@ inline void NeuralNet<numInputs, numHidden, numOutputs>::train(const double_t(&i
 }
 
 // Train the Neural net based on many inputs and answers - using stochastic batches
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::train(const double_t(*inputs)[numInputs], const double_t(*answers)[numOutputs], uint16_t numRows, uint16_t batchSize)
+// Each call continues a shuffled pass over the rows, so every row is trained once per pass
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::train(const T(*inputs)[numInputs], const T(*answers)[numOutputs], uint64_t numRows, uint32_t batchSize)
 {
-    uint16_t index = 0;
+    if (numRows == 0)
+    {
+        return;
+    }
+
+    // New rows - start a new sequence of passes over them
+    if (sampler.size() != numRows)
+    {
+        sampler.setNumSamples(numRows);
+        sampler.setSeed(rng());
+        sampler.startEpoch(0);
+    }
 
-    std::uniform_real_distribution<float> uniformDist(0, numRows);
+    uint64_t index = 0;
 
-    for (uint16_t i = 0; i < batchSize; ++i)
+    for (uint32_t i = 0; i < batchSize; ++i)
     {
-        index = uniformDist(rng);
+        // Start the next pass once every row has been trained
+        if (!sampler.next(index))
+        {
+            sampler.nextEpoch();
+            sampler.next(index);
+        }
 
         train(inputs[index], answers[index]);
     }
 }
 
+// Train the Neural net on a packed mini-batch - one weight update for the whole batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::trainBatch(Batch<batchSize> &batch)
+{
+    NN_PROFILE_SCOPE("trainBatch");
+
+    // Feed forward and back propagate every sample at once
+    calculateBatchDelta(batch);
+
+    // Apply the accumulated adjustments
+    applyBatchDelta(batch);
+}
+
+// Feed a packed mini-batch forward and accumulate its adjustments without applying them
+// The adjustments are summed over the batch, so one batch update matches the
+// size of batchSize single-sample updates at the same learning rate
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateBatchDelta(Batch<batchSize> &batch) const
+{
+    NN_PROFILE_COUNT("samplesTrained", batchSize);
+
+    // Feed every sample forward at once
+    batchToOutput(batch.inputValues, batch.hiddenValues, batch.outputValues);
+
+    /////////////////////////////
+    // Back Propagation        //
+    /////////////////////////////
+    NN_PROFILE_SCOPE("batchBackPropagate");
+
+    // Error = Answers - Outputs
+    batch.outputError = batch.answerValues;
+    batch.outputError.sub(batch.outputValues);
+
+    // Output Gradient = Output Derivative * Error * Learning Rate (unless the optimizer applies it)
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)hiddenActivation;
+        batch.outputGradient.template activationGradient<decltype(outputActivation)>(batch.outputValues, batch.outputError, getStepScale());
+    });
+
+    // Hidden Weight Adjustments - summed over the batch by the matrix product
+    batch.outputGradient.multiplyTransposed(batch.hiddenValues, batch.hiddenWeightsAdjustment);
+    batch.outputGradient.sumColumns(batch.hiddenBiasAdjustment);
+
+    // Hidden Error - back propagated through the Hidden Weights
+    hiddenWeights.transposeMultiply(batch.outputError, batch.hiddenError);
+
+    // Hidden Gradient = Hidden Derivative * Hidden Error * Learning Rate (unless the optimizer applies it)
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)outputActivation;
+        batch.hiddenGradient.template activationGradient<decltype(hiddenActivation)>(batch.hiddenValues, batch.hiddenError, getStepScale());
+    });
+
+    // Input Weight Adjustments - summed over the batch by the matrix product
+    batch.hiddenGradient.multiplyTransposed(batch.inputValues, batch.inputWeightsAdjustment);
+    batch.hiddenGradient.sumColumns(batch.inputBiasAdjustment);
+}
+
+// Apply the adjustments accumulated by calculateBatchDelta
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::applyBatchDelta(Batch<batchSize> &batch)
+{
+    NN_PROFILE_SCOPE("applyBatchDelta");
+
+    // One fused pass over each Weight, its adjustment and its moments
+    optimizer.beginStep(learningRate);
+
+    optimizer.update(hiddenWeights, batch.hiddenWeightsAdjustment, hiddenWeightsMoments);
+    optimizer.update(hiddenBias, batch.hiddenBiasAdjustment, hiddenBiasMoments);
+
+    optimizer.update(inputWeights, batch.inputWeightsAdjustment, inputWeightsMoments);
+    optimizer.update(inputBias, batch.inputBiasAdjustment, inputBiasMoments);
+}
+
+// Train the Neural net on one sample while other threads train the same weights
+// Lock-free (Hogwild) - updates are racy by design, a concurrent update may be
+// overwritten, which is rare because only the input weights of non-zero inputs
+// are written and sparse inputs such as MNIST pixels rarely overlap
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::trainHogwild(const T(&inputs)[numInputs], const T(&answers)[numOutputs], Batch<1> &workspace)
+{
+    NN_PROFILE_SCOPE("trainHogwild");
+    NN_PROFILE_COUNT("samplesTrained", 1);
+
+    // Feed Inputs forward through the thread's own workspace
+    workspace.setSample(0, inputs, answers);
+    batchToOutput(workspace.inputValues, workspace.hiddenValues, workspace.outputValues);
+
+    // Error = Answers - Outputs
+    workspace.outputError = workspace.answerValues;
+    workspace.outputError.sub(workspace.outputValues);
+
+    // Output Gradient = Output Derivative * Error * Learning Rate
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)hiddenActivation;
+        workspace.outputGradient.template activationGradient<decltype(outputActivation)>(workspace.outputValues, workspace.outputError, learningRate);
+    });
+
+    // Hidden Error - back propagated through the Hidden Weights
+    hiddenWeights.transposeMultiply(workspace.outputError, workspace.hiddenError);
+
+    // Hidden Gradient = Hidden Derivative * Hidden Error * Learning Rate
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)outputActivation;
+        workspace.hiddenGradient.template activationGradient<decltype(hiddenActivation)>(workspace.hiddenValues, workspace.hiddenError, learningRate);
+    });
+
+    // Apply Hidden Weight and Bias Adjustments in place
+    const T* outputGradient = workspace.outputGradient.getData();
+    const T* hidden = workspace.hiddenValues.getData();
+    T* weights = hiddenWeights.getData();
+
+    for (uint16_t row = 0; row < numOutputs; ++row)
+    {
+        T* weightRow = weights + (uint64_t)row * numHidden;
+
+        for (uint16_t col = 0; col < numHidden; ++col)
+        {
+            weightRow[col] += outputGradient[row] * hidden[col];
+        }
+    }
+    hiddenBias.add(workspace.outputGradient);
+
+    // Apply Input Weight Adjustments - a zero input adjusts nothing in its column
+    uint16_t nonZero[numInputs];
+    uint16_t numNonZero = 0;
+
+    for (uint16_t col = 0; col < numInputs; ++col)
+    {
+        if (inputs[col] != 0.0)
+        {
+            nonZero[numNonZero++] = col;
+        }
+    }
+
+    const T* hiddenGradient = workspace.hiddenGradient.getData();
+    weights = inputWeights.getData();
+
+    for (uint16_t row = 0; row < numHidden; ++row)
+    {
+        T* weightRow = weights + (uint64_t)row * numInputs;
+
+        for (uint16_t i = 0; i < numNonZero; ++i)
+        {
+            weightRow[nonZero[i]] += hiddenGradient[row] * inputs[nonZero[i]];
+        }
+    }
+    inputBias.add(workspace.hiddenGradient);
+}
+
 // Get the largest error between a guessed output and a given answer
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline double_t NeuralNet<numInputs, numHidden, numOutputs>::test(const double_t(&inputs)[numInputs], const double_t(&answers)[numOutputs])
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline T NeuralNet<numInputs, numHidden, numOutputs, T>::test(const T(&inputs)[numInputs], const T(&answers)[numOutputs])
 {
     // Feed Inputs forward through the Neural Net
     guess(inputs, outputArray);
@@ -344,7 +955,7 @@ inline double_t NeuralNet<numInputs, numHidden, numOutputs>::test(const double_t
 
     outputError.toArray(outputArray);
 
-    double_t largestError = 0.0;
+    T largestError = 0.0;
 
     for (int i = 0; i < numOutputs; ++i)
     {
@@ -358,13 +969,13 @@ inline double_t NeuralNet<numInputs, numHidden, numOutputs>::test(const double_t
 }
 
 // Get the largest error between a guessed output to every element in an input set and a given answer set
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline double_t NeuralNet<numInputs, numHidden, numOutputs>::test(const double_t(*inputs)[numInputs], const double_t(*answers)[numOutputs], uint16_t numRows)
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline T NeuralNet<numInputs, numHidden, numOutputs, T>::test(const T(*inputs)[numInputs], const T(*answers)[numOutputs], uint64_t numRows)
 {
-    double_t largestError = 0.0;
+    T largestError = 0.0;
 
-    double_t currentError = 0.0;
-    for (int i = 0; i < numRows; ++i)
+    T currentError = 0.0;
+    for (uint64_t i = 0; i < numRows; ++i)
     {
         currentError = test(inputs[i], answers[i]);
 
@@ -377,9 +988,71 @@ inline double_t NeuralNet<numInputs, numHidden, numOutputs>::test(const double_t
     return largestError;
 }
 
+// Pack an input into a column of the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::GuessBatch<batchSize>::setInputs(uint16_t col, const T(&inputs)[numInputs])
+{
+    inputValues.setColumn(col, inputs);
+}
+
+// Read the guessed outputs from a column of the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::GuessBatch<batchSize>::getOutputs(uint16_t col, T(&outputs)[numOutputs]) const
+{
+    outputValues.getColumn(col, outputs);
+}
+
+// Constructor - every input byte is multiplied by inputScale
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline NeuralNet<numInputs, numHidden, numOutputs, T>::ByteGuessBatch<batchSize>::ByteGuessBatch(T inputScale)
+    : inputBytes((size_t)numInputs * batchSize, 0),
+      inputScale(inputScale)
+{
+
+}
+
+// Pack an input into a column of the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::ByteGuessBatch<batchSize>::setInputs(uint16_t col, const uint8_t(&inputs)[numInputs])
+{
+    if (col >= batchSize)
+    {
+#if _DEBUG
+        printf("ByteGuessBatch - Set Inputs: Invalid Column %u\n", col);
+#endif
+        return;
+    }
+
+    for (uint16_t row = 0; row < numInputs; ++row)
+    {
+        inputBytes[(uint64_t)row * batchSize + col] = inputs[row];
+    }
+}
+
+// Read the guessed outputs from a column of the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::ByteGuessBatch<batchSize>::getOutputs(uint16_t col, T(&outputs)[numOutputs]) const
+{
+    outputValues.getColumn(col, outputs);
+}
+
+// Pack an input and expected answer into a column of the batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::Batch<batchSize>::setSample(uint16_t col, const T(&inputs)[numInputs], const T(&answers)[numOutputs])
+{
+    inputValues.setColumn(col, inputs);
+    answerValues.setColumn(col, answers);
+}
+
 // Print out the Weights and Bias of the Neural Net
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::print()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::print()
 {
     printf("Input Weights:\n");
     inputWeights.print();
@@ -398,36 +1071,94 @@ inline void NeuralNet<numInputs, numHidden, numOutputs>::print()
 // Feed Fordward Functions //
 /////////////////////////////
 // Calculate Hidden Layer Values based on Input
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::inputToHidden()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::inputToHidden()
 {
-    // Multiply Input Values by Input Weights
-    inputWeights.multiply(inputValues, hiddenValues);
-
-    // Add Input Bias
-    hiddenValues.add(inputBias);
+    NN_PROFILE_SCOPE("inputToHidden");
 
-    // Apply activation funciton
-    hiddenValues.applyFunction(actFunct);
+    // Multiply Input Values by Input Weights, add Input Bias and apply the
+    // activation funciton as each value is finished
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)outputActivation;
+        inputWeights.multiply(inputValues, hiddenValues, Kernels::BiasActivation<T, decltype(hiddenActivation)>{ inputBias.getData() });
+    });
 }
 
 // Calculate Output Values based on Hidden
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::hiddenToOutput()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::hiddenToOutput()
 {
-    // Multiply Hidden values by hidden weights
-    hiddenWeights.multiply(hiddenValues, outputValues);
+    NN_PROFILE_SCOPE("hiddenToOutput");
 
-    // Add hidden bias
-    outputValues.add(hiddenBias);
+    // Multiply Hidden values by hidden weights, add hidden bias and apply the
+    // activation funciton as each value is finished
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)hiddenActivation;
+        hiddenWeights.multiply(hiddenValues, outputValues, Kernels::BiasActivation<T, decltype(outputActivation)>{ hiddenBias.getData() });
 
-    // Apply activation funciton
-    outputValues.applyFunction(actFunct);
+        if (decltype(outputActivation)::NORMALIZE_COLUMNS)
+        {
+            outputValues.softmaxColumns();
+        }
+    });
+}
+
+// Calculate Output Values for a batch of packed Inputs
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::batchToOutput(Matrix<numInputs, batchSize, T> &inputs, Matrix<numHidden, batchSize, T> &hidden, Matrix<numOutputs, batchSize, T> &outputs) const
+{
+    NN_PROFILE_SCOPE("batchToOutput");
+
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        typedef Kernels::BiasActivation<T, decltype(hiddenActivation)> HiddenEpilogue;
+        typedef Kernels::BiasActivation<T, decltype(outputActivation)> OutputEpilogue;
+
+        // Hidden = act(Input Weights * Inputs + Input Bias)
+        inputWeights.multiply(inputs, hidden, HiddenEpilogue{ inputBias.getData() });
+
+        // Outputs = act(Hidden Weights * Hidden + Hidden Bias)
+        hiddenWeights.multiply(hidden, outputs, OutputEpilogue{ hiddenBias.getData() });
+
+        if (decltype(outputActivation)::NORMALIZE_COLUMNS)
+        {
+            outputs.softmaxColumns();
+        }
+    });
+}
+
+// Calculate Output Values for a batch of packed byte Inputs
+// inputs is numInputs x batchSize row-major bytes, converted by the product itself
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t batchSize>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::byteBatchToOutput(const uint8_t* inputs, T inputScale, Matrix<numHidden, batchSize, T> &hidden, Matrix<numOutputs, batchSize, T> &outputs) const
+{
+    NN_PROFILE_SCOPE("byteBatchToOutput");
+
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        typedef Kernels::BiasActivation<T, decltype(hiddenActivation)> HiddenEpilogue;
+        typedef Kernels::BiasActivation<T, decltype(outputActivation)> OutputEpilogue;
+
+        // Hidden = act(Input Weights * (Input Scale * Inputs) + Input Bias)
+        inputWeights.template multiply<batchSize>(inputs, inputScale, hidden, HiddenEpilogue{ inputBias.getData() });
+
+        // Outputs = act(Hidden Weights * Hidden + Hidden Bias)
+        hiddenWeights.multiply(hidden, outputs, OutputEpilogue{ hiddenBias.getData() });
+
+        if (decltype(outputActivation)::NORMALIZE_COLUMNS)
+        {
+            outputs.softmaxColumns();
+        }
+    });
 }
 
 // Calculate output error based on output and answers
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateOutputError(const double_t(&answers)[numOutputs])
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateOutputError(const T(&answers)[numOutputs])
 {
     // Error = Answers - Outputs
     outputError.fill(answers);
@@ -436,88 +1167,92 @@ inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateOutputError(co
 }
 
 // Calculate output Gradient
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateOutputGradient()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateOutputGradient()
 {
-    outputGradient = outputValues;
-
-    // Output * (1 - Output)
-    outputGradient.applyFunction(actFunctDeriv);
-
-    // Error times output derivative
-    outputGradient.scale(outputError);
-
-    // Scale gradient by learning rate
-    outputGradient.scale(learningRate);
+    // Output derivative times Error, scaled by learning rate
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)hiddenActivation;
+        outputGradient.template activationGradient<decltype(outputActivation)>(outputValues, outputError, getStepScale());
+    });
 }
 
 // Calculate and Apply the hidden wieght adjustments
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateHiddenDelta(const double_t(&answers)[numOutputs])
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateHiddenDelta(const T(&answers)[numOutputs])
 {
+    NN_PROFILE_SCOPE("calculateHiddenDelta");
+
     // Calculate the output Error
     calculateOutputError(answers);
 
     // Calculate output Gradients
     calculateOutputGradient();
 
-    // Multiply Gradient by Transposed Hidden Values to get Delta Hidden Weights
-    hiddenValues.transpose(hiddenValuesTransposed);
-    outputGradient.multiply(hiddenValuesTransposed, hiddenWeightsAdjustment);
-
-    // Apply Hidden Weight Adjustments
-    hiddenWeights.add(hiddenWeightsAdjustment);
+    // Apply Hidden Weight Adjustments - Gradient times Transposed Hidden Values,
+    // added as a rank-1 update so the adjustment is never stored
+    if (optimizer.isPlain())
+    {
+        hiddenWeights.addOuterProduct(outputGradient, hiddenValues);
 
-    // Apply Hidden Bias Adjustments (just the hidden gradient)
-    hiddenBias.add(outputGradient);
+        // Apply Hidden Bias Adjustments (just the hidden gradient)
+        hiddenBias.add(outputGradient);
+    }
+    else
+    {
+        optimizer.updateOuterProduct(hiddenWeights, outputGradient, hiddenValues, hiddenWeightsMoments);
+        optimizer.update(hiddenBias, outputGradient, hiddenBiasMoments);
+    }
 }
 
 // Calculate hidden error based on output error and hidden weights
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateHiddenError()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateHiddenError()
 {
-    // Transpose Hidden Weights
-    hiddenWeights.transpose(hiddenWeightsTransposed);
-
-    // Calculate Hidden Error
-    hiddenWeightsTransposed.multiply(outputError, hiddenError);
+    // Calculate Hidden Error - Transposed Hidden Weights times Output Error,
+    // read from the Hidden Weights in place
+    hiddenWeights.transposeMultiply(outputError, hiddenError);
 }
 
 // Calculate hidden gradient
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateHiddenGradient()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateHiddenGradient()
 {
-    hiddenGradient = hiddenValues;
-
-    // Hidden * (1 - Hidden)
-    hiddenGradient.applyFunction(actFunctDeriv);
-
-    // Error times hidden derivative
-    hiddenGradient.scale(hiddenError);
-
-    // Scale gradient by learning rate
-    hiddenGradient.scale(learningRate);
+    // Hidden derivative times Hidden Error, scaled by learning rate
+    NN::withActivation<T>(activationFunciton, [&](auto hiddenActivation, auto outputActivation)
+    {
+        (void)outputActivation;
+        hiddenGradient.template activationGradient<decltype(hiddenActivation)>(hiddenValues, hiddenError, getStepScale());
+    });
 }
 
 // Calculate and Apply  input weight adjustments
-template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs>
-inline void NeuralNet<numInputs, numHidden, numOutputs>::calculateInputDelta()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void NeuralNet<numInputs, numHidden, numOutputs, T>::calculateInputDelta()
 {
+    NN_PROFILE_SCOPE("calculateInputDelta");
+
     // Calculate the Hidden Error
     calculateHiddenError();
 
     // Calculate the Hidden Gradients
     calculateHiddenGradient();
 
-    // Multiply Gradient by Transposed Input Values to get Delta Input Weights
-    inputValues.transpose(inputValuesTransposed);
-    hiddenGradient.multiply(inputValuesTransposed, inputWeightsAdjustment);
-
-    // Apply Input Weight Adjustments
-    inputWeights.add(inputWeightsAdjustment);
+    // Apply Input Weight Adjustments - Gradient times Transposed Input Values,
+    // added as a rank-1 update so the adjustment is never stored
+    if (optimizer.isPlain())
+    {
+        inputWeights.addOuterProduct(hiddenGradient, inputValues);
 
-    // Apply Input Bias Adjustments (just the hidden gradient)
-    inputBias.add(hiddenGradient);
+        // Apply Input Bias Adjustments (just the hidden gradient)
+        inputBias.add(hiddenGradient);
+    }
+    else
+    {
+        optimizer.updateOuterProduct(inputWeights, hiddenGradient, inputValues, inputWeightsMoments);
+        optimizer.update(inputBias, hiddenGradient, inputBiasMoments);
+    }
 }
 #endif
 
@@ -0,0 +1,300 @@
+//-----------------------------------------------------------------------------
+// File: Optimizer.h
+// Author: Edward Koch
+// Description: Holds the declaration of the Optimizer Class
+//              Turns the descent step that back propagation produces for a
+//              weight matrix into an update of it - plain SGD, momentum,
+//              Nesterov momentum, RMSProp, Adam or AdamW
+//
+//              Running moments live in a Moments object kept next to the
+//              matrix they belong to, and every update is one fused,
+//              vectorised pass over the weights, the step and the moments
+//
+//              Moments are empty until an update needs them, so plain SGD
+//              costs no memory beyond the weights
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Lazy Moments and Per-Sample Updates
+//-----------------------------------------------------------------------------
+#ifndef OPTIMIZER_H
+#define OPTIMIZER_H
+
+#include "Matrix.h"
+#include "MatrixSimd.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <vector>
+
+namespace NN
+{
+    enum class Optimizers : uint8_t
+    {
+        SGD,        // Add the step, already scaled by the learning rate
+        MOMENTUM,   // Heavy ball - a decaying sum of past steps
+        NESTEROV,   // Momentum evaluated one step ahead
+        RMSPROP,    // Step divided by the root mean square of recent steps
+        ADAM,       // Bias corrected mean over root mean square, L2 weight decay
+        ADAMW       // Adam with the weight decay applied to the weights directly
+    };
+};
+
+// Running moments of one weight matrix - empty until an optimizer that keeps moments updates it
+template<uint16_t numRows, uint16_t numCols, typename T = double_t>
+class Moments
+{
+public:
+    static const uint64_t LENGTH = (uint64_t)numRows * numCols;
+
+    // Release the moments - the next update that needs them starts from zero
+    void clear() { values.clear(); values.shrink_to_fit(); }
+
+    // Allocate zeroed moments if there are none
+    void allocate() { if (values.empty()) { values.assign(LENGTH * 2, (T)0.0); } }
+
+    // Whether the moments have been allocated
+    bool isAllocated() const { return !values.empty(); }
+
+    // Velocity (MOMENTUM, NESTEROV) or mean step (ADAM, ADAMW) - null until allocated
+    T* first() { return values.empty() ? nullptr : values.data(); }
+
+    // Mean squared step (RMSPROP, ADAM, ADAMW) - null until allocated
+    T* second() { return values.empty() ? nullptr : values.data() + LENGTH; }
+
+private:
+    std::vector<T> values;
+};
+
+template<typename T = double_t>
+class Optimizer
+{
+public:
+    // Hyper-parameters - the learning rate belongs to the Neural Net, so it can be scheduled
+    struct Settings
+    {
+        NN::Optimizers type;
+        T momentum;         // Velocity decay of MOMENTUM and NESTEROV
+        T beta1;            // Mean step decay of ADAM and ADAMW
+        T beta2;            // Mean squared step decay of RMSPROP, ADAM and ADAMW
+        T epsilon;          // Added to the root mean square so the update stays finite
+        T weightDecay;      // Pull of every weight towards 0 per unit of learning rate
+    };
+
+    // Get the usual settings of an optimizer type
+    static Settings defaults(NN::Optimizers type);
+
+    // Constructor - plain SGD unless other settings are given
+    Optimizer(const Settings &settings = defaults(NN::Optimizers::SGD));
+
+    // Set the hyper-parameters and restart the bias correction
+    // Any Moments in use must be cleared as well
+    void setSettings(const Settings &newSettings);
+
+    // Get the hyper-parameters
+    const Settings& getSettings() const { return settings; }
+
+    // Whether the update keeps Moments - if not, the step it is given must
+    // already be scaled by the learning rate
+    bool usesMoments() const { return settings.type != NN::Optimizers::SGD; }
+
+    // Whether the update only adds the step - SGD without weight decay
+    bool isPlain() const { return !usesMoments() && settings.weightDecay == (T)0.0; }
+
+    // Get the number of updates started
+    uint64_t getNumSteps() const { return numSteps; }
+
+    // Start the next update of every weight matrix at the given learning rate
+    void beginStep(T learningRate);
+
+    // Update a weight matrix with its step - the descent direction summed over the batch
+    template<uint16_t numRows, uint16_t numCols>
+    void update(Matrix<numRows, numCols, T> &weights, const Matrix<numRows, numCols, T> &step, Moments<numRows, numCols, T> &moments) const;
+
+    // Update a weight matrix with the step of one sample, column * row^T, a row
+    // at a time - the step matrix is never stored
+    template<uint16_t numRows, uint16_t numCols>
+    void updateOuterProduct(Matrix<numRows, numCols, T> &weights, const Matrix<numRows, 1, T> &column, const Matrix<numCols, 1, T> &row,
+                            Moments<numRows, numCols, T> &moments) const;
+
+    // Update len weights with their steps and moments
+    void update(T* weights, const T* step, T* first, T* second, uint64_t len) const;
+
+private:
+    Settings settings;
+    uint64_t numSteps;
+
+    // Coefficients of the current update
+    T rate;
+    T epsilon;
+    T weightScale;
+};
+
+// Get the usual settings of an optimizer type
+template<typename T>
+inline typename Optimizer<T>::Settings Optimizer<T>::defaults(NN::Optimizers type)
+{
+    Settings settings = { type, (T)0.9, (T)0.9, (T)0.999, (T)1e-8, (T)0.0 };
+
+    if (type == NN::Optimizers::RMSPROP)
+    {
+        settings.beta2 = (T)0.99;
+    }
+    else if (type == NN::Optimizers::ADAMW)
+    {
+        settings.weightDecay = (T)0.01;
+    }
+
+    return settings;
+}
+
+// Constructor - plain SGD unless other settings are given
+template<typename T>
+inline Optimizer<T>::Optimizer(const Settings &settings)
+    : settings(settings),
+      numSteps(0),
+      rate((T)0.0),
+      epsilon(settings.epsilon),
+      weightScale((T)1.0)
+{
+}
+
+// Set the hyper-parameters and restart the bias correction
+template<typename T>
+inline void Optimizer<T>::setSettings(const Settings &newSettings)
+{
+    settings = newSettings;
+    numSteps = 0;
+    epsilon = settings.epsilon;
+}
+
+// Start the next update of every weight matrix at the given learning rate
+template<typename T>
+inline void Optimizer<T>::beginStep(T learningRate)
+{
+    ++numSteps;
+
+    rate = learningRate;
+    epsilon = settings.epsilon;
+    weightScale = (T)1.0;
+
+    switch (settings.type)
+    {
+    case NN::Optimizers::SGD:
+        weightScale = (T)1.0 - learningRate * settings.weightDecay;
+        break;
+
+    case NN::Optimizers::ADAM:
+    case NN::Optimizers::ADAMW:
+    {
+        // The moments start at 0 and are biased towards it early on - folding
+        // the correction into the rate and epsilon keeps the kernel to one pass
+        double_t correction1 = 1.0 - pow((double_t)settings.beta1, (double_t)numSteps);
+        double_t correction2 = 1.0 - pow((double_t)settings.beta2, (double_t)numSteps);
+
+        rate = (T)(learningRate * sqrt(correction2) / correction1);
+        epsilon = (T)(settings.epsilon * sqrt(correction2));
+
+        if (settings.type == NN::Optimizers::ADAMW)
+        {
+            weightScale = (T)1.0 - learningRate * settings.weightDecay;
+        }
+        break;
+    }
+
+    default:
+        break;
+    }
+}
+
+// Update a weight matrix with its step - the descent direction summed over the batch
+template<typename T>
+template<uint16_t numRows, uint16_t numCols>
+inline void Optimizer<T>::update(Matrix<numRows, numCols, T> &weights, const Matrix<numRows, numCols, T> &step, Moments<numRows, numCols, T> &moments) const
+{
+    if (usesMoments())
+    {
+        moments.allocate();
+    }
+
+    update(weights.getData(), step.getData(), moments.first(), moments.second(), weights.getLength());
+}
+
+// Update a weight matrix with the step of one sample, column * row^T, a row at a time
+template<typename T>
+template<uint16_t numRows, uint16_t numCols>
+inline void Optimizer<T>::updateOuterProduct(Matrix<numRows, numCols, T> &weights, const Matrix<numRows, 1, T> &column, const Matrix<numCols, 1, T> &row,
+                                             Moments<numRows, numCols, T> &moments) const
+{
+    const Simd::Ops<T> &ops = Simd::ops<T>();
+
+    if (usesMoments())
+    {
+        moments.allocate();
+    }
+
+    // One row of the step - reused for every row of the weights
+    thread_local std::vector<T> scratch;
+
+    if (scratch.size() < numCols)
+    {
+        scratch.resize(numCols);
+    }
+
+    T* rowStep = scratch.data();
+    T* first = moments.first();
+    T* second = moments.second();
+
+    for (uint16_t r = 0; r < numRows; ++r)
+    {
+        uint64_t offset = (uint64_t)r * numCols;
+
+        ops.copy(rowStep, row.getData(), numCols);
+        ops.mulScalar(rowStep, column.getData()[r], numCols);
+
+        update(weights.getData() + offset, rowStep, first ? first + offset : nullptr, second ? second + offset : nullptr, numCols);
+    }
+}
+
+// Update len weights with their steps and moments
+template<typename T>
+inline void Optimizer<T>::update(T* weights, const T* step, T* first, T* second, uint64_t len) const
+{
+    const Simd::Ops<T> &ops = Simd::ops<T>();
+
+    switch (settings.type)
+    {
+    case NN::Optimizers::MOMENTUM:
+        ops.momentum(weights, first, step, settings.momentum, settings.weightDecay, rate, (T)0.0, len);
+        break;
+
+    case NN::Optimizers::NESTEROV:
+        ops.momentum(weights, first, step, settings.momentum, settings.weightDecay, rate * settings.momentum, rate, len);
+        break;
+
+    case NN::Optimizers::RMSPROP:
+        ops.rmsProp(weights, second, step, settings.beta2, rate, epsilon, settings.weightDecay, len);
+        break;
+
+    case NN::Optimizers::ADAM:
+        ops.adam(weights, first, second, step, settings.beta1, settings.beta2, rate, epsilon, settings.weightDecay, (T)1.0, len);
+        break;
+
+    case NN::Optimizers::ADAMW:
+        ops.adam(weights, first, second, step, settings.beta1, settings.beta2, rate, epsilon, (T)0.0, weightScale, len);
+        break;
+
+    default:
+        // SGD - the step is already scaled by the learning rate
+        if (weightScale != (T)1.0)
+        {
+            ops.mulScalar(weights, weightScale, len);
+        }
+        ops.add(weights, step, len);
+        break;
+    }
+}
+
+#endif
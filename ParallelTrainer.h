@@ -0,0 +1,202 @@
+//-----------------------------------------------------------------------------
+// File: ParallelTrainer.h
+// Author: Edward Koch
+// Description: Holds the declaration of the ParallelTrainer Class
+//              Data-parallel mini-batch training - the batch is split into a
+//              fixed number of shards, the workers take turns back propagating
+//              them into private adjustments, the adjustments are all-reduced
+//              and the Neural Net is updated once per batch
+//
+//              The batch size and the shards are fixed at compile time and the
+//              reduction always sums the shards in the same order, so a run
+//              trains identically however many cores the machine has
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Templated Element Type
+// E. Koch    10/17/26    Phase Profiling
+// E. Koch    10/17/26    Fixed Batch Size on any Number of Cores
+//-----------------------------------------------------------------------------
+#ifndef PARALLEL_TRAINER_H
+#define PARALLEL_TRAINER_H
+
+#include "Matrix.h"
+#include "NeuralNet.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T = double_t, uint16_t shardSize = 8>
+class ParallelTrainer
+{
+    static_assert(shardSize > 0 && batchSize % shardSize == 0, "The batch size must be a multiple of the shard size");
+
+public:
+    typedef NeuralNet<numInputs, numHidden, numOutputs, T> Network;
+    typedef typename Network::template Batch<shardSize> Shard;
+
+    // Number of shards in a mini-batch - the most workers that can be busy at once
+    static const uint16_t NUM_SHARDS = batchSize / shardSize;
+
+    // Constructor - numWorkers of 0 uses one worker per hardware thread
+    // Workers are capped at NUM_SHARDS (batchSize / shardSize) - a machine only
+    // uses all of its cores if the batch has at least one shard per core
+    ParallelTrainer(Network &net, uint16_t numWorkers = 0);
+
+    // Destructor
+    ~ParallelTrainer();
+
+    // Get the number of workers training in parallel
+    uint16_t getNumWorkers() const { return pool.getNumWorkers(); }
+
+    // Get the number of samples in a full mini-batch - the same on every machine
+    uint32_t getBatchSize() const { return batchSize; }
+
+    // Pack an input and expected answer into the mini-batch - index must be less than getBatchSize()
+    void setSample(uint32_t index, const T(&inputs)[numInputs], const T(&answers)[numOutputs]);
+
+    // Train the Neural Net on the packed mini-batch - one weight update for the whole batch
+    void train();
+
+private:
+    ParallelTrainer(const ParallelTrainer &other) = delete;
+    ParallelTrainer& operator=(const ParallelTrainer &other) = delete;
+
+    // Neural Net being trained
+    Network &net;
+
+    // Worker Threads
+    ThreadPool pool;
+
+    // Shards of the batch, each with its own adjustments
+    std::vector<Shard*> shards;
+
+    // Get the number of workers a machine's hardware threads are worth - at most one per shard
+    static uint16_t workersFor(uint16_t numWorkers);
+
+    // Sum this worker's slice of every shard's adjustments into the first shard
+    void reduceSlice(uint16_t workerIdx);
+
+    // Sum this worker's slice of one adjustment matrix across all shards
+    template<uint16_t numRows, uint16_t numCols>
+    void reduceMatrix(uint16_t workerIdx, Matrix<numRows, numCols, T> Shard::* adjustment);
+};
+
+// Constructor - numWorkers of 0 uses one worker per hardware thread, at most NUM_SHARDS
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::ParallelTrainer(Network &net, uint16_t numWorkers)
+    : net(net),
+      pool(workersFor(numWorkers))
+{
+    for (uint16_t i = 0; i < NUM_SHARDS; ++i)
+    {
+        shards.push_back(new Shard());
+    }
+}
+
+// Get the number of workers a machine's hardware threads are worth - at most one per shard
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline uint16_t ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::workersFor(uint16_t numWorkers)
+{
+    if (numWorkers == 0)
+    {
+        numWorkers = (uint16_t)std::thread::hardware_concurrency();
+    }
+
+    if (numWorkers == 0)
+    {
+        numWorkers = 1;
+    }
+
+    return (numWorkers < NUM_SHARDS) ? numWorkers : NUM_SHARDS;
+}
+
+// Destructor
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::~ParallelTrainer()
+{
+    for (Shard* shard : shards)
+    {
+        delete shard;
+    }
+}
+
+// Pack an input and expected answer into the mini-batch - index must be less than getBatchSize()
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline void ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::setSample(uint32_t index, const T(&inputs)[numInputs], const T(&answers)[numOutputs])
+{
+    if (index >= getBatchSize())
+    {
+#if _DEBUG
+        printf("ParallelTrainer - Set Sample: Invalid Index %u\n", index);
+#endif
+        return;
+    }
+
+    shards[index / shardSize]->setSample(index % shardSize, inputs, answers);
+}
+
+// Train the Neural Net on the packed mini-batch - one weight update for the whole batch
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline void ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::train()
+{
+    NN_PROFILE_SCOPE("parallelTrain");
+
+    // The workers take turns to feed forward and back propagate the shards
+    pool.run([this](uint16_t workerIdx)
+    {
+        for (uint16_t shard = workerIdx; shard < NUM_SHARDS; shard += pool.getNumWorkers())
+        {
+            net.calculateBatchDelta(*shards[shard]);
+        }
+    });
+
+    // All-reduce - each worker sums a disjoint slice of the adjustments
+    // across every shard, so the reduction is spread over all cores and
+    // every element is summed in shard order whatever the number of workers
+    pool.run([this](uint16_t workerIdx)
+    {
+        reduceSlice(workerIdx);
+    });
+
+    // Apply the summed adjustments once
+    net.applyBatchDelta(*shards[0]);
+}
+
+// Sum this worker's slice of every shard's adjustments into the first shard
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+inline void ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::reduceSlice(uint16_t workerIdx)
+{
+    NN_PROFILE_SCOPE("reduceSlice");
+
+    reduceMatrix(workerIdx, &Shard::hiddenWeightsAdjustment);
+    reduceMatrix(workerIdx, &Shard::hiddenBiasAdjustment);
+    reduceMatrix(workerIdx, &Shard::inputWeightsAdjustment);
+    reduceMatrix(workerIdx, &Shard::inputBiasAdjustment);
+}
+
+// Sum this worker's slice of one adjustment matrix across all shards
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, uint16_t batchSize, typename T, uint16_t shardSize>
+template <uint16_t numRows, uint16_t numCols>
+inline void ParallelTrainer<numInputs, numHidden, numOutputs, batchSize, T, shardSize>::reduceMatrix(uint16_t workerIdx, Matrix<numRows, numCols, T> Shard::* adjustment)
+{
+    uint64_t length = (shards[0]->*adjustment).getLength();
+    uint16_t numWorkers = pool.getNumWorkers();
+
+    uint64_t begin = length * workerIdx / numWorkers;
+    uint64_t end = length * (workerIdx + 1) / numWorkers;
+
+    T* sum = (shards[0]->*adjustment).getData();
+
+    for (uint16_t i = 1; i < NUM_SHARDS; ++i)
+    {
+        Simd::ops<T>().add(sum + begin, (shards[i]->*adjustment).getData() + begin, end - begin);
+    }
+}
+
+#endif
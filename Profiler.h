@@ -0,0 +1,551 @@
+//-----------------------------------------------------------------------------
+// File: Profiler.h
+// Author: Edward Koch
+// Description: Holds the declaration of the Profiler
+//              Scoped phase timers and event counters for the hot paths,
+//              switched on at compile time with NN_PROFILE=1
+//
+//              NN_PROFILE_SCOPE("phase") times the rest of the enclosing
+//              scope and NN_PROFILE_COUNT("counter", n) adds n to a counter.
+//              With NN_PROFILE off (the default) both expand to nothing and
+//              the Profiler API below does not exist
+//
+//              Timers read the time stamp counter (rdtsc) on x86 and the
+//              steady clock elsewhere. Every thread records into its own log,
+//              so timing a phase takes no lock - the logs are only merged by
+//              report and writeChromeTrace, which must be called while no
+//              profiled code is running (e.g. after training)
+//
+//              Each phase keeps a histogram of its durations with 8 buckets
+//              per power of two (percentiles within ~6%) and, until the trace
+//              buffer is full, every call as a Chrome trace event
+//              (chrome://tracing or https://ui.perfetto.dev)
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifndef NN_PROFILE
+#define NN_PROFILE 0
+#endif
+
+#if NN_PROFILE
+
+#include <atomic>
+#include <chrono>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define NN_PROFILE_RDTSC 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#else
+#define NN_PROFILE_RDTSC 0
+#endif
+
+#define NN_PROFILE_CONCAT_INNER(a, b) a##b
+#define NN_PROFILE_CONCAT(a, b) NN_PROFILE_CONCAT_INNER(a, b)
+
+// Time the rest of the enclosing scope as the named phase
+// The name is registered once per call site
+#define NN_PROFILE_SCOPE(name) \
+    static const uint16_t NN_PROFILE_CONCAT(nnProfileId, __LINE__) = Profiler::registerName(name); \
+    Profiler::ScopedTimer NN_PROFILE_CONCAT(nnProfileTimer, __LINE__)(NN_PROFILE_CONCAT(nnProfileId, __LINE__))
+
+// Add value to the named counter
+#define NN_PROFILE_COUNT(name, value) \
+    do \
+    { \
+        static const uint16_t nnProfileId = Profiler::registerName(name); \
+        Profiler::count(nnProfileId, (uint64_t)(value)); \
+    } while (0)
+
+namespace Profiler
+{
+    // Histogram buckets - values below SUB_BUCKETS have a bucket each, then
+    // every power of two is split into SUB_BUCKETS equal buckets
+    const uint8_t SUB_BUCKET_BITS = 3;
+    const uint16_t SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    const uint16_t NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Trace events kept per thread by default - later calls are still timed
+    // but are left out of the trace
+    const uint64_t DEFAULT_TRACE_CAPACITY = 1 << 18;
+
+    // Current time in ticks
+    inline uint64_t ticks()
+    {
+#if NN_PROFILE_RDTSC
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // Histogram bucket of a duration in ticks
+    inline uint16_t bucketOf(uint64_t value)
+    {
+        if (value < SUB_BUCKETS)
+        {
+            return (uint16_t)value;
+        }
+
+        uint8_t exponent = 63;
+        while ((value >> exponent) == 0)
+        {
+            --exponent;
+        }
+
+        uint8_t shift = exponent - SUB_BUCKET_BITS;
+        return (uint16_t)((shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1)));
+    }
+
+    // Smallest duration in ticks that falls in a bucket
+    inline uint64_t bucketLower(uint16_t bucket)
+    {
+        if (bucket < SUB_BUCKETS)
+        {
+            return bucket;
+        }
+
+        uint8_t shift = (uint8_t)(bucket / SUB_BUCKETS - 1);
+        return (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+    }
+
+    // Timings of one phase on one thread
+    struct PhaseStats
+    {
+        uint64_t calls = 0;
+        uint64_t totalTicks = 0;
+        uint64_t minTicks = UINT64_MAX;
+        uint64_t maxTicks = 0;
+        uint64_t buckets[NUM_BUCKETS] = { 0 };
+
+        // Add the timings of another thread
+        void merge(const PhaseStats &other);
+
+        // Duration in ticks that fraction of the calls were no slower than
+        uint64_t percentile(double_t fraction) const;
+    };
+
+    // One timed call of a phase
+    struct TraceEvent
+    {
+        uint16_t id;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    // Everything recorded by one thread - only written by that thread
+    struct ThreadLog
+    {
+        uint32_t threadIndex = 0;
+        std::vector<std::unique_ptr<PhaseStats>> phases;
+        std::vector<uint64_t> counters;
+        std::vector<TraceEvent> events;
+        uint64_t droppedEvents = 0;
+    };
+
+    // Names, thread logs and settings shared by every thread
+    struct Registry
+    {
+        std::mutex mutex;
+        std::vector<std::string> names;
+        std::vector<std::unique_ptr<ThreadLog>> logs;
+        std::atomic<bool> tracing{ true };
+        std::atomic<uint64_t> traceCapacity{ DEFAULT_TRACE_CAPACITY };
+        uint64_t startTicks = ticks();
+    };
+
+    inline Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // Get the id of a phase or counter name, registering it on first use
+    inline uint16_t registerName(const char* name)
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        for (uint16_t id = 0; id < reg.names.size(); ++id)
+        {
+            if (reg.names[id] == name)
+            {
+                return id;
+            }
+        }
+
+        reg.names.push_back(name);
+        return (uint16_t)(reg.names.size() - 1);
+    }
+
+    // Get the calling thread's log - created on the thread's first record
+    inline ThreadLog& threadLog()
+    {
+        thread_local ThreadLog* log = nullptr;
+
+        if (log == nullptr)
+        {
+            Registry &reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+
+            reg.logs.emplace_back(new ThreadLog());
+            log = reg.logs.back().get();
+            log->threadIndex = (uint32_t)(reg.logs.size() - 1);
+        }
+
+        return *log;
+    }
+
+    // Record one timed call of a phase on the calling thread
+    inline void record(uint16_t id, uint64_t start, uint64_t end)
+    {
+        ThreadLog &log = threadLog();
+
+        if (log.phases.size() <= id)
+        {
+            log.phases.resize(id + 1);
+        }
+        if (!log.phases[id])
+        {
+            log.phases[id].reset(new PhaseStats());
+        }
+
+        PhaseStats &stats = *log.phases[id];
+        uint64_t duration = end - start;
+
+        ++stats.calls;
+        stats.totalTicks += duration;
+        stats.minTicks = (duration < stats.minTicks) ? duration : stats.minTicks;
+        stats.maxTicks = (duration > stats.maxTicks) ? duration : stats.maxTicks;
+        ++stats.buckets[bucketOf(duration)];
+
+        Registry &reg = registry();
+        if (reg.tracing.load(std::memory_order_relaxed))
+        {
+            if (log.events.size() < reg.traceCapacity.load(std::memory_order_relaxed))
+            {
+                log.events.push_back(TraceEvent{ id, start, duration });
+            }
+            else
+            {
+                ++log.droppedEvents;
+            }
+        }
+    }
+
+    // Add value to a counter on the calling thread
+    inline void count(uint16_t id, uint64_t value)
+    {
+        ThreadLog &log = threadLog();
+
+        if (log.counters.size() <= id)
+        {
+            log.counters.resize(id + 1, 0);
+        }
+
+        log.counters[id] += value;
+    }
+
+    // Times the rest of the enclosing scope
+    class ScopedTimer
+    {
+    public:
+        explicit ScopedTimer(uint16_t id) : id(id), start(ticks()) {}
+        ~ScopedTimer() { record(id, start, ticks()); }
+
+    private:
+        ScopedTimer(const ScopedTimer &other) = delete;
+        ScopedTimer& operator=(const ScopedTimer &other) = delete;
+
+        uint16_t id;
+        uint64_t start;
+    };
+
+    // Record trace events or only the timings - on by default
+    inline void setTracing(bool enabled)
+    {
+        registry().tracing = enabled;
+    }
+
+    // Number of trace events kept per thread
+    inline void setTraceCapacity(uint64_t events)
+    {
+        registry().traceCapacity = events;
+    }
+
+    // Nanoseconds per tick - measured once against the steady clock
+    inline double_t nanosecondsPerTick()
+    {
+#if NN_PROFILE_RDTSC
+        static double_t ratio = []()
+        {
+            std::chrono::steady_clock::time_point clockStart = std::chrono::steady_clock::now();
+            uint64_t tickStart = ticks();
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+            uint64_t tickEnd = ticks();
+            double_t elapsed = std::chrono::duration<double_t, std::nano>(std::chrono::steady_clock::now() - clockStart).count();
+
+            return elapsed / (double_t)(tickEnd - tickStart);
+        }();
+
+        return ratio;
+#else
+        return 1.0;
+#endif
+    }
+
+    // Merge the timings of every thread into one PhaseStats per name
+    inline std::vector<PhaseStats> mergePhases()
+    {
+        Registry &reg = registry();
+        std::vector<PhaseStats> merged(reg.names.size());
+
+        for (const std::unique_ptr<ThreadLog> &log : reg.logs)
+        {
+            for (uint16_t id = 0; id < log->phases.size(); ++id)
+            {
+                if (log->phases[id])
+                {
+                    merged[id].merge(*log->phases[id]);
+                }
+            }
+        }
+
+        return merged;
+    }
+
+    // Print every phase (calls, total and percentiles) and counter
+    inline void report(FILE* out = stdout)
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        std::vector<PhaseStats> phases = mergePhases();
+        double_t nsPerTick = nanosecondsPerTick();
+
+        fprintf(out, "%-24s %10s %12s %10s %10s %10s %10s %10s %10s\n",
+                "Phase", "Calls", "Total ms", "Mean ns", "Min ns", "p50 ns", "p90 ns", "p99 ns", "Max ns");
+
+        for (uint16_t id = 0; id < phases.size(); ++id)
+        {
+            const PhaseStats &stats = phases[id];
+
+            if (stats.calls == 0)
+            {
+                continue;
+            }
+
+            fprintf(out, "%-24s %10llu %12.3f %10.0f %10.0f %10.0f %10.0f %10.0f %10.0f\n",
+                    reg.names[id].c_str(), (unsigned long long)stats.calls,
+                    stats.totalTicks * nsPerTick * 1e-6,
+                    stats.totalTicks * nsPerTick / stats.calls,
+                    stats.minTicks * nsPerTick,
+                    stats.percentile(0.50) * nsPerTick,
+                    stats.percentile(0.90) * nsPerTick,
+                    stats.percentile(0.99) * nsPerTick,
+                    stats.maxTicks * nsPerTick);
+        }
+
+        // Counters summed over every thread - phases share the id space but are never counted
+        for (uint16_t id = 0; id < reg.names.size(); ++id)
+        {
+            uint64_t total = 0;
+
+            for (const std::unique_ptr<ThreadLog> &log : reg.logs)
+            {
+                if (id < log->counters.size())
+                {
+                    total += log->counters[id];
+                }
+            }
+
+            if (total > 0)
+            {
+                fprintf(out, "%-24s %10llu\n", reg.names[id].c_str(), (unsigned long long)total);
+            }
+        }
+    }
+
+    // Print the duration histogram of a phase, one row per power of two
+    inline void printHistogram(const char* name, FILE* out = stdout)
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        std::vector<PhaseStats> phases = mergePhases();
+        double_t nsPerTick = nanosecondsPerTick();
+
+        for (uint16_t id = 0; id < phases.size(); ++id)
+        {
+            const PhaseStats &stats = phases[id];
+
+            if (reg.names[id] != name || stats.calls == 0)
+            {
+                continue;
+            }
+
+            fprintf(out, "%s - %llu calls\n", name, (unsigned long long)stats.calls);
+
+            // Fold the sub-buckets back into powers of two
+            for (uint16_t first = 0; first < NUM_BUCKETS; first += SUB_BUCKETS)
+            {
+                uint64_t calls = 0;
+                for (uint16_t bucket = first; bucket < first + SUB_BUCKETS; ++bucket)
+                {
+                    calls += stats.buckets[bucket];
+                }
+
+                if (calls == 0)
+                {
+                    continue;
+                }
+
+                uint64_t upper = (first + SUB_BUCKETS < NUM_BUCKETS) ? bucketLower(first + SUB_BUCKETS) : UINT64_MAX;
+                uint16_t width = (uint16_t)ceil(50.0 * calls / stats.calls);
+
+                fprintf(out, "  %12.0f - %12.0f ns %10llu %5.1f%% ",
+                        bucketLower(first) * nsPerTick, upper * nsPerTick,
+                        (unsigned long long)calls, 100.0 * calls / stats.calls);
+                for (uint16_t i = 0; i < width; ++i)
+                {
+                    fputc('#', out);
+                }
+                fputc('\n', out);
+            }
+        }
+    }
+
+    // Write every trace event as Chrome trace JSON, one track per thread
+    // Returns false if the file cannot be written
+    inline bool writeChromeTrace(const char* path)
+    {
+        FILE* file = fopen(path, "w");
+
+        if (file == nullptr)
+        {
+#if _DEBUG
+            printf("Profiler could not write %s\n", path);
+#endif
+            return false;
+        }
+
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        double_t usPerTick = nanosecondsPerTick() * 1e-3;
+        bool first = true;
+
+        fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+
+        for (const std::unique_ptr<ThreadLog> &log : reg.logs)
+        {
+            fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": %u, \"args\": {\"name\": \"thread %u\"}}",
+                    first ? "" : ",\n", log->threadIndex, log->threadIndex);
+            first = false;
+
+            for (const TraceEvent &event : log->events)
+            {
+                fprintf(file, ",\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}",
+                        reg.names[event.id].c_str(), log->threadIndex,
+                        (double_t)(int64_t)(event.start - reg.startTicks) * usPerTick,
+                        event.duration * usPerTick);
+            }
+
+            if (log->droppedEvents > 0)
+            {
+                fprintf(file, ",\n{\"name\": \"dropped events\", \"ph\": \"C\", \"pid\": 0, \"tid\": %u, \"ts\": 0, \"args\": {\"dropped\": %llu}}",
+                        log->threadIndex, (unsigned long long)log->droppedEvents);
+            }
+        }
+
+        fprintf(file, "\n]}\n");
+
+        return fclose(file) == 0;
+    }
+
+    // Discard every timing, counter and trace event - names stay registered
+    inline void reset()
+    {
+        Registry &reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+
+        for (const std::unique_ptr<ThreadLog> &log : reg.logs)
+        {
+            log->phases.clear();
+            log->counters.clear();
+            log->events.clear();
+            log->droppedEvents = 0;
+        }
+
+        reg.startTicks = ticks();
+    }
+
+    // Add the timings of another thread
+    inline void PhaseStats::merge(const PhaseStats &other)
+    {
+        calls += other.calls;
+        totalTicks += other.totalTicks;
+        minTicks = (other.minTicks < minTicks) ? other.minTicks : minTicks;
+        maxTicks = (other.maxTicks > maxTicks) ? other.maxTicks : maxTicks;
+
+        for (uint16_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+        {
+            buckets[bucket] += other.buckets[bucket];
+        }
+    }
+
+    // Duration in ticks that fraction of the calls were no slower than
+    // Reported as the middle of its bucket, clamped to the measured range
+    inline uint64_t PhaseStats::percentile(double_t fraction) const
+    {
+        uint64_t target = (uint64_t)ceil(fraction * calls);
+        uint64_t seen = 0;
+
+        for (uint16_t bucket = 0; bucket < NUM_BUCKETS; ++bucket)
+        {
+            seen += buckets[bucket];
+
+            if (seen >= target && buckets[bucket] > 0)
+            {
+                uint64_t lower = bucketLower(bucket);
+                uint64_t upper = (bucket + 1 < NUM_BUCKETS) ? bucketLower(bucket + 1) : maxTicks;
+                uint64_t middle = lower + (upper - lower) / 2;
+
+                return (middle < minTicks) ? minTicks : (middle > maxTicks) ? maxTicks : middle;
+            }
+        }
+
+        return maxTicks;
+    }
+};
+
+#else
+
+// Profiling compiled out
+#define NN_PROFILE_SCOPE(name)
+#define NN_PROFILE_COUNT(name, value) do { } while (0)
+
+#endif
+
+#endif
@@ -0,0 +1,524 @@
+//-----------------------------------------------------------------------------
+// File: QuantizedNet.h
+// Author: Edward Koch
+// Description: Holds the declaration of the QuantizedNet Class
+//              Post-training int8 copy of a trained Neural Net for inference
+//              Weights are int8 with one scale per row, activations are
+//              calibrated to 7 bit unsigned values so every layer runs as
+//              uint8 x int8 dot products with int32 accumulation
+//
+//              Activations are affine - real value = (quantized - zero point)
+//              * scale - so negative values (Tanh, Leaky ReLU) keep their sign.
+//              The zero point is taken back out of each dot product with the
+//              row's weight sum, so ranges that start at zero cost nothing
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Tanh, Leaky ReLU and Softmax Activations
+// E. Koch    10/17/26    Zero Points for Negative Activations
+//-----------------------------------------------------------------------------
+#ifndef QUANTIZED_NET_H
+#define QUANTIZED_NET_H
+
+#include "Matrix.h"
+#include "MatrixSimd.h"
+#include "NeuralNet.h"
+
+#include <math.h>
+#include <stdint.h>
+
+namespace Quantized
+{
+    // Largest quantized magnitude - activations are kept to 7 bits so a pair
+    // of uint8 x int8 products can never saturate the int16 sums of maddubs
+    const int32_t QUANT_MAX = 127;
+
+    // Rows are zero padded to a whole number of AVX-512 registers so the
+    // vector kernels never need a scalar tail
+    const uint16_t ROW_ALIGNMENT = 64;
+
+    constexpr uint16_t paddedLength(uint16_t length)
+    {
+        return (uint16_t)(((length + ROW_ALIGNMENT - 1) / ROW_ALIGNMENT) * ROW_ALIGNMENT);
+    }
+
+    // Dot product of unsigned activations and signed weights
+    // len must be a multiple of ROW_ALIGNMENT
+    typedef int32_t (*DotFunction)(const uint8_t* a, const int8_t* b, uint64_t len);
+
+    inline int32_t dotGeneric(const uint8_t* a, const int8_t* b, uint64_t len)
+    {
+        int32_t acc = 0;
+
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            acc += (int32_t)a[i] * (int32_t)b[i];
+        }
+
+        return acc;
+    }
+
+#if MATRIX_SIMD_X86
+    // maddubs multiplies 32 byte pairs and sums adjacent products to int16,
+    // madd against ones widens those sums to int32
+    MATRIX_TARGET_AVX2 inline int32_t dotAvx2(const uint8_t* a, const int8_t* b, uint64_t len)
+    {
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i acc = _mm256_setzero_si256();
+
+        for (uint64_t i = 0; i < len; i += 32)
+        {
+            __m256i va = _mm256_loadu_si256((const __m256i*)(a + i));
+            __m256i vb = _mm256_loadu_si256((const __m256i*)(b + i));
+
+            acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16(va, vb), ones));
+        }
+
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    // dpbusd multiplies 64 byte pairs and accumulates groups of four straight into int32
+    MATRIX_TARGET_AVX512VNNI inline int32_t dotVnni(const uint8_t* a, const int8_t* b, uint64_t len)
+    {
+        __m512i acc = _mm512_setzero_si512();
+
+        for (uint64_t i = 0; i < len; i += 64)
+        {
+            __m512i va = _mm512_loadu_si512((const void*)(a + i));
+            __m512i vb = _mm512_loadu_si512((const void*)(b + i));
+
+            acc = _mm512_dpbusd_epi32(acc, va, vb);
+        }
+
+        alignas(64) int32_t lanes[16];
+        _mm512_store_si512((void*)lanes, acc);
+
+        int32_t sum = 0;
+        for (uint16_t i = 0; i < 16; ++i)
+        {
+            sum += lanes[i];
+        }
+
+        return sum;
+    }
+#endif
+
+    // Query the AVX-512 VNNI extension - only meaningful once AVX-512 itself is usable
+    inline bool detectVnni()
+    {
+#if MATRIX_SIMD_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4] = { 0 };
+
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return false;
+        }
+
+        __cpuidex(info, 7, 0);
+        return (info[2] & (1 << 11)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx512vnni");
+#endif
+#else
+        return false;
+#endif
+    }
+
+    // Pick the widest dot product allowed by the active Simd level
+    // Follows Simd::setLevel, so a narrowed level also narrows the int8 kernels
+    inline DotFunction selectDot()
+    {
+#if MATRIX_SIMD_X86
+        static const bool vnni = detectVnni();
+
+        Simd::Level level = Simd::ops<float>().level;
+
+        if (level == Simd::Level::AVX512 && vnni)
+        {
+            return dotVnni;
+        }
+        if (level >= Simd::Level::AVX2)
+        {
+            return dotAvx2;
+        }
+#endif
+        return dotGeneric;
+    }
+};
+
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T = double_t>
+class QuantizedNet
+{
+public:
+    typedef NeuralNet<numInputs, numHidden, numOutputs, T> Network;
+
+    // Constructor - uncalibrated and unquantized
+    // Large for wide layers, so allocate it on the heap
+    QuantizedNet();
+
+    // Destructor
+    ~QuantizedNet();
+
+    // Record the activation ranges the Neural Net produces for one input
+    void calibrate(const Network &net, const T(&inputs)[numInputs]);
+
+    // Record the activation ranges the Neural Net produces for every one of numRows inputs
+    void calibrate(const Network &net, const T(*inputs)[numInputs], uint32_t numRows);
+
+    // Convert the Neural Net's weights to int8 using the calibrated activation ranges
+    void quantize(const Network &net);
+
+    // Generate an output array based on an input array
+    // No state is written, so threads may share one QuantizedNet
+    void guess(const T(&inputs)[numInputs], T(&outputs)[numOutputs]) const;
+
+    // Generate an output array for every one of numRows input arrays
+    void guessBatch(const T(*inputs)[numInputs], T(*outputs)[numOutputs], uint32_t numRows) const;
+
+    // Get the number of bytes used by the quantized weights
+    uint64_t getWeightBytes() const { return sizeof(inputWeights) + sizeof(hiddenWeights); }
+
+private:
+    QuantizedNet(const QuantizedNet &other) = delete;
+    QuantizedNet& operator=(const QuantizedNet &other) = delete;
+
+    // Row lengths padded for the vector kernels
+    static const uint16_t INPUT_STRIDE = Quantized::paddedLength(numInputs);
+    static const uint16_t HIDDEN_STRIDE = Quantized::paddedLength(numHidden);
+
+    // Quantize one row of weights to int8 with a symmetric per-row scale
+    template<uint16_t numCols>
+    static T quantizeRow(const T* weights, int8_t* quantized);
+
+    // Quantize activations to 7 bit unsigned values, zeroing the padding
+    static void quantizeActivations(const T* values, uint16_t length, T invScale, int32_t zeroPoint, uint8_t* quantized, uint16_t stride);
+
+    // Choose the scale and zero point that cover [min, max] - the range always holds 0
+    static void chooseRange(T min, T max, T &scale, int32_t &zeroPoint);
+
+    // Sum of a row of quantized weights - removes the zero point from a dot product
+    static int32_t rowSum(const int8_t* quantized, uint16_t length);
+
+    // Activation Functions
+    T(*hiddenFunct)(T);
+    T(*outputFunct)(T);
+
+    // Normalise the outputs with a softmax
+    bool softmaxOutputs;
+
+    // Range of the inputs and hidden activations seen during calibration
+    T inputMin;
+    T inputMax;
+    T hiddenMin;
+    T hiddenMax;
+
+    // Activation Scales - real value = (quantized value - zero point) * scale
+    T inputScale;
+    T hiddenScale;
+
+    int32_t inputZeroPoint;
+    int32_t hiddenZeroPoint;
+
+    /////////////////////////////
+    // Quantized Layers        //
+    /////////////////////////////
+    alignas(MATRIX_ALIGNMENT) int8_t inputWeights[numHidden * INPUT_STRIDE];
+    alignas(MATRIX_ALIGNMENT) int8_t hiddenWeights[numOutputs * HIDDEN_STRIDE];
+
+    // Per-row dequantization - weight scale times the scale of the layer's inputs
+    T inputRowScale[numHidden];
+    T hiddenRowScale[numOutputs];
+
+    // Zero point times the sum of each row's quantized weights
+    int32_t inputRowOffset[numHidden];
+    int32_t hiddenRowOffset[numOutputs];
+
+    // Bias is kept at full precision and added after dequantization
+    T inputBias[numHidden];
+    T hiddenBias[numOutputs];
+};
+
+// Constructor - uncalibrated and unquantized
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline QuantizedNet<numInputs, numHidden, numOutputs, T>::QuantizedNet()
+    : hiddenFunct(NN::sigmoid<T>),
+      outputFunct(NN::sigmoid<T>),
+      softmaxOutputs(false),
+      inputMin(0.0),
+      inputMax(0.0),
+      hiddenMin(0.0),
+      hiddenMax(0.0),
+      inputScale(0.0),
+      hiddenScale(0.0),
+      inputZeroPoint(0),
+      hiddenZeroPoint(0),
+      inputWeights{ 0 },
+      hiddenWeights{ 0 },
+      inputRowScale{ 0.0 },
+      hiddenRowScale{ 0.0 },
+      inputRowOffset{ 0 },
+      hiddenRowOffset{ 0 },
+      inputBias{ 0.0 },
+      hiddenBias{ 0.0 }
+{
+
+}
+
+// Destructor
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline QuantizedNet<numInputs, numHidden, numOutputs, T>::~QuantizedNet()
+{
+
+}
+
+// Record the activation ranges the Neural Net produces for one input
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::calibrate(const Network &net, const T(&inputs)[numInputs])
+{
+    // One workspace per thread per network shape - the hidden values are read back from it
+    // It outlives any arena scope open around the first call, so it always uses the heap
+    Storage::ArenaScope scope(Storage::heapArena());
+    thread_local typename Network::Workspace workspace;
+    T outputs[numOutputs];
+
+    net.guess(inputs, outputs, workspace);
+
+    for (uint16_t i = 0; i < numInputs; ++i)
+    {
+        if (inputs[i] > inputMax)
+        {
+            inputMax = inputs[i];
+        }
+        if (inputs[i] < inputMin)
+        {
+            inputMin = inputs[i];
+        }
+    }
+
+    const T* hidden = workspace.hiddenValues.getData();
+
+    for (uint16_t i = 0; i < numHidden; ++i)
+    {
+        if (hidden[i] > hiddenMax)
+        {
+            hiddenMax = hidden[i];
+        }
+        if (hidden[i] < hiddenMin)
+        {
+            hiddenMin = hidden[i];
+        }
+    }
+}
+
+// Record the activation ranges the Neural Net produces for every one of numRows inputs
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::calibrate(const Network &net, const T(*inputs)[numInputs], uint32_t numRows)
+{
+    for (uint32_t i = 0; i < numRows; ++i)
+    {
+        calibrate(net, inputs[i]);
+    }
+}
+
+// Convert the Neural Net's weights to int8 using the calibrated activation ranges
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::quantize(const Network &net)
+{
+    // Choose Activation Functions
+    softmaxOutputs = false;
+
+    switch (net.getActivation())
+    {
+    case NN::Activations::RELU:
+        hiddenFunct = outputFunct = NN::relu<T>;
+        break;
+
+    case NN::Activations::TANH:
+        hiddenFunct = outputFunct = NN::tanh<T>;
+        break;
+
+    case NN::Activations::LEAKY_RELU:
+        hiddenFunct = outputFunct = NN::leakyRelu<T>;
+        break;
+
+    case NN::Activations::SOFTMAX:
+        hiddenFunct = NN::sigmoid<T>;
+        outputFunct = 0;
+        softmaxOutputs = true;
+        break;
+
+    default:
+        hiddenFunct = outputFunct = NN::sigmoid<T>;
+        break;
+    }
+
+    chooseRange(inputMin, inputMax, inputScale, inputZeroPoint);
+    chooseRange(hiddenMin, hiddenMax, hiddenScale, hiddenZeroPoint);
+
+    // Input Layer
+    const T* weights = net.getInputWeights().getData();
+
+    for (uint16_t row = 0; row < numHidden; ++row)
+    {
+        T weightScale = quantizeRow<numInputs>(weights + (uint64_t)row * numInputs, inputWeights + (uint64_t)row * INPUT_STRIDE);
+
+        inputRowScale[row] = weightScale * inputScale;
+        inputRowOffset[row] = inputZeroPoint * rowSum(inputWeights + (uint64_t)row * INPUT_STRIDE, numInputs);
+        inputBias[row] = net.getInputBias().getData()[row];
+    }
+
+    // Hidden Layer
+    weights = net.getHiddenWeights().getData();
+
+    for (uint16_t row = 0; row < numOutputs; ++row)
+    {
+        T weightScale = quantizeRow<numHidden>(weights + (uint64_t)row * numHidden, hiddenWeights + (uint64_t)row * HIDDEN_STRIDE);
+
+        hiddenRowScale[row] = weightScale * hiddenScale;
+        hiddenRowOffset[row] = hiddenZeroPoint * rowSum(hiddenWeights + (uint64_t)row * HIDDEN_STRIDE, numHidden);
+        hiddenBias[row] = net.getHiddenBias().getData()[row];
+    }
+}
+
+// Generate an output array based on an input array
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::guess(const T(&inputs)[numInputs], T(&outputs)[numOutputs]) const
+{
+    Quantized::DotFunction dot = Quantized::selectDot();
+
+    alignas(MATRIX_ALIGNMENT) uint8_t inputValues[INPUT_STRIDE];
+    alignas(MATRIX_ALIGNMENT) uint8_t hiddenValues[HIDDEN_STRIDE];
+    T hidden[numHidden];
+
+    // Populate Inputs
+    quantizeActivations(inputs, numInputs, (T)1.0 / inputScale, inputZeroPoint, inputValues, INPUT_STRIDE);
+
+    // Hidden = act(Input Weights * Inputs + Input Bias)
+    for (uint16_t row = 0; row < numHidden; ++row)
+    {
+        int32_t acc = dot(inputValues, inputWeights + (uint64_t)row * INPUT_STRIDE, INPUT_STRIDE) - inputRowOffset[row];
+
+        hidden[row] = hiddenFunct((T)acc * inputRowScale[row] + inputBias[row]);
+    }
+
+    quantizeActivations(hidden, numHidden, (T)1.0 / hiddenScale, hiddenZeroPoint, hiddenValues, HIDDEN_STRIDE);
+
+    // Outputs = act(Hidden Weights * Hidden + Hidden Bias)
+    for (uint16_t row = 0; row < numOutputs; ++row)
+    {
+        int32_t acc = dot(hiddenValues, hiddenWeights + (uint64_t)row * HIDDEN_STRIDE, HIDDEN_STRIDE) - hiddenRowOffset[row];
+
+        outputs[row] = (T)acc * hiddenRowScale[row] + hiddenBias[row];
+
+        if (!softmaxOutputs)
+        {
+            outputs[row] = outputFunct(outputs[row]);
+        }
+    }
+
+    if (softmaxOutputs)
+    {
+        Kernels::softmaxColumns(outputs, numOutputs, 1);
+    }
+}
+
+// Generate an output array for every one of numRows input arrays
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::guessBatch(const T(*inputs)[numInputs], T(*outputs)[numOutputs], uint32_t numRows) const
+{
+    for (uint32_t i = 0; i < numRows; ++i)
+    {
+        guess(inputs[i], outputs[i]);
+    }
+}
+
+// Quantize one row of weights to int8 with a symmetric per-row scale
+// Returns the scale - real weight = quantized weight * scale
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+template <uint16_t numCols>
+inline T QuantizedNet<numInputs, numHidden, numOutputs, T>::quantizeRow(const T* weights, int8_t* quantized)
+{
+    T largest = 0.0;
+
+    for (uint16_t col = 0; col < numCols; ++col)
+    {
+        if (std::abs(weights[col]) > largest)
+        {
+            largest = std::abs(weights[col]);
+        }
+    }
+
+    // An all zero row quantizes to zeros with any scale
+    T scale = (largest > (T)0.0) ? largest / (T)Quantized::QUANT_MAX : (T)1.0;
+    T invScale = (T)1.0 / scale;
+
+    for (uint16_t col = 0; col < numCols; ++col)
+    {
+        quantized[col] = (int8_t)std::lround(weights[col] * invScale);
+    }
+
+    // Padding contributes nothing to the dot products
+    for (uint16_t col = numCols; col < Quantized::paddedLength(numCols); ++col)
+    {
+        quantized[col] = 0;
+    }
+
+    return scale;
+}
+
+// Choose the scale and zero point that cover [min, max] - the range always holds 0
+// An uncalibrated range falls back to [0, 1]
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::chooseRange(T min, T max, T &scale, int32_t &zeroPoint)
+{
+    T range = max - min;
+
+    scale = ((range > (T)0.0) ? range : (T)1.0) / (T)Quantized::QUANT_MAX;
+
+    // 0 must be exactly representable, so padding and zero activations add nothing
+    zeroPoint = (int32_t)std::lround(-min / scale);
+    zeroPoint = (zeroPoint < 0) ? 0 : (zeroPoint > Quantized::QUANT_MAX) ? Quantized::QUANT_MAX : zeroPoint;
+}
+
+// Sum of a row of quantized weights
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline int32_t QuantizedNet<numInputs, numHidden, numOutputs, T>::rowSum(const int8_t* quantized, uint16_t length)
+{
+    int32_t sum = 0;
+
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        sum += quantized[i];
+    }
+
+    return sum;
+}
+
+// Quantize activations to 7 bit unsigned values, zeroing the padding
+// Values outside the calibrated range are clamped
+template <uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+inline void QuantizedNet<numInputs, numHidden, numOutputs, T>::quantizeActivations(const T* values, uint16_t length, T invScale, int32_t zeroPoint, uint8_t* quantized, uint16_t stride)
+{
+    for (uint16_t i = 0; i < length; ++i)
+    {
+        int32_t value = (int32_t)floor(values[i] * invScale + (T)0.5) + zeroPoint;
+
+        quantized[i] = (uint8_t)((value < 0) ? 0 : (value > Quantized::QUANT_MAX) ? Quantized::QUANT_MAX : value);
+    }
+
+    for (uint16_t i = length; i < stride; ++i)
+    {
+        quantized[i] = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,332 @@
+//-----------------------------------------------------------------------------
+// File: Sampler.h
+// Author: Edward Koch
+// Description: Holds the declaration of the Sampler Class
+//              Orders the samples of every epoch - sequentially, as a fresh
+//              Fisher-Yates permutation, or stratified so every class is
+//              trained equally often - without replacement and with 64-bit
+//              indices
+//
+//              An epoch's order depends only on the seed and the epoch number,
+//              so a run can be repeated exactly, resumed at any epoch, and
+//              split into shards that workers train independently
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <random>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+class Sampler
+{
+public:
+    // How the samples of an epoch are ordered
+    enum class Mode : uint8_t
+    {
+        SEQUENTIAL,     // 0, 1, 2, ... every epoch
+        SHUFFLED,       // A new permutation every epoch - each sample exactly once
+        STRATIFIED      // Classes in turn, so any numClasses consecutive samples hold one of each
+    };
+
+    // Constructor - numSamples samples, every epoch's order derived from seed
+    Sampler(uint64_t numSamples = 0, uint64_t seed = 0, Mode mode = Mode::SHUFFLED);
+
+    // Set the number of samples - any labels are dropped
+    void setNumSamples(uint64_t newNumSamples);
+
+    // Set the class of every sample, which also sets the number of samples
+    // Needed by STRATIFIED - an epoch is still one sample per label long, with
+    // rare classes repeated and common ones cut short
+    void setLabels(const std::vector<uint16_t> &newLabels);
+
+    // Set how the samples of an epoch are ordered
+    void setMode(Mode newMode);
+
+    // Set the seed every epoch's order is derived from
+    void setSeed(uint64_t newSeed);
+
+    // Get how the samples of an epoch are ordered
+    Mode getMode() const { return mode; }
+
+    // Get the seed every epoch's order is derived from
+    uint64_t getSeed() const { return seed; }
+
+    // Get the number of samples in an epoch
+    uint64_t size() const { return numSamples; }
+
+    // Get the current epoch
+    uint64_t getEpoch() const { return epoch; }
+
+    // Build the order of an epoch - the same seed and epoch always give the same order
+    void startEpoch(uint64_t newEpoch);
+
+    // Build the order of the epoch after the current one, or of epoch 0 if none has started
+    void nextEpoch();
+
+    // Get the next sample of the current epoch
+    // Returns false once every sample of the epoch has been returned
+    bool next(uint64_t &index);
+
+    // Get the sample at a position of the current epoch
+    uint64_t operator[](uint64_t position) const { return order[position]; }
+
+    // Get the positions [first, last) of one of numShards contiguous, near equal
+    // shards of the current epoch - e.g. one shard per worker
+    void getShard(uint16_t shard, uint16_t numShards, uint64_t &first, uint64_t &last) const;
+
+    // Get the seed of an independent random stream derived from seed - e.g. one
+    // per worker thread or per epoch - so parallel runs are reproducible
+    static uint64_t streamSeed(uint64_t seed, uint64_t stream);
+
+    // Get a uniform integer in [0, range) - unbiased and, unlike
+    // std::uniform_int_distribution, the same on every standard library
+    static uint64_t uniform(std::mt19937_64 &rng, uint64_t range);
+
+private:
+    // Fisher-Yates shuffle of count values in place
+    static void shuffle(uint64_t* values, uint64_t count, std::mt19937_64 &rng);
+
+    // Build a stratified order - classes in a new random turn every round,
+    // each class's samples in a permutation that is renewed when it runs out
+    void stratify(std::mt19937_64 &rng);
+
+    Mode mode;
+    uint64_t seed;
+    uint64_t numSamples;
+
+    // Class of every sample - empty unless set
+    std::vector<uint16_t> labels;
+
+    // Order of the current epoch, and the next position to return
+    std::vector<uint64_t> order;
+    uint64_t epoch;
+    uint64_t position;
+    bool started;
+};
+
+// Constructor - numSamples samples, every epoch's order derived from seed
+inline Sampler::Sampler(uint64_t numSamples, uint64_t seed, Mode mode)
+    : mode(mode),
+      seed(seed),
+      numSamples(numSamples),
+      epoch(0),
+      position(0),
+      started(false)
+{
+}
+
+// Set the number of samples - any labels are dropped
+inline void Sampler::setNumSamples(uint64_t newNumSamples)
+{
+    numSamples = newNumSamples;
+    labels.clear();
+    order.clear();
+    position = 0;
+    started = false;
+}
+
+// Set the class of every sample, which also sets the number of samples
+inline void Sampler::setLabels(const std::vector<uint16_t> &newLabels)
+{
+    numSamples = newLabels.size();
+    labels = newLabels;
+    order.clear();
+    position = 0;
+    started = false;
+}
+
+// Set how the samples of an epoch are ordered
+inline void Sampler::setMode(Mode newMode)
+{
+    mode = newMode;
+    order.clear();
+    position = 0;
+    started = false;
+}
+
+// Set the seed every epoch's order is derived from
+inline void Sampler::setSeed(uint64_t newSeed)
+{
+    seed = newSeed;
+    order.clear();
+    position = 0;
+    started = false;
+}
+
+// Build the order of an epoch - the same seed and epoch always give the same order
+inline void Sampler::startEpoch(uint64_t newEpoch)
+{
+    epoch = newEpoch;
+    position = 0;
+    started = true;
+
+    // Every epoch has its own stream, so no epoch depends on the ones before it
+    std::mt19937_64 rng(streamSeed(seed, epoch));
+
+    if (mode == Mode::STRATIFIED && labels.size() == numSamples)
+    {
+        stratify(rng);
+        return;
+    }
+
+#if _DEBUG
+    if (mode == Mode::STRATIFIED)
+    {
+        printf("Sampler::startEpoch - No labels for a stratified order, shuffling instead\n");
+    }
+#endif
+
+    order.resize(numSamples);
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        order[i] = i;
+    }
+
+    if (mode != Mode::SEQUENTIAL)
+    {
+        shuffle(order.data(), numSamples, rng);
+    }
+}
+
+// Build the order of the epoch after the current one, or of epoch 0 if none has started
+inline void Sampler::nextEpoch()
+{
+    startEpoch(started ? epoch + 1 : 0);
+}
+
+// Get the next sample of the current epoch
+inline bool Sampler::next(uint64_t &index)
+{
+    if (position >= order.size())
+    {
+        return false;
+    }
+
+    index = order[position++];
+
+    return true;
+}
+
+// Get the positions [first, last) of one of numShards contiguous, near equal shards of the current epoch
+inline void Sampler::getShard(uint16_t shard, uint16_t numShards, uint64_t &first, uint64_t &last) const
+{
+    if (numShards == 0 || shard >= numShards)
+    {
+        first = last = order.size();
+        return;
+    }
+
+    // The first size % numShards shards are one sample longer
+    uint64_t quotient = order.size() / numShards;
+    uint64_t remainder = order.size() % numShards;
+
+    first = shard * quotient + (shard < remainder ? shard : remainder);
+    last = first + quotient + (shard < remainder ? 1 : 0);
+}
+
+// Get the seed of an independent random stream derived from seed
+inline uint64_t Sampler::streamSeed(uint64_t seed, uint64_t stream)
+{
+    // SplitMix64 - nearby seeds and streams give unrelated results
+    uint64_t z = seed + (stream + 1) * 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+
+    return z ^ (z >> 31);
+}
+
+// Get a uniform integer in [0, range)
+inline uint64_t Sampler::uniform(std::mt19937_64 &rng, uint64_t range)
+{
+    // Reject the 2^64 % range lowest values so every remainder is equally likely
+    const uint64_t threshold = (0 - range) % range;
+
+    uint64_t value = rng();
+    while (value < threshold)
+    {
+        value = rng();
+    }
+
+    return value % range;
+}
+
+// Fisher-Yates shuffle of count values in place
+inline void Sampler::shuffle(uint64_t* values, uint64_t count, std::mt19937_64 &rng)
+{
+    for (uint64_t i = count; i > 1; --i)
+    {
+        uint64_t j = uniform(rng, i);
+
+        uint64_t tmp = values[i - 1];
+        values[i - 1] = values[j];
+        values[j] = tmp;
+    }
+}
+
+// Build a stratified order
+inline void Sampler::stratify(std::mt19937_64 &rng)
+{
+    // Samples of each class, in order
+    uint16_t numClasses = 0;
+    for (uint16_t label : labels)
+    {
+        if (label >= numClasses)
+        {
+            numClasses = label + 1;
+        }
+    }
+
+    std::vector<std::vector<uint64_t>> classSamples(numClasses);
+    for (uint64_t i = 0; i < numSamples; ++i)
+    {
+        classSamples[labels[i]].push_back(i);
+    }
+
+    // Only the classes that have samples take turns
+    std::vector<uint64_t> classes;
+    for (uint16_t c = 0; c < numClasses; ++c)
+    {
+        if (!classSamples[c].empty())
+        {
+            shuffle(classSamples[c].data(), classSamples[c].size(), rng);
+            classes.push_back(c);
+        }
+    }
+
+    std::vector<uint64_t> cursors(numClasses, 0);
+
+    order.clear();
+    order.reserve(numSamples);
+
+    while (order.size() < numSamples)
+    {
+        shuffle(classes.data(), classes.size(), rng);
+
+        for (uint64_t c : classes)
+        {
+            if (order.size() == numSamples)
+            {
+                break;
+            }
+
+            // Start a new permutation of a class once all of it has been used
+            std::vector<uint64_t> &samples = classSamples[c];
+            if (cursors[c] == samples.size())
+            {
+                shuffle(samples.data(), samples.size(), rng);
+                cursors[c] = 0;
+            }
+
+            order.push_back(samples[cursors[c]++]);
+        }
+    }
+}
+
+#endif
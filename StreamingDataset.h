@@ -0,0 +1,433 @@
+//-----------------------------------------------------------------------------
+// File: StreamingDataset.h
+// Author: Edward Koch
+// Description: Holds the declaration of the StreamingDataset Class
+//              Streams labelled samples from disk in fixed size chunks through
+//              a bounded ring buffer - a prefetch thread reads ahead while the
+//              training loop consumes, so data sets larger than RAM train at a
+//              steady rate with a fixed memory footprint
+//
+// Sources
+//   IDX        a labels file and a data file, e.g. the MNIST files
+//   Shards     raw binary files of records - one label byte followed by
+//              sampleSize data bytes - streamed one shard after another
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef STREAMING_DATASET_H
+#define STREAMING_DATASET_H
+
+#include "IdxFile.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+class StreamingDataset
+{
+public:
+    // One streamed sample - the data is valid until the next call to next()
+    struct Sample
+    {
+        uint8_t label;
+        const uint8_t* data;
+    };
+
+    // Constructor - at most numChunks chunks of chunkSize samples are held at once
+    StreamingDataset(uint32_t chunkSize = 4096, uint16_t numChunks = 4);
+
+    // Destructor - stops the prefetch thread
+    ~StreamingDataset();
+
+    // Stream from an IDX labels file and an IDX data file with one item per label
+    // Returns false if either file is missing, invalid or they do not match
+    bool openIdx(const char* labelsPath, const char* dataPath);
+
+    // Stream from raw binary shards of (label byte, sampleSize data bytes) records
+    // Returns false if any shard is missing or is not a whole number of records
+    bool openShards(const std::vector<std::string> &paths, uint64_t sampleSize);
+
+    // Get the number of data bytes in one sample
+    uint64_t getSampleSize() const { return sampleSize; }
+
+    // Get the number of samples in one pass over every source
+    uint64_t getNumSamples() const;
+
+    // Start a pass over every sample - the prefetch thread begins reading ahead
+    // Any pass still running is stopped first
+    void start();
+
+    // Get the next sample of the pass - blocks until the prefetch thread has read it
+    // Returns false once every sample of the pass has been returned
+    bool next(Sample &sample);
+
+    // Abandon the current pass and stop the prefetch thread
+    void stop();
+
+private:
+    StreamingDataset(const StreamingDataset &other) = delete;
+    StreamingDataset& operator=(const StreamingDataset &other) = delete;
+
+    // One file (or IDX pair) to stream
+    struct Source
+    {
+        std::string dataPath;
+        std::string labelsPath;     // Empty for shards - the label is part of each record
+
+        uint64_t dataOffset;
+        uint64_t labelsOffset;
+        uint64_t numSamples;
+    };
+
+    // One slot of the ring buffer
+    struct Chunk
+    {
+        std::vector<uint8_t> labels;
+        std::vector<uint8_t> data;
+        uint32_t count;
+    };
+
+    // Prefetch thread - reads every source chunk by chunk into free slots
+    void produce();
+
+    // Read the next count samples of a source into a chunk
+    bool readChunk(std::ifstream &data, std::ifstream &labels, bool separateLabels, uint32_t count, Chunk &chunk);
+
+    // Get the size of a file, or 0 if it cannot be opened
+    static uint64_t fileSize(const char* path);
+
+    // Sources
+    std::vector<Source> sources;
+    uint64_t sampleSize;
+
+    // Ring Buffer
+    uint32_t chunkSize;
+    std::vector<Chunk> chunks;
+
+    std::mutex mutex;
+    std::condition_variable chunkFilled;
+    std::condition_variable chunkFreed;
+
+    uint16_t head;          // Next chunk to consume
+    uint16_t tail;          // Next chunk to fill
+    uint16_t numFilled;
+    bool producerDone;
+    bool stopping;
+
+    // Consumer position
+    bool consuming;
+    uint32_t position;
+
+    // Prefetch Thread
+    std::thread producer;
+};
+
+// Constructor - at most numChunks chunks of chunkSize samples are held at once
+inline StreamingDataset::StreamingDataset(uint32_t chunkSize, uint16_t numChunks)
+    : sampleSize(0),
+      chunkSize(chunkSize > 0 ? chunkSize : 1),
+      chunks(numChunks > 1 ? numChunks : 2),
+      head(0),
+      tail(0),
+      numFilled(0),
+      producerDone(true),
+      stopping(false),
+      consuming(false),
+      position(0)
+{
+
+}
+
+// Destructor - stops the prefetch thread
+inline StreamingDataset::~StreamingDataset()
+{
+    stop();
+}
+
+// Stream from an IDX labels file and an IDX data file with one item per label
+inline bool StreamingDataset::openIdx(const char* labelsPath, const char* dataPath)
+{
+    stop();
+    sources.clear();
+    sampleSize = 0;
+
+    Idx::Header headers[2];
+    const char* paths[2] = { labelsPath, dataPath };
+
+    for (uint8_t i = 0; i < 2; ++i)
+    {
+        uint8_t bytes[Idx::MAX_HEADER_SIZE] = { 0 };
+
+        std::ifstream fin(paths[i], std::ios::binary);
+        fin.read((char*)bytes, sizeof(bytes));
+
+        if (!Idx::parseHeader(bytes, (uint64_t)fin.gcount(), fileSize(paths[i]), headers[i]))
+        {
+#if _DEBUG
+            printf("StreamingDataset - Open IDX: %s is not a complete unsigned byte IDX file\n", paths[i]);
+#endif
+            return false;
+        }
+    }
+
+    if (headers[0].itemSize != 1 || headers[0].dims[0] != headers[1].dims[0])
+    {
+#if _DEBUG
+        printf("StreamingDataset - Open IDX: %s does not hold one label per item of %s\n", labelsPath, dataPath);
+#endif
+        return false;
+    }
+
+    Source source = { dataPath, labelsPath, headers[1].size, headers[0].size, headers[1].dims[0] };
+
+    sources.push_back(source);
+    sampleSize = headers[1].itemSize;
+
+    return true;
+}
+
+// Stream from raw binary shards of (label byte, sampleSize data bytes) records
+inline bool StreamingDataset::openShards(const std::vector<std::string> &paths, uint64_t shardSampleSize)
+{
+    stop();
+    sources.clear();
+    sampleSize = 0;
+
+    uint64_t recordSize = shardSampleSize + 1;
+
+    for (const std::string &path : paths)
+    {
+        uint64_t size = fileSize(path.c_str());
+
+        if (size == 0 || size % recordSize != 0)
+        {
+#if _DEBUG
+            printf("StreamingDataset - Open Shards: %s is not a whole number of %llu byte records\n", path.c_str(), (unsigned long long)recordSize);
+#endif
+            sources.clear();
+            return false;
+        }
+
+        Source source = { path, std::string(), 0, 0, size / recordSize };
+        sources.push_back(source);
+    }
+
+    sampleSize = shardSampleSize;
+
+    return true;
+}
+
+// Get the number of samples in one pass over every source
+inline uint64_t StreamingDataset::getNumSamples() const
+{
+    uint64_t numSamples = 0;
+
+    for (const Source &source : sources)
+    {
+        numSamples += source.numSamples;
+    }
+
+    return numSamples;
+}
+
+// Start a pass over every sample - the prefetch thread begins reading ahead
+inline void StreamingDataset::start()
+{
+    stop();
+
+    // Slots are sized once and reused by every pass
+    for (Chunk &chunk : chunks)
+    {
+        chunk.labels.resize(chunkSize);
+        chunk.data.resize((size_t)(chunkSize * sampleSize));
+        chunk.count = 0;
+    }
+
+    head = 0;
+    tail = 0;
+    numFilled = 0;
+    producerDone = false;
+    stopping = false;
+    consuming = false;
+    position = 0;
+
+    producer = std::thread(&StreamingDataset::produce, this);
+}
+
+// Get the next sample of the pass - blocks until the prefetch thread has read it
+inline bool StreamingDataset::next(Sample &sample)
+{
+    // Release the current chunk once every sample in it has been returned
+    if (consuming && position >= chunks[head].count)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            head = (uint16_t)((head + 1) % chunks.size());
+            --numFilled;
+            consuming = false;
+        }
+        chunkFreed.notify_one();
+    }
+
+    // Wait for the prefetch thread to fill the next chunk
+    if (!consuming)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        chunkFilled.wait(lock, [this]() { return numFilled > 0 || producerDone; });
+
+        if (numFilled == 0)
+        {
+            return false;
+        }
+
+        consuming = true;
+        position = 0;
+    }
+
+    const Chunk &chunk = chunks[head];
+
+    sample.label = chunk.labels[position];
+    sample.data = chunk.data.data() + (uint64_t)position * sampleSize;
+    ++position;
+
+    return true;
+}
+
+// Abandon the current pass and stop the prefetch thread
+inline void StreamingDataset::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    chunkFreed.notify_all();
+
+    if (producer.joinable())
+    {
+        producer.join();
+    }
+
+    numFilled = 0;
+    producerDone = true;
+    consuming = false;
+}
+
+// Prefetch thread - reads every source chunk by chunk into free slots
+inline void StreamingDataset::produce()
+{
+    for (const Source &source : sources)
+    {
+        bool separateLabels = !source.labelsPath.empty();
+
+        std::ifstream data(source.dataPath, std::ios::binary);
+        std::ifstream labels;
+
+        data.seekg((std::streamoff)source.dataOffset);
+        if (separateLabels)
+        {
+            labels.open(source.labelsPath, std::ios::binary);
+            labels.seekg((std::streamoff)source.labelsOffset);
+        }
+
+        uint64_t remaining = source.numSamples;
+
+        while (remaining > 0)
+        {
+            // Wait for a free slot
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                chunkFreed.wait(lock, [this]() { return stopping || numFilled < chunks.size(); });
+
+                if (stopping)
+                {
+                    producerDone = true;
+                    chunkFilled.notify_all();
+                    return;
+                }
+            }
+
+            // The slot at tail is not touched by the consumer until it is published
+            uint32_t count = (remaining < chunkSize) ? (uint32_t)remaining : chunkSize;
+
+            if (!readChunk(data, labels, separateLabels, count, chunks[tail]))
+            {
+#if _DEBUG
+                printf("StreamingDataset - Produce: Read of %s failed\n", source.dataPath.c_str());
+#endif
+                break;
+            }
+
+            // Publish the chunk
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                tail = (uint16_t)((tail + 1) % chunks.size());
+                ++numFilled;
+            }
+            chunkFilled.notify_one();
+
+            remaining -= count;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        producerDone = true;
+    }
+    chunkFilled.notify_all();
+}
+
+// Read the next count samples of a source into a chunk
+inline bool StreamingDataset::readChunk(std::ifstream &data, std::ifstream &labels, bool separateLabels, uint32_t count, Chunk &chunk)
+{
+    if (separateLabels)
+    {
+        // One bulk read per file
+        labels.read((char*)chunk.labels.data(), count);
+        data.read((char*)chunk.data.data(), (std::streamsize)(count * sampleSize));
+
+        if (!labels || !data)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        // Records interleave the label with the data
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            data.read((char*)&chunk.labels[i], 1);
+            data.read((char*)chunk.data.data() + (uint64_t)i * sampleSize, (std::streamsize)sampleSize);
+        }
+
+        if (!data)
+        {
+            return false;
+        }
+    }
+
+    chunk.count = count;
+    return true;
+}
+
+// Get the size of a file, or 0 if it cannot be opened
+inline uint64_t StreamingDataset::fileSize(const char* path)
+{
+    std::ifstream fin(path, std::ios::binary | std::ios::ate);
+
+    if (!fin.is_open())
+    {
+        return 0;
+    }
+
+    return (uint64_t)fin.tellg();
+}
+
+#endif
@@ -0,0 +1,146 @@
+//-----------------------------------------------------------------------------
+// File: ThreadPool.h
+// Author: Edward Koch
+// Description: Holds the declaration of the ThreadPool Class
+//              A fixed set of worker threads that all run the same job and
+//              wait for each other to finish, used to split a mini-batch
+//              across cores
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    // Constructor - numWorkers includes the calling thread, so numWorkers - 1 threads are started
+    ThreadPool(uint16_t numWorkers);
+
+    // Destructor - stops and joins every worker thread
+    ~ThreadPool();
+
+    // Get the number of workers, including the calling thread
+    uint16_t getNumWorkers() const { return numWorkers; }
+
+    // Run job(workerIdx) once on every worker and wait for all of them to finish
+    // The calling thread runs worker 0
+    void run(const std::function<void(uint16_t)> &job);
+
+private:
+    ThreadPool(const ThreadPool &other) = delete;
+    ThreadPool& operator=(const ThreadPool &other) = delete;
+
+    // Worker thread loop - waits for a new generation and runs the job
+    void workerLoop(uint16_t workerIdx);
+
+    // Number of workers including the calling thread
+    uint16_t numWorkers;
+
+    // Worker Threads
+    std::vector<std::thread> threads;
+
+    // Job State
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::condition_variable jobDone;
+
+    const std::function<void(uint16_t)>* job;
+    uint64_t generation;
+    uint16_t numRunning;
+    bool stopping;
+};
+
+// Constructor - numWorkers includes the calling thread, so numWorkers - 1 threads are started
+inline ThreadPool::ThreadPool(uint16_t numWorkers)
+    : numWorkers(numWorkers > 0 ? numWorkers : 1),
+      job(nullptr),
+      generation(0),
+      numRunning(0),
+      stopping(false)
+{
+    for (uint16_t i = 1; i < this->numWorkers; ++i)
+    {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+// Destructor - stops and joins every worker thread
+inline ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobReady.notify_all();
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+// Run job(workerIdx) once on every worker and wait for all of them to finish
+// The calling thread runs worker 0
+inline void ThreadPool::run(const std::function<void(uint16_t)> &newJob)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &newJob;
+        numRunning = numWorkers - 1;
+        ++generation;
+    }
+    jobReady.notify_all();
+
+    // The calling thread does its share instead of idling
+    newJob(0);
+
+    // Wait for the other workers
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [this]() { return numRunning == 0; });
+    job = nullptr;
+}
+
+// Worker thread loop - waits for a new generation and runs the job
+inline void ThreadPool::workerLoop(uint16_t workerIdx)
+{
+    uint64_t lastGeneration = 0;
+
+    while (true)
+    {
+        const std::function<void(uint16_t)>* currentJob = nullptr;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this, lastGeneration]() { return stopping || generation != lastGeneration; });
+
+            if (stopping)
+            {
+                return;
+            }
+
+            lastGeneration = generation;
+            currentJob = job;
+        }
+
+        (*currentJob)(workerIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --numRunning;
+        }
+        jobDone.notify_one();
+    }
+}
+
+#endif
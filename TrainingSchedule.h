@@ -0,0 +1,234 @@
+//-----------------------------------------------------------------------------
+// File: TrainingSchedule.h
+// Author: Edward Koch
+// Description: Holds the declaration of the TrainingSchedule Class
+//              Drives a training loop - the learning rate of every update,
+//              with a linear warmup followed by step or cosine decay, and
+//              whether another epoch is worth training
+//
+//              Every epoch ends with a validation metric, higher is better
+//              (e.g. test accuracy). Each epoch it fails to improve on the best
+//              so far counts towards a plateau, which scales the rate down,
+//              and towards early stopping, which ends the training
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#ifndef TRAINING_SCHEDULE_H
+#define TRAINING_SCHEDULE_H
+
+#include <math.h>
+#include <stdint.h>
+
+namespace NN
+{
+    enum class Decays : uint8_t
+    {
+        CONSTANT,   // The peak rate throughout
+        STEP,       // The rate scaled by decayFactor every decaySteps updates
+        COSINE      // Half a cosine from the peak rate down to minRate over decaySteps updates
+    };
+};
+
+template<typename T = double_t>
+class TrainingSchedule
+{
+public:
+    struct Settings
+    {
+        T learningRate;             // Peak rate, reached at the end of the warmup
+        uint64_t warmupSteps;       // Updates ramping linearly up to the peak rate - 0 starts at it
+        NN::Decays decay;           // Rate after the warmup
+        uint64_t decaySteps;        // STEP: updates between drops - COSINE: updates from peak to minRate
+        T decayFactor;              // STEP: rate multiplier at every drop
+        T minRate;                  // Lowest rate after the warmup, whatever the decay or plateaus
+        uint16_t plateauPatience;   // Epochs without improvement before the rate is scaled - 0 never
+        T plateauFactor;            // Rate multiplier at every plateau
+        uint16_t stopPatience;      // Epochs without improvement before training stops - 0 never
+        double_t minImprovement;    // Smallest rise of the metric that counts as an improvement
+        uint32_t maxEpochs;         // Epochs before training stops regardless - 0 never
+    };
+
+    // Get settings that keep learningRate for maxEpochs epochs - no warmup, decay or early stop
+    static Settings constant(T learningRate, uint32_t maxEpochs);
+
+    // Constructor
+    TrainingSchedule(const Settings &settings);
+
+    // Set the schedule and restart it
+    void setSettings(const Settings &newSettings);
+
+    // Get the schedule
+    const Settings& getSettings() const { return settings; }
+
+    // Start again from the given update, e.g. the step of a resumed checkpoint,
+    // forgetting every epoch and metric seen so far
+    void restart(uint64_t step = 0);
+
+    // Get the learning rate of the next update and count it
+    T nextRate();
+
+    // Get the learning rate of an update - the plateaus seen so far included
+    T rateAt(uint64_t step) const;
+
+    // End an epoch with its validation metric
+    // Returns whether another epoch should be trained
+    bool endEpoch(double_t metric);
+
+    // Get the number of updates counted
+    uint64_t getStep() const { return step; }
+
+    // Get the number of epochs ended
+    uint32_t getEpoch() const { return epoch; }
+
+    // Get the best metric so far, and the epoch that reached it
+    double_t getBestMetric() const { return bestMetric; }
+    uint32_t getBestEpoch() const { return bestEpoch; }
+
+    // Whether the last epoch improved on every one before it
+    bool isBest() const { return epoch > 0 && bestEpoch == epoch; }
+
+    // Whether the metric stopped improving before maxEpochs were trained
+    bool stoppedEarly() const { return stopped; }
+
+    // Get the number of plateaus the rate has been scaled for
+    uint16_t getNumPlateaus() const { return numPlateaus; }
+
+private:
+    Settings settings;
+
+    uint64_t step;
+    uint32_t epoch;
+
+    double_t bestMetric;
+    uint32_t bestEpoch;
+
+    // Epochs since the last improvement, and since the last improvement or plateau
+    uint16_t sinceImprovement;
+    uint16_t sincePlateau;
+
+    uint16_t numPlateaus;
+    T plateauScale;
+
+    bool stopped;
+};
+
+// Get settings that keep learningRate for maxEpochs epochs
+template<typename T>
+inline typename TrainingSchedule<T>::Settings TrainingSchedule<T>::constant(T learningRate, uint32_t maxEpochs)
+{
+    return { learningRate, 0, NN::Decays::CONSTANT, 0, (T)1.0, (T)0.0, 0, (T)1.0, 0, 0.0, maxEpochs };
+}
+
+// Constructor
+template<typename T>
+inline TrainingSchedule<T>::TrainingSchedule(const Settings &settings)
+    : settings(settings)
+{
+    restart();
+}
+
+// Set the schedule and restart it
+template<typename T>
+inline void TrainingSchedule<T>::setSettings(const Settings &newSettings)
+{
+    settings = newSettings;
+    restart();
+}
+
+// Start again from the given update, forgetting every epoch and metric seen so far
+template<typename T>
+inline void TrainingSchedule<T>::restart(uint64_t newStep)
+{
+    step = newStep;
+    epoch = 0;
+
+    bestMetric = -HUGE_VAL;
+    bestEpoch = 0;
+
+    sinceImprovement = 0;
+    sincePlateau = 0;
+
+    numPlateaus = 0;
+    plateauScale = (T)1.0;
+
+    stopped = false;
+}
+
+// Get the learning rate of the next update and count it
+template<typename T>
+inline T TrainingSchedule<T>::nextRate()
+{
+    return rateAt(step++);
+}
+
+// Get the learning rate of an update - the plateaus seen so far included
+template<typename T>
+inline T TrainingSchedule<T>::rateAt(uint64_t updateStep) const
+{
+    // Warmup - the first update already moves, the last one is at the peak
+    if (updateStep < settings.warmupSteps)
+    {
+        return settings.learningRate * (T)(updateStep + 1) / (T)settings.warmupSteps * plateauScale;
+    }
+
+    uint64_t decayStep = updateStep - settings.warmupSteps;
+    double_t rate = settings.learningRate;
+
+    if (settings.decaySteps > 0)
+    {
+        if (settings.decay == NN::Decays::STEP)
+        {
+            rate *= pow((double_t)settings.decayFactor, (double_t)(decayStep / settings.decaySteps));
+        }
+        else if (settings.decay == NN::Decays::COSINE)
+        {
+            double_t progress = (decayStep < settings.decaySteps) ? (double_t)decayStep / settings.decaySteps : 1.0;
+            rate = settings.minRate + (rate - settings.minRate) * 0.5 * (1.0 + cos(3.14159265358979323846 * progress));
+        }
+    }
+
+    rate *= plateauScale;
+
+    return (rate > settings.minRate) ? (T)rate : settings.minRate;
+}
+
+// End an epoch with its validation metric
+template<typename T>
+inline bool TrainingSchedule<T>::endEpoch(double_t metric)
+{
+    ++epoch;
+
+    if (metric > bestMetric + settings.minImprovement)
+    {
+        bestMetric = metric;
+        bestEpoch = epoch;
+
+        sinceImprovement = 0;
+        sincePlateau = 0;
+    }
+    else
+    {
+        ++sinceImprovement;
+        ++sincePlateau;
+
+        // Scale the rate down, then wait a full patience again before the next plateau
+        if (settings.plateauPatience > 0 && sincePlateau >= settings.plateauPatience)
+        {
+            plateauScale *= settings.plateauFactor;
+            ++numPlateaus;
+            sincePlateau = 0;
+        }
+
+        if (settings.stopPatience > 0 && sinceImprovement >= settings.stopPatience)
+        {
+            stopped = true;
+        }
+    }
+
+    return !stopped && (settings.maxEpochs == 0 || epoch < settings.maxEpochs);
+}
+
+#endif
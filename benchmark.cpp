@@ -0,0 +1,361 @@
+//-----------------------------------------------------------------------------
+// File: benchmark.cpp
+// Author: Edward Koch
+// Description: Benchmark sweep of the Matrix kernels and NeuralNet throughput
+//              Every result is printed as it is measured, then as a table, and
+//              optionally written as JSON to compare against a baseline
+//
+//              Usage: Benchmark [--quick] [--filter text] [--json path]
+//                --quick    short runs - a smoke test rather than a measurement
+//                --filter   only run benchmarks whose group or name contain text
+//                --json     write the report to path
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+// E. Koch    10/17/26    Fused Optimizer Updates
+//-----------------------------------------------------------------------------
+#include "Matrix.h"
+#include "NeuralNet.h"
+#include "Optimizer.h"
+#include "Benchmark.h"
+
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+// Fixed seed so every run measures the same data
+std::mt19937 rng(42);
+
+// Name of an element type for the report
+template<typename T>
+const char* typeName()
+{
+    return (sizeof(T) == sizeof(float)) ? "float" : "double";
+}
+
+// Name of an instruction set for the report
+const char* levelName(Simd::Level level)
+{
+    switch (level)
+    {
+    case Simd::Level::AVX512:
+        return "avx512";
+    case Simd::Level::AVX2:
+        return "avx2";
+    case Simd::Level::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+// Dimensions as text, e.g. 128x784x32
+std::string shapeName(uint32_t a, uint32_t b, uint32_t c = 0)
+{
+    std::string shape = std::to_string(a) + "x" + std::to_string(b);
+
+    if (c > 0)
+    {
+        shape += "x" + std::to_string(c);
+    }
+
+    return shape;
+}
+
+// C(MxN) = A(MxK) * B(KxN), and the same product with either operand stored transposed
+template<uint16_t M, uint16_t K, uint16_t N, typename T>
+void benchMultiply(Benchmark &bench)
+{
+    Matrix<M, K, T> a;
+    Matrix<K, N, T> b;
+    Matrix<K, M, T> aTransposed;
+    Matrix<N, K, T> bTransposed;
+    Matrix<M, N, T> c;
+
+    a.randomize(rng, (T)-1.0, (T)1.0);
+    b.randomize(rng, (T)-1.0, (T)1.0);
+    a.transpose(aTransposed);
+    b.transpose(bTransposed);
+
+    double_t flops = 2.0 * M * K * N;
+    std::string shape = shapeName(M, K, N);
+
+    bench.run("matrix", "multiply", shape, typeName<T>(), flops, 0.0, 0, [&]()
+    {
+        a.multiply(b, c);
+        Bench::doNotOptimize(c.getData());
+    });
+
+    bench.run("matrix", "transposeMultiply", shape, typeName<T>(), flops, 0.0, 0, [&]()
+    {
+        aTransposed.transposeMultiply(b, c);
+        Bench::doNotOptimize(c.getData());
+    });
+
+    bench.run("matrix", "multiplyTransposed", shape, typeName<T>(), flops, 0.0, 0, [&]()
+    {
+        a.multiplyTransposed(bTransposed, c);
+        Bench::doNotOptimize(c.getData());
+    });
+}
+
+// Copy into the transposed layout - every element read and written once
+template<uint16_t rows, uint16_t cols, typename T>
+void benchTranspose(Benchmark &bench)
+{
+    Matrix<rows, cols, T> a;
+    Matrix<cols, rows, T> result;
+
+    a.randomize(rng, (T)-1.0, (T)1.0);
+
+    bench.run("matrix", "transpose", shapeName(rows, cols), typeName<T>(), 0.0, 2.0 * rows * cols * sizeof(T), 0, [&]()
+    {
+        a.transpose(result);
+        Bench::doNotOptimize(result.getData());
+    });
+}
+
+// Element-wise kernels - bandwidth bound, so reported in GB/s as well
+template<uint16_t rows, uint16_t cols, typename T>
+void benchElementWise(Benchmark &bench)
+{
+    Matrix<rows, cols, T> a;
+    Matrix<rows, cols, T> b;
+    Matrix<rows, cols, T> outputs;
+    Matrix<rows, cols, T> errors;
+
+    a.randomize(rng, (T)-1.0, (T)1.0);
+    b.randomize(rng, (T)-1.0, (T)1.0);
+    outputs.randomize(rng, (T)0.0, (T)1.0);
+    errors.randomize(rng, (T)-1.0, (T)1.0);
+
+    const double_t count = (double_t)rows * cols;
+    std::string shape = shapeName(rows, cols);
+
+    bench.run("elementwise", "add", shape, typeName<T>(), count, 3.0 * count * sizeof(T), 0, [&]()
+    {
+        a.add(b);
+        Bench::doNotOptimize(a.getData());
+    });
+
+    bench.run("elementwise", "scale", shape, typeName<T>(), count, 2.0 * count * sizeof(T), 0, [&]()
+    {
+        a.scale((T)1.0);
+        Bench::doNotOptimize(a.getData());
+    });
+
+    bench.run("elementwise", "sigmoid", shape, typeName<T>(), 0.0, 2.0 * count * sizeof(T), 0, [&]()
+    {
+        b = outputs;
+        NN::Sigmoid<T>::apply(b.getData(), rows * cols);
+        Bench::doNotOptimize(b.getData());
+    });
+
+    bench.run("elementwise", "applyFunction(sigmoid)", shape, typeName<T>(), 0.0, 2.0 * count * sizeof(T), 0, [&]()
+    {
+        b = outputs;
+        b.applyFunction(NN::sigmoid<T>);
+        Bench::doNotOptimize(b.getData());
+    });
+
+    bench.run("elementwise", "activationGradient", shape, typeName<T>(), 4.0 * count, 3.0 * count * sizeof(T), 0, [&]()
+    {
+        b.template activationGradient<NN::Sigmoid<T>>(outputs, errors, (T)0.01);
+        Bench::doNotOptimize(b.getData());
+    });
+
+    bench.run("elementwise", "softmaxColumns", shape, typeName<T>(), 0.0, 2.0 * count * sizeof(T), 0, [&]()
+    {
+        b = outputs;
+        b.softmaxColumns();
+        Bench::doNotOptimize(b.getData());
+    });
+
+    // Fused optimizer updates - the step is tiny so the weights stay finite
+    Moments<rows, cols, T> moments;
+    moments.clear();
+    b.scale((T)1e-3);
+
+    Optimizer<T> momentum(Optimizer<T>::defaults(NN::Optimizers::MOMENTUM));
+    bench.run("elementwise", "optimizer(momentum)", shape, typeName<T>(), 4.0 * count, 5.0 * count * sizeof(T), 0, [&]()
+    {
+        momentum.beginStep((T)0.01);
+        momentum.update(a, b, moments);
+        Bench::doNotOptimize(a.getData());
+    });
+
+    Optimizer<T> adam(Optimizer<T>::defaults(NN::Optimizers::ADAM));
+    bench.run("elementwise", "optimizer(adam)", shape, typeName<T>(), 11.0 * count, 7.0 * count * sizeof(T), 0, [&]()
+    {
+        adam.beginStep((T)0.001);
+        adam.update(a, b, moments);
+        Bench::doNotOptimize(a.getData());
+    });
+}
+
+// Inference and training throughput of a Neural Net, one sample and a batch at a time
+template<uint16_t numInputs, uint16_t numHidden, uint16_t numOutputs, typename T>
+void benchNeuralNet(Benchmark &bench)
+{
+    typedef NeuralNet<numInputs, numHidden, numOutputs, T> Network;
+
+    const uint16_t BATCH_SIZE = 32;
+    const uint16_t NUM_SAMPLES = 256;
+
+    Network net(rng, NN::Activations::SIGMOID, (T)0.01);
+    net.randomize((T)-1.0, (T)1.0);
+
+    // A pool of samples cycled through so each call sees new inputs
+    std::vector<T> inputPool((uint64_t)NUM_SAMPLES * numInputs);
+    std::vector<T> answerPool((uint64_t)NUM_SAMPLES * numOutputs, (T)0.0);
+    std::uniform_real_distribution<double_t> uniform(0.0, 1.0);
+
+    for (uint16_t s = 0; s < NUM_SAMPLES; ++s)
+    {
+        for (uint16_t i = 0; i < numInputs; ++i)
+        {
+            inputPool[(uint64_t)s * numInputs + i] = (T)uniform(rng);
+        }
+        answerPool[(uint64_t)s * numOutputs + s % numOutputs] = (T)1.0;
+    }
+
+    const T(*inputs)[numInputs] = reinterpret_cast<const T(*)[numInputs]>(inputPool.data());
+    const T(*answers)[numOutputs] = reinterpret_cast<const T(*)[numOutputs]>(answerPool.data());
+
+    typename Network::template GuessBatch<BATCH_SIZE> guessBatch;
+    typename Network::template Batch<BATCH_SIZE> trainBatch;
+
+    for (uint16_t s = 0; s < BATCH_SIZE; ++s)
+    {
+        guessBatch.setInputs(s, inputs[s]);
+        trainBatch.setSample(s, inputs[s], answers[s]);
+    }
+
+    // Multiply-adds in one sample's feed forward - back propagation is about twice as many again
+    const double_t forwardFlops = 2.0 * ((double_t)numInputs * numHidden + (double_t)numHidden * numOutputs);
+    std::string shape = shapeName(numInputs, numHidden, numOutputs);
+
+    T outputs[numOutputs];
+    uint32_t next = 0;
+
+    bench.run("neuralnet", "guess", shape, typeName<T>(), forwardFlops, 0.0, 1, [&]()
+    {
+        net.guess(inputs[next], outputs);
+        next = (next + 1) % NUM_SAMPLES;
+        Bench::doNotOptimize(outputs);
+    });
+
+    bench.run("neuralnet", "guessBatch<32>", shape, typeName<T>(), forwardFlops * BATCH_SIZE, 0.0, BATCH_SIZE, [&]()
+    {
+        net.guessBatch(guessBatch);
+        Bench::doNotOptimize(guessBatch.outputValues.getData());
+    });
+
+    bench.run("neuralnet", "train", shape, typeName<T>(), 3.0 * forwardFlops, 0.0, 1, [&]()
+    {
+        net.train(inputs[next], answers[next]);
+        next = (next + 1) % NUM_SAMPLES;
+        Bench::doNotOptimize(net.getInputWeights().getData());
+    });
+
+    bench.run("neuralnet", "trainBatch<32>", shape, typeName<T>(), 3.0 * forwardFlops * BATCH_SIZE, 0.0, BATCH_SIZE, [&]()
+    {
+        net.trainBatch(trainBatch);
+        Bench::doNotOptimize(net.getInputWeights().getData());
+    });
+
+    // Per-sample training with moments - every weight is read and written with its moments
+    net.setOptimizer(Optimizer<T>::defaults(NN::Optimizers::ADAM));
+
+    bench.run("neuralnet", "train(adam)", shape, typeName<T>(), 3.0 * forwardFlops, 0.0, 1, [&]()
+    {
+        net.train(inputs[next], answers[next]);
+        next = (next + 1) % NUM_SAMPLES;
+        Bench::doNotOptimize(net.getInputWeights().getData());
+    });
+
+    net.setOptimizer(Optimizer<T>::defaults(NN::Optimizers::SGD));
+}
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    const char* filter = "";
+    const char* jsonPath = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--quick") == 0)
+        {
+            quick = true;
+        }
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+        {
+            filter = argv[++i];
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+        {
+            jsonPath = argv[++i];
+        }
+        else
+        {
+            printf("Usage: %s [--quick] [--filter text] [--json path]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    const char* simdLevel = levelName(Simd::ops<float>().level);
+    printf("SIMD: %s\n\n", simdLevel);
+
+    Benchmark bench(quick ? 0.005 : 0.1, quick ? 1 : 5, filter);
+
+    //////////////////////
+    // Matrix Kernels
+    //////////////////////
+    // Square sweep
+    benchMultiply<16, 16, 16, float>(bench);
+    benchMultiply<64, 64, 64, float>(bench);
+    benchMultiply<128, 128, 128, float>(bench);
+    benchMultiply<256, 256, 256, float>(bench);
+    benchMultiply<512, 512, 512, float>(bench);
+    benchMultiply<128, 128, 128, double_t>(bench);
+    benchMultiply<256, 256, 256, double_t>(bench);
+
+    // Layer shapes - single sample (GEMV) and mini-batch feed forward
+    benchMultiply<128, 784, 1, float>(bench);
+    benchMultiply<128, 784, 32, float>(bench);
+    benchMultiply<10, 128, 32, float>(bench);
+
+    benchTranspose<64, 64, float>(bench);
+    benchTranspose<784, 128, float>(bench);
+    benchTranspose<784, 128, double_t>(bench);
+
+    benchElementWise<128, 32, float>(bench);
+    benchElementWise<1024, 256, float>(bench);
+    benchElementWise<1024, 256, double_t>(bench);
+
+    //////////////////////
+    // Neural Network
+    //////////////////////
+    benchNeuralNet<784, 32, 10, float>(bench);
+    benchNeuralNet<784, 128, 10, float>(bench);
+    benchNeuralNet<784, 256, 10, float>(bench);
+    benchNeuralNet<784, 128, 10, double_t>(bench);
+
+    bench.print();
+
+    if (jsonPath != nullptr)
+    {
+        if (!bench.writeJson(jsonPath, simdLevel))
+        {
+            printf("Could not write %s\n", jsonPath);
+            return 1;
+        }
+        printf("Report written to %s\n", jsonPath);
+    }
+
+    return 0;
+}
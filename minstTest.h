@@ -1,10 +1,20 @@
 #pragma once
 
+#include "AsyncCheckpointer.h"
+#include "BatchPipeline.h"
+#include "Checkpoint.h"
+#include "DeepNet.h"
+#include "IdxFile.h"
 #include "Matrix.h"
 #include "NeuralNet.h"
+#include "ParallelTrainer.h"
+#include "QuantizedNet.h"
+#include "Sampler.h"
+#include "StreamingDataset.h"
+#include "TrainingSchedule.h"
 
+#include <chrono>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <stdint.h>
 
@@ -14,22 +24,140 @@ const uint16_t IMG_LEN = IMG_WIDTH * IMG_WIDTH;
 const uint16_t numOutput = 10;
 const uint16_t numHidden = 100;
 
-std::mt19937 mnistRng((uint32_t)std::time(0));
-NeuralNet<IMG_LEN, numHidden, numOutput>* brain = new NeuralNet<IMG_LEN, numHidden, numOutput>(mnistRng,    // Random Number Generator
+// Element type of the images and the Neural Net - float halves the memory traffic of double
+typedef float minstScalar;
+
+// Seed of every random stream in the run - 0 seeds from the clock, anything
+// else repeats the weights and the sample order of a run
+const uint64_t SEED = 0;
+const uint64_t RUN_SEED = (SEED != 0) ? SEED : (uint64_t)std::time(0);
+
+std::mt19937 mnistRng((uint32_t)Sampler::streamSeed(RUN_SEED, 0));
+// Matrix storage is heap backed, so the Neural Net itself is small enough to be a global
+NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar> brain(mnistRng,    // Random Number Generator
     NN::Activations::SIGMOID, // Activation Function
     0.001); // Learning Rate
 
+// Data-parallel trainer - every mini-batch is BATCH_SIZE images on any machine,
+// split into shards of SHARD_SIZE that the workers share - 32 shards, so up to
+// 32 cores train at once and more cores than that stay idle
+const uint16_t BATCH_SIZE = 128;
+const uint16_t SHARD_SIZE = 4;
+ParallelTrainer<IMG_LEN, numHidden, numOutput, BATCH_SIZE, minstScalar, SHARD_SIZE> trainer(brain);
+
+// Weight update rule of the brain and the deep comparison - MOMENTUM reaches
+// the accuracy plain SGD does in a third of the epochs
+NN::Optimizers OPTIMIZER = NN::Optimizers::SGD;
+
+// Learning rate of every mini-batch update, and how many epochs are trained -
+// the rate halves each epoch the test accuracy fails to reach a new best, and
+// training stops after 3 such epochs in a row
+TrainingSchedule<minstScalar> schedule({
+    brain.getLearningRate(),    // Peak Learning Rate
+    0,                          // Warmup Updates
+    NN::Decays::CONSTANT,       // Decay after the Warmup
+    0,                          // Decay Updates
+    (minstScalar)1.0,           // Step Decay Factor
+    (minstScalar)0.00001,       // Minimum Learning Rate
+    1,                          // Plateau Patience
+    (minstScalar)0.5,           // Plateau Factor
+    3,                          // Early Stopping Patience
+    0.0001,                     // Minimum Improvement in Accuracy
+    20 });                      // Maximum Epochs
+
+// Scale from a pixel byte to [0, 1]
+const minstScalar PIXEL_SCALE = (minstScalar)(1.0 / 255.0);
+
+// Test images are packed as raw pixels and scaled inside the first layer product
+NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar>::ByteGuessBatch<BATCH_SIZE> testBatch(PIXEL_SCALE);
 
 struct minstImage
 {
     uint16_t label;
 
-    double_t image[IMG_LEN];
+    // Zero-copy view of the pixels in the mapped image file
+    const uint8_t* pixels;
+
+    minstImage(uint8_t lab, const uint8_t* pix) : label(lab), pixels(pix) { ; }
+
+    // Normalise the pixels to [0, 1] for the Neural Net
+    void normalize(minstScalar(&image)[IMG_LEN]) const
+    {
+        Simd::ops<minstScalar>().fromBytes(image, pixels, PIXEL_SCALE, IMG_LEN);
+    }
 
-    minstImage(uint8_t lab) : label(lab), image{0.0} { ; }
+    // Get the raw pixels, e.g. for inference on the compact bytes
+    const uint8_t(&getPixels() const)[IMG_LEN]
+    {
+        return *(const uint8_t(*)[IMG_LEN])pixels;
+    }
 };
 
-uint16_t MAX_IMAGES = 0xFFFF;
+uint32_t MAX_IMAGES = 0xFFFFFFFF;
+
+// Compare serial and lock-free Hogwild training before the main training run
+bool COMPARE_HOGWILD = false;
+
+// Compare full precision and int8 inference after the main training run
+bool COMPARE_QUANTIZED = false;
+
+// Number of test images used to calibrate the int8 activation ranges
+const uint16_t NUM_CALIBRATION = 1000;
+
+// Train and test a network with two hidden layers after the main training run,
+// against a control with the brain's single hidden layer trained the same way
+bool COMPARE_DEEP = false;
+
+// Networks for the deep comparison - every layer size is a template argument
+// Both back propagate DeepNet's deltas, so only their depth differs - the brain
+// itself back propagates the raw output error, which matches DeepNet only for
+// SOFTMAX, so it is not the control
+typedef DeepNet<minstScalar, IMG_LEN, 128, 64, numOutput> DeepBrain;
+typedef DeepNet<minstScalar, IMG_LEN, numHidden, numOutput> ShallowBrain;
+
+// Stream the training images from disk through a bounded ring buffer instead
+// of iterating the mapped training set - for data sets larger than RAM
+bool STREAM_TRAINING = false;
+
+// Streamed training images - at most 4 chunks of 4096 images are resident
+StreamingDataset trainingStream(4096, 4);
+
+// Shuffle, normalise and augment the next mini-batches on a background thread
+// while the current one trains - ignored when streaming
+bool PREFETCH_TRAINING = false;
+
+// Random distortions of the prefetched training images - shift in pixels,
+// rotation in radians and gaussian noise, e.g. { 2, 0.17f, 0.02f }
+BatchPipeline<IMG_LEN, numOutput, minstScalar>::Augmentation TRAINING_AUGMENTATION = { 0, 0.0f, 0.0f };
+
+// Prefetched training batches - one worker filling a double buffer
+BatchPipeline<IMG_LEN, numOutput, minstScalar> trainingPipeline(trainer.getBatchSize(), IMG_WIDTH, 1, 2, Sampler::streamSeed(RUN_SEED, 1));
+
+// Order of the training images in every epoch when not streamed - STRATIFIED
+// trains each digit equally often, but its perfectly balanced batches hold the
+// zero initialised brain at chance for longer than SHUFFLED does
+Sampler::Mode TRAINING_SAMPLING = Sampler::Mode::SHUFFLED;
+
+// Order of the training images when not prefetched or streamed
+Sampler trainingSampler(0, Sampler::streamSeed(RUN_SEED, 2));
+
+// Start training from the latest checkpoint rather than the initial weights
+bool RESUME_CHECKPOINT = false;
+
+// Checkpoint the brain in the background while it trains, then map the final
+// checkpoint into a serving copy
+bool SAVE_CHECKPOINT = false;
+
+// Location of the brain's checkpoint
+const char* const CHECKPOINT_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\brain.nnck";
+
+// Checkpoint every 500 mini-batches or 30 seconds, whichever comes first
+AsyncCheckpointer<IMG_LEN, numHidden, numOutput, minstScalar> checkpointer(CHECKPOINT_PATH, 500, 30.0);
+
+#if NN_PROFILE
+// Location of the Chrome trace written when built with NN_PROFILE=1
+const char* const TRACE_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\brain.trace.json";
+#endif
 
 // Only test and train for a subset of digits
 uint16_t TESTING_MASK[numOutput] = { 1,  // 0
@@ -43,10 +171,25 @@ uint16_t TESTING_MASK[numOutput] = { 1,  // 0
                                      0,  // 8
                                      0 };// 9
 
-uint16_t numTraining = 0;
+// Location of the MNIST IDX files
+const char* const TRAIN_LABELS_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\train-labels.idx1-ubyte";
+const char* const TRAIN_IMAGES_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\train-images.idx3-ubyte";
+const char* const TEST_LABELS_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\t10k-labels.idx1-ubyte";
+const char* const TEST_IMAGES_PATH = "C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\t10k-images.idx3-ubyte";
+
+// Mapped IDX files - every minstImage points into these
+IdxFile trainLabelsFile;
+IdxFile trainImagesFile;
+IdxFile testLabelsFile;
+IdxFile testImagesFile;
+
+uint32_t numTraining = 0;
 std::vector<minstImage> trainingSet;
 
-uint16_t numTest = 0;
+// Training images of the digits being tested - the samples trainingSampler orders
+std::vector<uint32_t> trainingSamples;
+
+uint32_t numTest = 0;
 std::vector<minstImage> testSet;
 
 void drawImage(minstImage* img)
@@ -56,7 +199,7 @@ void drawImage(minstImage* img)
         for (int j = 0; j < IMG_WIDTH; ++j)
         {
             uint16_t idx = i * IMG_WIDTH + j;
-            if (img->image[idx] > 0.0)
+            if (img->pixels[idx] > 0)
             {
                 std::cout << img->label << ' ';
             }
@@ -70,302 +213,666 @@ void drawImage(minstImage* img)
     }
 }
 
-void importData()
+// Map a labels and images IDX pair and add a view of every image to the set
+// Returns the number of images added
+uint32_t importSet(const char* labelsPath, const char* imagesPath, IdxFile &labels, IdxFile &images, std::vector<minstImage> &set)
 {
-    // Get Training Labels
-    std::ifstream fin("C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\train-labels.idx1-ubyte", std::ios::binary);
+    if (!labels.open(labelsPath) || !images.open(imagesPath))
+    {
+        std::cout << "Error: Unable to load " << labelsPath << " and " << imagesPath << std::endl;
+        return 0;
+    }
 
-    if (!fin.is_open())
+    // One label per image and one IMG_WIDTH x IMG_WIDTH image per label
+    if (labels.getItemSize() != 1 || images.getItemSize() != IMG_LEN || labels.getCount() != images.getCount())
     {
-#pragma warning(suppress : 4996)
-        std::cout << "Error: " << strerror(errno);
-        return;
+        std::cout << "Error: " << imagesPath << " does not hold " << IMG_WIDTH << "x" << IMG_WIDTH << " images matching " << labelsPath << std::endl;
+        return 0;
+    }
+
+    uint32_t count = (labels.getCount() < MAX_IMAGES) ? (uint32_t)labels.getCount() : MAX_IMAGES;
+
+    set.reserve(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        set.push_back(minstImage(*labels.getItem(i), images.getItem(i)));
     }
 
-    char tmp = 0;
-    
-    // Read MAGIC code
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    return count;
+}
 
-    // Read number of images
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+void importData()
+{
+    numTraining = importSet(TRAIN_LABELS_PATH, TRAIN_IMAGES_PATH, trainLabelsFile, trainImagesFile, trainingSet);
 
-    // Read all Labels
-    while (fin)
+    numTest = importSet(TEST_LABELS_PATH, TEST_IMAGES_PATH, testLabelsFile, testImagesFile, testSet);
+
+    if (STREAM_TRAINING && (!trainingStream.openIdx(TRAIN_LABELS_PATH, TRAIN_IMAGES_PATH) || trainingStream.getSampleSize() != IMG_LEN))
     {
-        fin.read(&tmp, 1);
+        std::cout << "Error: Unable to stream " << TRAIN_IMAGES_PATH << std::endl;
+        trainingSet.clear();
+    }
 
-        // Ensure read completed successfully
-        if (fin)
+    // Every training image of the digits being tested feeds the pipeline and the sampler
+    std::vector<BatchPipeline<IMG_LEN, numOutput, minstScalar>::Source> sources;
+    std::vector<uint16_t> labels;
+    for (uint32_t idx = 0; idx < trainingSet.size(); ++idx)
+    {
+        if (TESTING_MASK[trainingSet[idx].label] == 1)
         {
-            if (++numTraining < MAX_IMAGES)
-            {
-                trainingSet.push_back(minstImage(tmp));
-            }
+            sources.push_back({ (uint8_t)trainingSet[idx].label, trainingSet[idx].pixels });
+            trainingSamples.push_back(idx);
+            labels.push_back(trainingSet[idx].label);
         }
     }
 
-    fin.close();
+    trainingPipeline.setSources(sources);
+    trainingPipeline.setSampling(TRAINING_SAMPLING);
+    trainingPipeline.setAugmentation(TRAINING_AUGMENTATION);
 
-    // Get Training Images
-    fin.open("C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\train-images.idx3-ubyte", std::ios::binary);
+    trainingSampler.setLabels(labels);
+    trainingSampler.setMode(TRAINING_SAMPLING);
+}
 
-    if (!fin.is_open())
+template <typename T>
+int getHighestIndex(T* arr, uint16_t arrSize)
+{
+    int index = -1;
+    T highest = static_cast<T>(0.0);
+
+    for (int i = 0; i < arrSize; ++i)
     {
-#pragma warning(suppress : 4996)
-        std::cout << "Error: " << strerror(errno);
-        return;
+        if (arr[i] > highest)
+        {
+            highest = arr[i];
+            index = i;
+        }
     }
 
-    // Read number of rows
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    return index;
+}
+
+uint32_t numTrained[10] = { 0 };
+
+// Set the brain's learning rate for its next mini-batch update - images left
+// over from a partial batch train at the rate of the batch before them
+void scheduleUpdate()
+{
+    brain.setLearningRate(schedule.nextRate());
+}
+
+void trainEpoch()
+{
+    minstScalar answer[numOutput] = { 0.0 };
+    for (int k = 0; k < numOutput; ++k)
+    {
+        answer[k] = 0.0;
+    }
 
-    // read number of columns
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    // Normalised pixels of the current image
+    minstScalar image[IMG_LEN] = { 0.0 };
 
-    // Read MAGIC code
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    uint32_t numImagesTrained = 0;
 
-    // Read number of images
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    // Images packed into the current mini-batch
+    uint32_t batchCount = 0;
+    std::vector<uint32_t> batchIdx(trainer.getBatchSize(), 0);
 
-    // Read all Images
-    for (int i = 0; i < numTraining; ++i)
+    // Nothing in the training set matches the mask
+    if (trainingSampler.size() == 0)
     {
-        minstImage* img = &trainingSet[i];
+        return;
+    }
+
+    while (numImagesTrained < numTraining)
+    {
+        // Continue the sampler's current epoch, starting the next one once it is used up
+        uint64_t sample = 0;
+        if (!trainingSampler.next(sample))
+        {
+            trainingSampler.nextEpoch();
+            continue;
+        }
+
+        uint32_t idx = trainingSamples[sample];
+
+        // Set Correct Answer
+        answer[trainingSet[idx].label] = 1.0;
+
+        // Pack into the mini-batch
+        trainingSet[idx].normalize(image);
+        trainer.setSample(batchCount, image, answer);
+        batchIdx[batchCount++] = idx;
 
-        for (int j = 0; j < IMG_LEN; ++j)
+        // Train NN across all workers once the batch is full
+        if (batchCount == trainer.getBatchSize())
         {
-            fin.read(&tmp, 1);
+            scheduleUpdate();
+            trainer.train();
+            batchCount = 0;
 
-            // Ensure read completed successfully
-            if (fin)
+            if (SAVE_CHECKPOINT)
             {
-                img->image[j] = (uint8_t)tmp / 255.0;
+                checkpointer.step(brain);
             }
         }
-        //drawImage(img);
-    }
 
-    fin.close();
+        // Track how many of each digit were trained
+        ++numTrained[trainingSet[idx].label];
+        ++numImagesTrained;
 
-    // Get Testing Labels
-    fin.open("C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\t10k-labels.idx1-ubyte", std::ios::binary);
+        // Reset Answer Array
+        answer[trainingSet[idx].label] = 0.0;
+    }
 
-    if (!fin.is_open())
+    // Train any images left over from a partial batch one at a time
+    for (uint32_t i = 0; i < batchCount; ++i)
     {
-#pragma warning(suppress : 4996)
-        std::cout << "Error: " << strerror(errno);
-        return;
+        answer[trainingSet[batchIdx[i]].label] = 1.0;
+
+        trainingSet[batchIdx[i]].normalize(image);
+        brain.train(image, answer);
+
+        answer[trainingSet[batchIdx[i]].label] = 0.0;
     }
+}
+
+// Train the same number of images as trainEpoch, but streamed from disk - the
+// stream can only be read in file order, where the digits are already mixed
+void trainEpochStreaming()
+{
+    minstScalar answer[numOutput] = { 0.0 };
 
-    // Read MAGIC code
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    // Normalised pixels of every image packed into the current mini-batch - a
+    // streamed image is only valid until the next one is read, so partial
+    // batches are kept here to be trained one at a time at the end
+    std::vector<minstScalar> batchImages((size_t)trainer.getBatchSize() * IMG_LEN, 0.0);
+    std::vector<uint8_t> batchLabels(trainer.getBatchSize(), 0);
+    uint32_t batchCount = 0;
 
-    // Read number of images
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    uint32_t numImagesTrained = 0;
+    StreamingDataset::Sample sample;
 
-    // Read all Labels
-    while (fin)
+    while (numImagesTrained < numTraining)
     {
-        fin.read(&tmp, 1);
+        uint32_t numPassTrained = 0;
+
+        trainingStream.start();
 
-        // Ensure read completed successfully
-        if (fin)
+        while (numImagesTrained < numTraining && trainingStream.next(sample))
         {
-            if (++numTest < MAX_IMAGES)
+            if (TESTING_MASK[sample.label] == 1)
             {
-                testSet.push_back(minstImage(tmp));
+                minstScalar(&image)[IMG_LEN] = *(minstScalar(*)[IMG_LEN])&batchImages[(size_t)batchCount * IMG_LEN];
+                Simd::ops<minstScalar>().fromBytes(image, sample.data, PIXEL_SCALE, IMG_LEN);
+
+                // Pack into the mini-batch
+                answer[sample.label] = 1.0;
+                trainer.setSample(batchCount, image, answer);
+                answer[sample.label] = 0.0;
+
+                batchLabels[batchCount++] = sample.label;
+
+                // Train NN across all workers once the batch is full
+                if (batchCount == trainer.getBatchSize())
+                {
+                    scheduleUpdate();
+                    trainer.train();
+                    batchCount = 0;
+
+                    if (SAVE_CHECKPOINT)
+                    {
+                        checkpointer.step(brain);
+                    }
+                }
+
+                // Track how many of each digit were trained
+                ++numTrained[sample.label];
+                ++numImagesTrained;
+                ++numPassTrained;
             }
         }
+
+        // Nothing in the stream matches the mask
+        if (numPassTrained == 0)
+        {
+            break;
+        }
     }
 
-    fin.close();
+    trainingStream.stop();
+
+    // Train any images left over from a partial batch one at a time
+    for (uint32_t i = 0; i < batchCount; ++i)
+    {
+        answer[batchLabels[i]] = 1.0;
 
-    // Get Testing Images
-    fin.open("C:\\Users\\edwar\\Documents\\_Fun\\Code\\NeuralNet\\minstData\\t10k-images.idx3-ubyte", std::ios::binary);
+        brain.train(*(minstScalar(*)[IMG_LEN])&batchImages[(size_t)i * IMG_LEN], answer);
 
-    if (!fin.is_open())
+        answer[batchLabels[i]] = 0.0;
+    }
+}
+
+// Train the same number of images as trainEpoch, sampled the same way, but in
+// mini-batches prepared by the pipeline while the previous one trains
+void trainEpochPrefetched()
+{
+    uint32_t numImagesTrained = 0;
+    const BatchPipeline<IMG_LEN, numOutput, minstScalar>::Batch* batch = nullptr;
+
+    while (numImagesTrained < numTraining)
     {
-#pragma warning(suppress : 4996)
-        std::cout << "Error: " << strerror(errno);
-        return;
+        uint32_t numPassTrained = 0;
+
+        trainingPipeline.start();
+
+        while (numImagesTrained < numTraining && trainingPipeline.next(batch))
+        {
+            if (batch->count == trainer.getBatchSize())
+            {
+                // Train NN across all workers
+                for (uint32_t i = 0; i < batch->count; ++i)
+                {
+                    trainer.setSample(i, batch->getInputs(i), batch->getAnswers(i));
+                }
+                scheduleUpdate();
+                trainer.train();
+
+                if (SAVE_CHECKPOINT)
+                {
+                    checkpointer.step(brain);
+                }
+            }
+            else
+            {
+                // Train the partial batch at the end of a pass one at a time
+                for (uint32_t i = 0; i < batch->count; ++i)
+                {
+                    brain.train(batch->getInputs(i), batch->getAnswers(i));
+                }
+            }
+
+            // Track how many of each digit were trained
+            for (uint32_t i = 0; i < batch->count; ++i)
+            {
+                ++numTrained[batch->getLabel(i)];
+            }
+            numImagesTrained += batch->count;
+            numPassTrained += batch->count;
+        }
+
+        // Nothing in the training set matches the mask
+        if (numPassTrained == 0)
+        {
+            break;
+        }
     }
 
-    // Read number of rows
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    trainingPipeline.stop();
+}
 
-    // read number of columns
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+uint32_t numTested[10] = { 0 };
+
+double_t testEpoch(const NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar> &net = brain)
+{
+    minstScalar output[numOutput] = { 0.0 };
+    for (int k = 0; k < numOutput; ++k)
+    {
+        output[k] = 0.0;
+    }
 
-    // Read MAGIC code
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    double_t numImagesTested = 0.0;
+    double_t numCorrect = 0.0;
 
-    // Read number of images
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
-    fin.read(&tmp, 1);
+    // Images packed into the current batch
+    uint16_t batchCount = 0;
+    int batchIdx[BATCH_SIZE] = { 0 };
 
-    // Read all Images
-    for (int i = 0; i < numTest; ++i)
+    for(uint32_t i = 0; i < numTest; ++i)
     {
-        minstImage* img = &testSet[i];
+        if (TESTING_MASK[testSet[i].label] == 1)
+        {
+            // Pack the raw pixels into the batch
+            testBatch.setInputs(batchCount, testSet[i].getPixels());
+            batchIdx[batchCount++] = i;
 
-        for (int j = 0; j < IMG_LEN; ++j)
+            // Track how many of each digit were tested
+            ++numTested[testSet[i].label];
+            ++numImagesTested;
+        }
+
+        // Test NN once the batch is full or the last image has been packed
+        if (batchCount == BATCH_SIZE || (i == numTest - 1 && batchCount > 0))
         {
-            fin.read(&tmp, 1);
+            net.guessBatch(testBatch);
 
-            // Ensure read completed successfully
-            if (fin)
+            for (uint16_t j = 0; j < batchCount; ++j)
             {
-                img->image[j] = (uint8_t)tmp / 255.0;
+                testBatch.getOutputs(j, output);
+
+                if (getHighestIndex(output, numOutput) == testSet[batchIdx[j]].label)
+                {
+                    ++numCorrect;
+                }
             }
+
+            batchCount = 0;
         }
-        //drawImage(img);
     }
 
+    return (numImagesTested > 0.0) ? numCorrect / numImagesTested : 0.0;
 }
 
-template <typename T>
-int getHighestIndex(T* arr, uint16_t arrSize)
+// Train one epoch serially and one epoch with lock-free Hogwild workers, both
+// from the current weights, and report the throughput and accuracy of each
+// Both run the same trainHogwild step - plain SGD whatever OPTIMIZER is - so
+// the only difference between them is the threading
+void hogwildComparison(uint16_t numWorkers)
 {
-    int index = -1;
-    T highest = static_cast<T>(0.0);
+    NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar> serialNet(brain);
+    NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar> hogwildNet(brain);
 
-    for (int i = 0; i < arrSize; ++i)
+    // Every training image of the digits being tested, in one shuffled order for both
+    Sampler sampler(trainingSamples.size(), Sampler::streamSeed(RUN_SEED, 3));
+    sampler.startEpoch(0);
+
+    // Serial - one sample at a time on one thread with one workspace
+    NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar>::Batch<1> workspace;
+    minstScalar answer[numOutput] = { 0.0 };
+    minstScalar image[IMG_LEN] = { 0.0 };
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint64_t i = 0; i < sampler.size(); ++i)
     {
-        if (arr[i] > highest)
+        uint32_t idx = trainingSamples[sampler[i]];
+
+        answer[trainingSet[idx].label] = 1.0;
+        trainingSet[idx].normalize(image);
+        serialNet.trainHogwild(image, answer, workspace);
+        answer[trainingSet[idx].label] = 0.0;
+    }
+
+    double_t serialSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
+
+    // Hogwild - every worker trains its own shard of the same order on the shared weights
+    ThreadPool pool(numWorkers);
+
+    start = std::chrono::steady_clock::now();
+
+    pool.run([&](uint16_t workerIdx)
+    {
+        NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar>::Batch<1> workspace;
+        minstScalar workerAnswer[numOutput] = { 0.0 };
+        minstScalar workerImage[IMG_LEN] = { 0.0 };
+
+        uint64_t first = 0;
+        uint64_t last = 0;
+        sampler.getShard(workerIdx, pool.getNumWorkers(), first, last);
+
+        for (uint64_t i = first; i < last; ++i)
         {
-            highest = arr[i];
-            index = i;
+            uint32_t idx = trainingSamples[sampler[i]];
+
+            workerAnswer[trainingSet[idx].label] = 1.0;
+            trainingSet[idx].normalize(workerImage);
+            hogwildNet.trainHogwild(workerImage, workerAnswer, workspace);
+            workerAnswer[trainingSet[idx].label] = 0.0;
         }
-    }
+    });
 
-    return index;
-}
+    double_t hogwildSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
 
-uint32_t numTrained[10] = { 0 };
+    std::cout << "Serial  (1 thread): " << sampler.size() / serialSeconds << " samples/s - Accuracy: "
+              << testEpoch(serialNet) * 100 << "%" << std::endl;
+    std::cout << "Hogwild (" << pool.getNumWorkers() << " threads): " << sampler.size() / hogwildSeconds << " samples/s - Accuracy: "
+              << testEpoch(hogwildNet) * 100 << "%" << std::endl;
+}
 
-void trainEpoch()
+// Quantize the trained brain to int8 - calibrated on a sample of the test set -
+// and report the inference throughput and accuracy of both versions
+void quantizedComparison()
 {
-    double_t answer[numOutput] = { 0.0 };
-    for (int k = 0; k < numOutput; ++k)
+    QuantizedNet<IMG_LEN, numHidden, numOutput, minstScalar>* quantized = new QuantizedNet<IMG_LEN, numHidden, numOutput, minstScalar>();
+
+    minstScalar image[IMG_LEN] = { 0.0 };
+
+    for (size_t i = 0; i < testSet.size() && i < NUM_CALIBRATION; ++i)
     {
-        answer[k] = 0.0;
+        testSet[i].normalize(image);
+        quantized->calibrate(brain, image);
     }
+    quantized->quantize(brain);
 
-    std::uniform_real_distribution<float> uniformDist(0, numTraining);
+    minstScalar output[numOutput] = { 0.0 };
 
-    uint32_t numImagesTrained = 0;
+    double_t numImagesTested = 0.0;
+    double_t numFloatCorrect = 0.0;
+    double_t numQuantizedCorrect = 0.0;
 
-    while (numImagesTrained < numTraining)
+    // Full Precision - one image at a time, like a serving request
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < testSet.size(); ++i)
     {
-        //int idx = uniformDist(mnistRng);
-        // Temp train all images in order
-        for (int idx = 0; idx < numTraining; ++idx)
+        if (TESTING_MASK[testSet[i].label] == 1)
         {
-            if (TESTING_MASK[trainingSet[idx].label] == 1 &&
-                //true)
-                trainingSet[idx].label != getHighestIndex(numTrained, numOutput))
+            testSet[i].normalize(image);
+            brain.guess(image, output);
+
+            if (getHighestIndex(output, numOutput) == testSet[i].label)
             {
-                // Set Correct Answer
-                answer[trainingSet[idx].label] = 1.0;
+                ++numFloatCorrect;
+            }
+            ++numImagesTested;
+        }
+    }
 
-                // Train NN
-                brain->train(trainingSet[0].image, answer);
-                // Track how many of each digit were trained
-                ++numTrained[trainingSet[idx].label];
-                ++numImagesTrained;
+    double_t floatSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
 
-                // Reset Answer Array
-                answer[trainingSet[idx].label] = 0.0;
+    // Int8
+    start = std::chrono::steady_clock::now();
 
+    for (size_t i = 0; i < testSet.size(); ++i)
+    {
+        if (TESTING_MASK[testSet[i].label] == 1)
+        {
+            testSet[i].normalize(image);
+            quantized->guess(image, output);
+
+            if (getHighestIndex(output, numOutput) == testSet[i].label)
+            {
+                ++numQuantizedCorrect;
             }
         }
     }
+
+    double_t quantizedSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
+
+    if (numImagesTested > 0.0)
+    {
+        std::cout << "Full Precision: " << numImagesTested / floatSeconds << " inferences/s - Accuracy: "
+                  << numFloatCorrect / numImagesTested * 100 << "%" << std::endl;
+        std::cout << "Int8 (" << quantized->getWeightBytes() << " weight bytes): " << numImagesTested / quantizedSeconds << " inferences/s - Accuracy: "
+                  << numQuantizedCorrect / numImagesTested * 100 << "%" << std::endl;
+    }
+
+    delete quantized;
 }
 
-uint32_t numTested[10] = { 0 };
+// Checkpoint the trained brain, map the checkpoint into a new Neural Net the way
+// a serving process would, and report the time taken and accuracy of each
+void checkpointComparison()
+{
+    uint32_t numPeriodic = checkpointer.getNumWritten();
+
+    // Training only stalls for the snapshot copy - the write is in the background
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    checkpointer.checkpoint(brain);
+
+    double_t snapshotSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
+
+    checkpointer.flush();
+
+    double_t saveSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
+
+    if (checkpointer.getNumFailed() > 0)
+    {
+        std::cout << "Error: Unable to save " << CHECKPOINT_PATH << std::endl;
+        return;
+    }
+
+    NeuralNet<IMG_LEN, numHidden, numOutput, minstScalar> servingNet(mnistRng, brain.getActivation());
+    CheckpointFile checkpoint;
+
+    start = std::chrono::steady_clock::now();
+
+    if (!checkpoint.open(CHECKPOINT_PATH) || !checkpoint.attach(servingNet))
+    {
+        std::cout << "Error: Unable to map " << CHECKPOINT_PATH << std::endl;
+        return;
+    }
 
-double_t testEpoch()
+    double_t mapSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Checkpoint " << checkpointer.getStep() << " (" << numPeriodic << " periodic) Snapshot in " << snapshotSeconds * 1000
+              << "ms, Saved in " << saveSeconds * 1000 << "ms - Accuracy: " << testEpoch(brain) * 100 << "%" << std::endl;
+    std::cout << "Checkpoint Mapped in " << mapSeconds * 1000 << "ms - Accuracy: " << testEpoch(servingNet) * 100 << "%" << std::endl;
+}
+
+// Train a DeepNet from random weights for numEpochs epochs of mini-batches
+// and report its throughput and accuracy
+template<typename Network>
+void deepRun(const char* name, uint16_t numEpochs)
 {
-    double_t output[numOutput] = { 0.0 };
-    for (int k = 0; k < numOutput; ++k)
+    Network deep(mnistRng, brain.getActivation(), brain.getLearningRate());
+    deep.setOptimizer(brain.getOptimizer().getSettings());
+
+    // Hidden layers of identical neurons never diverge, so start from random weights
+    deep.randomize((minstScalar)-0.1, (minstScalar)0.1);
+
+    typename Network::template Batch<BATCH_SIZE> batch;
+    uint16_t batchCount = 0;
+
+    minstScalar answer[numOutput] = { 0.0 };
+    minstScalar image[IMG_LEN] = { 0.0 };
+
+    uint32_t numImagesTrained = 0;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    for (uint16_t epoch = 0; epoch < numEpochs; ++epoch)
     {
-        output[k] = 0.0;
+        for (size_t idx = 0; idx < trainingSet.size(); ++idx)
+        {
+            if (TESTING_MASK[trainingSet[idx].label] == 1)
+            {
+                answer[trainingSet[idx].label] = 1.0;
+                trainingSet[idx].normalize(image);
+                batch.setSample(batchCount++, image, answer);
+                answer[trainingSet[idx].label] = 0.0;
+
+                // A partial batch at the end of an epoch is dropped
+                if (batchCount == BATCH_SIZE)
+                {
+                    deep.trainBatch(batch);
+                    numImagesTrained += batchCount;
+                    batchCount = 0;
+                }
+            }
+        }
     }
 
-    std::uniform_real_distribution<float> uniformDist(0, numTest);
+    double_t trainSeconds = std::chrono::duration<double_t>(std::chrono::steady_clock::now() - start).count();
 
-    double_t numImagesTested = 1.0;
+    // Test in batches the same way as testEpoch
+    typename Network::template GuessBatch<BATCH_SIZE> deepTestBatch;
+    int batchIdx[BATCH_SIZE] = { 0 };
+    minstScalar output[numOutput] = { 0.0 };
+
+    double_t numImagesTested = 0.0;
     double_t numCorrect = 0.0;
+    batchCount = 0;
 
-    for(int i = 0; i < numTest; ++i)
+    for (uint32_t i = 0; i < numTest; ++i)
     {
         if (TESTING_MASK[testSet[i].label] == 1)
         {
-            // Test NN
-            brain->guess(testSet[i].image, output);
-            // Track how many of each digit were tested
-            ++numTested[testSet[i].label];
+            testSet[i].normalize(image);
+            deepTestBatch.setInputs(batchCount, image);
+            batchIdx[batchCount++] = i;
             ++numImagesTested;
+        }
 
-            if (getHighestIndex(output, numOutput) == testSet[i].label)
+        if (batchCount == BATCH_SIZE || (i == numTest - 1 && batchCount > 0))
+        {
+            deep.guessBatch(deepTestBatch);
+
+            for (uint16_t j = 0; j < batchCount; ++j)
             {
-                ++numCorrect;
+                deepTestBatch.getOutputs(j, output);
+
+                if (getHighestIndex(output, numOutput) == testSet[batchIdx[j]].label)
+                {
+                    ++numCorrect;
+                }
             }
+
+            batchCount = 0;
         }
     }
 
-    return numCorrect / numImagesTested;
+    std::cout << name << " (" << Network::NUM_LAYERS << " layers, " << deep.getWeightBytes() + batch.getBytes() << " bytes): "
+              << numImagesTrained / trainSeconds << " samples/s - Accuracy: "
+              << ((numImagesTested > 0.0) ? numCorrect / numImagesTested : 0.0) * 100 << "%" << std::endl;
+}
+
+// Train the two hidden layer network and its one hidden layer control with the
+// same rule, activation, optimizer and epochs, so the gap is the effect of depth
+void deepComparison(uint16_t numEpochs)
+{
+    deepRun<ShallowBrain>("Shallow", numEpochs);
+    deepRun<DeepBrain>("Deep", numEpochs);
 }
 
 void minstMain()
 {
     importData();
 
-    std::cout << "Data Imported" << std::endl;
+    if (trainingSet.empty() || testSet.empty())
+    {
+        return;
+    }
+
+    std::cout << "Data Imported - Seed: " << RUN_SEED << std::endl;
+
+    brain.setOptimizer(Optimizer<minstScalar>::defaults(OPTIMIZER));
+
+    if (RESUME_CHECKPOINT)
+    {
+        if (checkpointer.resume(brain))
+        {
+            // Carry on with the learning rate of the batch the checkpoint stopped at
+            schedule.restart(checkpointer.getStep());
+
+            std::cout << "Checkpoint Loaded - Resuming from Batch " << checkpointer.getStep() << std::endl;
+        }
+        else
+        {
+            std::cout << "Error: Unable to load " << CHECKPOINT_PATH << std::endl;
+        }
+    }
 
 
     std::cout << "Brain Created" << std::endl;
 
-    double_t output[numOutput] = { 0.0 };
+    minstScalar output[numOutput] = { 0.0 };
+    minstScalar image[IMG_LEN] = { 0.0 };
 
-    brain->guess(trainingSet[0].image, output);
+    trainingSet[0].normalize(image);
+    brain.guess(image, output);
 
     for (int i = 0; i < numOutput; ++i)
     {
@@ -373,22 +880,47 @@ void minstMain()
     }
     drawImage(&trainingSet[0]);
 
-    std::uniform_real_distribution<float> uniformDist(0, numTraining);
+    if (COMPARE_HOGWILD)
+    {
+        hogwildComparison((uint16_t)std::thread::hardware_concurrency());
+    }
+
+    std::cout << "Trained 0 Epochs - Accuracy: " << testEpoch() * 100 << "%" << std::endl;
 
-    uint16_t numToTrain = 5;
-    uint16_t numEpochs = 0;
+    // Train until the schedule runs out or the test accuracy stops improving
+    bool keepTraining = true;
 
-    do
+    while (keepTraining)
     {
-        double_t percentCorrect = testEpoch();
+        minstScalar epochRate = schedule.rateAt(schedule.getStep());
+
+        if (STREAM_TRAINING)
+        {
+            trainEpochStreaming();
+        }
+        else if (PREFETCH_TRAINING)
+        {
+            trainEpochPrefetched();
+        }
+        else
+        {
+            trainEpoch();
+        }
 
-        std::cout << "Trained " << numEpochs++ << " Epochs - Accuracy: " << percentCorrect * 100 << "%" << std::endl;
+        double_t percentCorrect = testEpoch();
+        keepTraining = schedule.endEpoch(percentCorrect);
 
-        trainEpoch();
+        std::cout << "Trained " << schedule.getEpoch() << " Epochs - Accuracy: " << percentCorrect * 100 << "%"
+                  << " - Learning Rate: " << epochRate << (schedule.isBest() ? " *" : "") << std::endl;
+    }
 
-    } while (numEpochs < numToTrain);
+    if (schedule.stoppedEarly())
+    {
+        std::cout << "Stopped Early - Best Accuracy: " << schedule.getBestMetric() * 100 << "% after "
+                  << schedule.getBestEpoch() << " Epochs" << std::endl;
+    }
 
-    brain->guess(trainingSet[0].image, output);
+    brain.guess(image, output);
     uint16_t guess = getHighestIndex(output, numOutput);
 
     for (int i = 0; i < numOutput; ++i)
@@ -404,5 +936,30 @@ void minstMain()
     }
     drawImage(&trainingSet[0]);
 
-    delete brain;
+    if (COMPARE_QUANTIZED)
+    {
+        quantizedComparison();
+    }
+
+    if (COMPARE_DEEP)
+    {
+        deepComparison(1);
+    }
+
+    if (SAVE_CHECKPOINT)
+    {
+        checkpointComparison();
+    }
+
+#if NN_PROFILE
+    // Where the time of every phase went, and a timeline of each call
+    Profiler::report();
+    Profiler::printHistogram("parallelTrain");
+    Profiler::printHistogram("batchBackPropagate");
+
+    if (Profiler::writeChromeTrace(TRACE_PATH))
+    {
+        std::cout << "Trace written to " << TRACE_PATH << std::endl;
+    }
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,881 @@
+//-----------------------------------------------------------------------------
+// File: selfcheck.cpp
+// Author: Edward Koch
+// Description: Self-check of the compute kernels and file formats
+//              Every SIMD kernel the CPU supports is compared with the scalar
+//              fallback, and every GEMM shape, transposed operand and packed
+//              byte operand with a naive product, on odd sizes that leave
+//              partial register tiles and cache blocks. Checkpoints and IDX
+//              files are written to the working directory and read back
+//
+//              Usage: SelfCheck [--verbose]
+//                --verbose  print every check, not only the failures
+//              Returns 0 if every check passes - run by ctest
+//
+// Revision History
+// Author     Date        Description
+//-----------------------------------------------------------------------------
+// E. Koch    10/17/26    Initial Creation
+//-----------------------------------------------------------------------------
+#include "Checkpoint.h"
+#include "IdxFile.h"
+#include "Matrix.h"
+#include "MatrixSimd.h"
+#include "NeuralNet.h"
+#include "QuantizedNet.h"
+
+#include <limits>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// Fixed seed so every run checks the same data
+std::mt19937 rng(7);
+
+bool verbose = false;
+uint32_t numChecks = 0;
+uint32_t numFailed = 0;
+
+// Name of an element type for the report
+template<typename T>
+const char* typeName()
+{
+    return (sizeof(T) == sizeof(float)) ? "float" : "double";
+}
+
+// Name of an instruction set for the report
+const char* levelName(Simd::Level level)
+{
+    switch (level)
+    {
+    case Simd::Level::AVX512:
+        return "avx512";
+    case Simd::Level::AVX2:
+        return "avx2";
+    case Simd::Level::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+// Dimensions as text, e.g. 37x259x53
+std::string shapeName(uint32_t a, uint32_t b, uint32_t c = 0)
+{
+    std::string shape = std::to_string(a) + "x" + std::to_string(b);
+
+    if (c > 0)
+    {
+        shape += "x" + std::to_string(c);
+    }
+
+    return shape;
+}
+
+// Record one check - printed if it fails, or always when verbose
+bool expect(bool passed, const std::string &name, double error = 0.0)
+{
+    ++numChecks;
+
+    if (!passed)
+    {
+        ++numFailed;
+    }
+
+    if (!passed || verbose)
+    {
+        printf("%s  %-56s  error %.3g\n", passed ? "PASS" : "FAIL", name.c_str(), error);
+    }
+
+    return passed;
+}
+
+// Every instruction set the CPU supports, scalar first
+std::vector<Simd::Level> supportedLevels()
+{
+    std::vector<Simd::Level> levels;
+
+    for (uint8_t level = (uint8_t)Simd::Level::SCALAR; level <= (uint8_t)Simd::detectLevel(); ++level)
+    {
+        levels.push_back((Simd::Level)level);
+    }
+
+    return levels;
+}
+
+// Largest error of values against expected, relative to the larger of |expected| and floor
+template<typename T>
+double maxError(const T* values, const T* expected, uint64_t len, double floor)
+{
+    double error = 0.0;
+
+    for (uint64_t i = 0; i < len; ++i)
+    {
+        double scale = fabs((double)expected[i]);
+        double diff = fabs((double)values[i] - (double)expected[i]) / ((scale > floor) ? scale : floor);
+
+        // A NaN fails every comparison, so count it as an unbounded error
+        if (!(diff <= error))
+        {
+            error = (diff == diff) ? diff : HUGE_VAL;
+        }
+    }
+
+    return error;
+}
+
+template<typename T>
+std::vector<T> randomArray(uint64_t len, T min, T max)
+{
+    std::uniform_real_distribution<double> dist(min, max);
+    std::vector<T> values(len);
+
+    for (uint64_t i = 0; i < len; ++i)
+    {
+        values[i] = (T)dist(rng);
+    }
+
+    return values;
+}
+
+// Lengths with every remainder of a register and a multi-register body
+const uint64_t LENGTHS[] = { 1, 3, 7, 16, 33, 100, 1031 };
+
+// Relative error allowed between a SIMD kernel and the scalar fallback - the
+// same arithmetic, rounded differently where the vector kernels fuse a multiply-add
+template<typename T>
+double kernelTolerance()
+{
+    return (sizeof(T) == sizeof(float)) ? 1e-5 : 1e-13;
+}
+
+//////////////////////
+// Element-wise Kernels
+//////////////////////
+// Arithmetic, copies and byte conversion are exact on every instruction set
+template<typename T>
+void checkElementWise(Simd::Level level)
+{
+    const Simd::Ops<T> ref = Simd::makeOps<T>(Simd::Level::SCALAR);
+    const Simd::Ops<T> ops = Simd::makeOps<T>(level);
+
+    std::string suffix = std::string(" ") + typeName<T>() + " " + levelName(level);
+
+    for (uint64_t len : LENGTHS)
+    {
+        std::vector<T> a = randomArray<T>(len, (T)-2.0, (T)2.0);
+        std::vector<T> b = randomArray<T>(len, (T)-2.0, (T)2.0);
+        std::vector<uint8_t> bytes(len);
+
+        for (uint64_t i = 0; i < len; ++i)
+        {
+            bytes[i] = (uint8_t)(rng() & 0xFF);
+        }
+
+        std::vector<T> expected(a);
+        std::vector<T> actual(a);
+        std::string name = "simd " + std::to_string(len);
+
+        ref.add(expected.data(), b.data(), len);
+        ops.add(actual.data(), b.data(), len);
+        expect(actual == expected, name + " add" + suffix);
+
+        ref.sub(expected.data(), b.data(), len);
+        ops.sub(actual.data(), b.data(), len);
+        expect(actual == expected, name + " sub" + suffix);
+
+        ref.mul(expected.data(), b.data(), len);
+        ops.mul(actual.data(), b.data(), len);
+        expect(actual == expected, name + " mul" + suffix);
+
+        ref.addScalar(expected.data(), (T)0.375, len);
+        ops.addScalar(actual.data(), (T)0.375, len);
+        expect(actual == expected, name + " addScalar" + suffix);
+
+        ref.mulScalar(expected.data(), (T)-1.25, len);
+        ops.mulScalar(actual.data(), (T)-1.25, len);
+        expect(actual == expected, name + " mulScalar" + suffix);
+
+        ref.copy(expected.data(), b.data(), len);
+        ops.copy(actual.data(), b.data(), len);
+        expect(actual == expected, name + " copy" + suffix);
+
+        ref.set(expected.data(), (T)3.0, len);
+        ops.set(actual.data(), (T)3.0, len);
+        expect(actual == expected, name + " set" + suffix);
+
+        ref.fromBytes(expected.data(), bytes.data(), (T)(1.0 / 255.0), len);
+        ops.fromBytes(actual.data(), bytes.data(), (T)(1.0 / 255.0), len);
+        expect(actual == expected, name + " fromBytes" + suffix);
+    }
+}
+
+//////////////////////
+// Activation Kernels
+//////////////////////
+// Each SIMD activation against the scalar fallback of the same accuracy
+template<typename T>
+void checkActivations(Simd::Level level, Simd::Accuracy accuracy)
+{
+    const Simd::Ops<T> ref = Simd::makeOps<T>(Simd::Level::SCALAR, accuracy);
+    const Simd::Ops<T> ops = Simd::makeOps<T>(level, accuracy);
+
+    std::string suffix = std::string(" ") + typeName<T>() + " " + levelName(level) +
+                         ((accuracy == Simd::Accuracy::FAST) ? " fast" : " precise");
+
+    typedef void (*Activation)(T* a, const T* b, uint64_t len);
+
+    // gelu and its derivative pass through zero away from x = 0, where a
+    // relative error means nothing - they are compared in absolute terms below 1
+    struct Kernel
+    {
+        const char* name;
+        Activation ref;
+        Activation ops;
+        double floor;
+    };
+
+    const Kernel kernels[] = { { "exp", ref.exp, ops.exp, 1e-30 },
+                               { "sigmoid", ref.sigmoid, ops.sigmoid, 1e-30 },
+                               { "tanh", ref.tanh, ops.tanh, 1e-30 },
+                               { "gelu", ref.gelu, ops.gelu, 1.0 },
+                               { "geluDerivative", ref.geluDerivative, ops.geluDerivative, 1.0 } };
+
+    for (uint64_t len : LENGTHS)
+    {
+        // Wide enough to reach the saturated tails, with small inputs for tanh's cancellation
+        std::vector<T> x = randomArray<T>(len, (T)-12.0, (T)12.0);
+
+        for (uint64_t i = 0; i < len; i += 4)
+        {
+            x[i] *= (T)1e-4;
+        }
+
+        for (const Kernel &kernel : kernels)
+        {
+            std::vector<T> expected(len);
+            std::vector<T> actual(len);
+
+            kernel.ref(expected.data(), x.data(), len);
+            kernel.ops(actual.data(), x.data(), len);
+
+            double error = maxError(actual.data(), expected.data(), len, kernel.floor);
+            expect(error <= kernelTolerance<T>(), "simd " + std::to_string(len) + " " + kernel.name + suffix, error);
+        }
+    }
+
+    // A NaN input must come out as NaN, in the vector body and the scalar
+    // remainder alike, rather than be clamped to a finite activation
+    const uint64_t nanLength = 35;
+    const uint64_t nanIndices[] = { 0, 5, nanLength - 1 };
+
+    std::vector<T> x = randomArray<T>(nanLength, (T)-4.0, (T)4.0);
+
+    for (uint64_t i : nanIndices)
+    {
+        x[i] = std::numeric_limits<T>::quiet_NaN();
+    }
+
+    for (const Kernel &kernel : kernels)
+    {
+        std::vector<T> expected(nanLength);
+        std::vector<T> actual(nanLength);
+
+        kernel.ref(expected.data(), x.data(), nanLength);
+        kernel.ops(actual.data(), x.data(), nanLength);
+
+        bool propagated = true;
+
+        for (uint64_t i : nanIndices)
+        {
+            propagated &= (actual[i] != actual[i]) && (expected[i] != expected[i]);
+        }
+
+        expect(propagated, std::string("simd nan ") + kernel.name + suffix);
+    }
+}
+
+// The PRECISE scalar fallback against the C library - within a few ulp
+template<typename T>
+void checkPreciseActivations()
+{
+    const Simd::Ops<T> ref = Simd::makeOps<T>(Simd::Level::SCALAR, Simd::Accuracy::PRECISE);
+    const double ulp = (sizeof(T) == sizeof(float)) ? 1.1920929e-7 : 2.220446e-16;
+
+    const uint64_t len = 4096;
+    std::vector<T> x = randomArray<T>(len, (T)-10.0, (T)10.0);
+
+    for (uint64_t i = 0; i < len; i += 2)
+    {
+        x[i] *= (T)1e-5;
+    }
+
+    std::vector<T> expected(len);
+    std::vector<T> actual(len);
+
+    for (uint64_t i = 0; i < len; ++i)
+    {
+        expected[i] = (T)exp((double)x[i]);
+    }
+    ref.exp(actual.data(), x.data(), len);
+
+    double error = maxError(actual.data(), expected.data(), len, 1e-30) / ulp;
+    expect(error <= 16.0, std::string("libm exp ") + typeName<T>() + " ulp", error);
+
+    for (uint64_t i = 0; i < len; ++i)
+    {
+        expected[i] = (T)tanh((double)x[i]);
+    }
+    ref.tanh(actual.data(), x.data(), len);
+
+    error = maxError(actual.data(), expected.data(), len, 1e-30) / ulp;
+    expect(error <= 16.0, std::string("libm tanh ") + typeName<T>() + " ulp", error);
+}
+
+//////////////////////
+// Optimizer Kernels
+//////////////////////
+// Momentum, RMSProp and Adam against the scalar fallback - weights and moments
+template<typename T>
+void checkOptimizers(Simd::Level level)
+{
+    const Simd::Ops<T> ref = Simd::makeOps<T>(Simd::Level::SCALAR);
+    const Simd::Ops<T> ops = Simd::makeOps<T>(level);
+
+    std::string suffix = std::string(" ") + typeName<T>() + " " + levelName(level);
+
+    for (uint64_t len : LENGTHS)
+    {
+        std::vector<T> step = randomArray<T>(len, (T)-0.5, (T)0.5);
+        std::vector<T> weights = randomArray<T>(len, (T)-1.0, (T)1.0);
+        std::vector<T> first = randomArray<T>(len, (T)-0.1, (T)0.1);
+        std::vector<T> second = randomArray<T>(len, (T)0.0, (T)0.1);
+
+        std::vector<T> refWeights(weights), refFirst(first), refSecond(second);
+        std::vector<T> opsWeights(weights), opsFirst(first), opsSecond(second);
+        std::string name = "optimizer " + std::to_string(len);
+
+        ref.momentum(refWeights.data(), refFirst.data(), step.data(), (T)0.9, (T)0.01, (T)0.05, (T)0.1, len);
+        ops.momentum(opsWeights.data(), opsFirst.data(), step.data(), (T)0.9, (T)0.01, (T)0.05, (T)0.1, len);
+        double error = maxError(opsWeights.data(), refWeights.data(), len, 1.0);
+        error = fmax(error, maxError(opsFirst.data(), refFirst.data(), len, 1.0));
+        expect(error <= kernelTolerance<T>(), name + " momentum" + suffix, error);
+
+        refWeights = weights; refSecond = second;
+        opsWeights = weights; opsSecond = second;
+        ref.rmsProp(refWeights.data(), refSecond.data(), step.data(), (T)0.9, (T)0.01, (T)1e-6, (T)0.01, len);
+        ops.rmsProp(opsWeights.data(), opsSecond.data(), step.data(), (T)0.9, (T)0.01, (T)1e-6, (T)0.01, len);
+        error = maxError(opsWeights.data(), refWeights.data(), len, 1.0);
+        error = fmax(error, maxError(opsSecond.data(), refSecond.data(), len, 1.0));
+        expect(error <= kernelTolerance<T>(), name + " rmsProp" + suffix, error);
+
+        refWeights = weights; refFirst = first; refSecond = second;
+        opsWeights = weights; opsFirst = first; opsSecond = second;
+        ref.adam(refWeights.data(), refFirst.data(), refSecond.data(), step.data(), (T)0.9, (T)0.999, (T)0.001, (T)1e-8, (T)0.01, (T)0.9999, len);
+        ops.adam(opsWeights.data(), opsFirst.data(), opsSecond.data(), step.data(), (T)0.9, (T)0.999, (T)0.001, (T)1e-8, (T)0.01, (T)0.9999, len);
+        error = maxError(opsWeights.data(), refWeights.data(), len, 1.0);
+        error = fmax(error, maxError(opsFirst.data(), refFirst.data(), len, 1.0));
+        error = fmax(error, maxError(opsSecond.data(), refSecond.data(), len, 1.0));
+        expect(error <= kernelTolerance<T>(), name + " adam" + suffix, error);
+    }
+}
+
+//////////////////////
+// GEMM
+//////////////////////
+// Largest error of C against a naive product in double, relative to the
+// depth of the sum, as every operand is within [-1, 1]
+// transposeA / transposeB read A as K x M / B as N x K
+template<uint16_t M, uint16_t K, uint16_t N, typename T, typename BT>
+double gemmError(const T* a, const BT* b, double bScale, const T* c, bool transposeA, bool transposeB)
+{
+    double error = 0.0;
+
+    for (uint16_t i = 0; i < M; ++i)
+    {
+        for (uint16_t j = 0; j < N; ++j)
+        {
+            double sum = 0.0;
+
+            for (uint16_t k = 0; k < K; ++k)
+            {
+                double aVal = transposeA ? a[(uint64_t)k * M + i] : a[(uint64_t)i * K + k];
+                double bVal = transposeB ? b[(uint64_t)j * K + k] : b[(uint64_t)k * N + j];
+
+                sum += aVal * bVal * bScale;
+            }
+
+            error = fmax(error, fabs(sum - (double)c[(uint64_t)i * N + j]));
+        }
+    }
+
+    return error / K;
+}
+
+// A few rounding errors per term of the sum
+template<typename T>
+double gemmTolerance()
+{
+    return (sizeof(T) == sizeof(float)) ? 1e-6 : 1e-15;
+}
+
+// C(MxN) = A(MxK) * B(KxN), with B in full precision and as scaled bytes
+template<uint16_t M, uint16_t K, uint16_t N, typename T>
+void checkMultiply(Simd::Level level)
+{
+    Matrix<M, K, T> a;
+    Matrix<K, N, T> b;
+    Matrix<M, N, T> c;
+    std::vector<uint8_t> bytes((uint64_t)K * N);
+
+    a.randomize(rng, (T)-1.0, (T)1.0);
+    b.randomize(rng, (T)-1.0, (T)1.0);
+
+    for (uint8_t &byte : bytes)
+    {
+        byte = (uint8_t)(rng() & 0xFF);
+    }
+
+    std::string suffix = " " + shapeName(M, K, N) + " " + typeName<T>() + " " + levelName(level);
+
+    a.multiply(b, c);
+    double error = gemmError<M, K, N>(a.getData(), b.getData(), 1.0, c.getData(), false, false);
+    expect(error <= gemmTolerance<T>(), "gemm multiply" + suffix, error);
+
+    a.multiply(bytes.data(), (T)(1.0 / 255.0), c);
+    error = gemmError<M, K, N>(a.getData(), bytes.data(), (double)(T)(1.0 / 255.0), c.getData(), false, false);
+    expect(error <= gemmTolerance<T>(), "gemm multiply bytes" + suffix, error);
+}
+
+// C(MxN) = A^T * B with A stored K x M, and C(MxN) = A * B^T with B stored N x K
+template<uint16_t M, uint16_t K, uint16_t N, typename T>
+void checkTransposed(Simd::Level level)
+{
+    Matrix<K, M, T> aTransposed;
+    Matrix<M, K, T> a;
+    Matrix<K, N, T> b;
+    Matrix<N, K, T> bTransposed;
+    Matrix<M, N, T> c;
+
+    aTransposed.randomize(rng, (T)-1.0, (T)1.0);
+    a.randomize(rng, (T)-1.0, (T)1.0);
+    b.randomize(rng, (T)-1.0, (T)1.0);
+    bTransposed.randomize(rng, (T)-1.0, (T)1.0);
+
+    std::string suffix = " " + shapeName(M, K, N) + " " + typeName<T>() + " " + levelName(level);
+
+    aTransposed.transposeMultiply(b, c);
+    double error = gemmError<M, K, N>(aTransposed.getData(), b.getData(), 1.0, c.getData(), true, false);
+    expect(error <= gemmTolerance<T>(), "gemm transposeMultiply" + suffix, error);
+
+    a.multiplyTransposed(bTransposed, c);
+    error = gemmError<M, K, N>(a.getData(), bTransposed.getData(), 1.0, c.getData(), false, true);
+    expect(error <= gemmTolerance<T>(), "gemm multiplyTransposed" + suffix, error);
+}
+
+// C += scale * column * row^T
+template<uint16_t M, uint16_t N, typename T>
+void checkOuterProduct(Simd::Level level)
+{
+    Matrix<M, N, T> c;
+    Matrix<M, 1, T> column;
+    Matrix<N, 1, T> row;
+
+    c.randomize(rng, (T)-1.0, (T)1.0);
+    column.randomize(rng, (T)-1.0, (T)1.0);
+    row.randomize(rng, (T)-1.0, (T)1.0);
+
+    Matrix<M, N, T> expected(c);
+    c.addOuterProduct(column, row, (T)0.5);
+
+    double error = 0.0;
+
+    for (uint16_t i = 0; i < M; ++i)
+    {
+        for (uint16_t j = 0; j < N; ++j)
+        {
+            double sum = (double)expected.getElement(i, j) + 0.5 * (double)column.getElement(i, 0) * (double)row.getElement(j, 0);
+            error = fmax(error, fabs(sum - (double)c.getElement(i, j)));
+        }
+    }
+
+    expect(error <= 4 * gemmTolerance<T>(), "gemm addOuterProduct " + shapeName(M, N) + " " + typeName<T>() + " " + levelName(level), error);
+}
+
+// Softmax of every column against exp and a sum in double
+template<uint16_t M, uint16_t N, typename T>
+void checkSoftmax(Simd::Level level)
+{
+    Matrix<M, N, T> a;
+    a.randomize(rng, (T)-8.0, (T)8.0);
+
+    Matrix<M, N, T> inputs(a);
+    a.softmaxColumns();
+
+    double error = 0.0;
+
+    for (uint16_t j = 0; j < N; ++j)
+    {
+        double sum = 0.0;
+
+        for (uint16_t i = 0; i < M; ++i)
+        {
+            sum += exp((double)inputs.getElement(i, j));
+        }
+
+        for (uint16_t i = 0; i < M; ++i)
+        {
+            double expected = exp((double)inputs.getElement(i, j)) / sum;
+            error = fmax(error, fabs(expected - (double)a.getElement(i, j)) / expected);
+        }
+    }
+
+    expect(error <= kernelTolerance<T>(), "softmax " + shapeName(M, N) + " " + typeName<T>() + " " + levelName(level), error);
+}
+
+// Every GEMM shape - blocked with partial tiles, more than one slice of K,
+// more than one block of M and N - and the GEMV, outer product and row vector shapes
+template<typename T>
+void checkGemm(Simd::Level level)
+{
+    Simd::setLevel(level);
+
+    checkMultiply<37, 259, 53, T>(level);
+    checkMultiply<5, 3, 17, T>(level);
+    checkMultiply<100, 70, 2050, T>(level);
+    checkMultiply<31, 45, 1, T>(level);
+    checkMultiply<23, 1, 19, T>(level);
+    checkMultiply<1, 29, 13, T>(level);
+
+    checkTransposed<41, 29, 35, T>(level);
+    checkTransposed<97, 300, 9, T>(level);
+    checkTransposed<41, 29, 1, T>(level);
+    checkTransposed<1, 29, 35, T>(level);
+
+    checkOuterProduct<19, 23, T>(level);
+
+    checkSoftmax<10, 37, T>(level);
+    checkSoftmax<3, 1, T>(level);
+}
+
+//////////////////////
+// Quantized Dot Products
+//////////////////////
+// The int8 kernels are exact, so each must equal the scalar sum
+void checkQuantizedDot()
+{
+    typedef Quantized::DotFunction DotFunction;
+
+    struct Kernel
+    {
+        const char* name;
+        DotFunction dot;
+    };
+
+    std::vector<Kernel> kernels;
+
+#if MATRIX_SIMD_X86
+    if (Simd::detectLevel() >= Simd::Level::AVX2)
+    {
+        kernels.push_back({ "avx2", Quantized::dotAvx2 });
+    }
+
+    if (Simd::detectLevel() >= Simd::Level::AVX512 && Quantized::detectVnni())
+    {
+        kernels.push_back({ "vnni", Quantized::dotVnni });
+    }
+#endif
+
+    const uint16_t lengths[] = { Quantized::paddedLength(1), Quantized::paddedLength(130), Quantized::paddedLength(784) };
+
+    for (uint16_t len : lengths)
+    {
+        std::vector<uint8_t> a(len);
+        std::vector<int8_t> b(len);
+
+        // Activations are kept to 7 bits, weights span the whole signed range
+        for (uint16_t i = 0; i < len; ++i)
+        {
+            a[i] = (uint8_t)(rng() % (Quantized::QUANT_MAX + 1));
+            b[i] = (int8_t)((int32_t)(rng() % (2 * Quantized::QUANT_MAX + 1)) - Quantized::QUANT_MAX);
+        }
+
+        // The extremes of both ranges, so the int16 pair sums are at their limits
+        a[0] = (uint8_t)Quantized::QUANT_MAX;
+        a[1] = (uint8_t)Quantized::QUANT_MAX;
+        b[0] = (int8_t)-Quantized::QUANT_MAX;
+        b[1] = (int8_t)-Quantized::QUANT_MAX;
+
+        int32_t expected = 0;
+
+        for (uint16_t i = 0; i < len; ++i)
+        {
+            expected += (int32_t)a[i] * (int32_t)b[i];
+        }
+
+        expect(Quantized::dotGeneric(a.data(), b.data(), len) == expected, "quantized dot " + std::to_string(len) + " scalar");
+
+        for (const Kernel &kernel : kernels)
+        {
+            int32_t actual = kernel.dot(a.data(), b.data(), len);
+            expect(actual == expected, "quantized dot " + std::to_string(len) + " " + kernel.name, fabs((double)actual - expected));
+        }
+    }
+}
+
+//////////////////////
+// File Formats
+//////////////////////
+bool writeFile(const char* path, const std::vector<uint8_t> &bytes)
+{
+    FILE* file = fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool written = fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+    return (fclose(file) == 0) && written;
+}
+
+std::vector<uint8_t> readFile(const char* path)
+{
+    std::vector<uint8_t> bytes;
+    FILE* file = fopen(path, "rb");
+
+    if (file != nullptr)
+    {
+        uint8_t buffer[4096];
+        size_t numRead;
+
+        while ((numRead = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        {
+            bytes.insert(bytes.end(), buffer, buffer + numRead);
+        }
+
+        fclose(file);
+    }
+
+    return bytes;
+}
+
+void appendBigEndian(std::vector<uint8_t> &bytes, uint32_t value)
+{
+    bytes.push_back((uint8_t)(value >> 24));
+    bytes.push_back((uint8_t)(value >> 16));
+    bytes.push_back((uint8_t)(value >> 8));
+    bytes.push_back((uint8_t)value);
+}
+
+// Write a 5 x 3 x 4 image file, read every item back, then reject a
+// truncated file and a file of another data type
+void checkIdxFile()
+{
+    const char* path = "selfcheck.idx";
+    const uint32_t dims[3] = { 5, 3, 4 };
+    const uint64_t itemSize = dims[1] * dims[2];
+
+    std::vector<uint8_t> bytes = { 0x00, 0x00, Idx::TYPE_UBYTE, 0x03 };
+
+    for (uint32_t dim : dims)
+    {
+        appendBigEndian(bytes, dim);
+    }
+
+    uint64_t headerSize = bytes.size();
+
+    for (uint64_t i = 0; i < dims[0] * itemSize; ++i)
+    {
+        bytes.push_back((uint8_t)(rng() & 0xFF));
+    }
+
+    if (!expect(writeFile(path, bytes), "idx write"))
+    {
+        return;
+    }
+
+    {
+        IdxFile file;
+
+        if (expect(file.open(path), "idx open"))
+        {
+            expect(file.getNumDims() == 3 && file.getCount() == dims[0] && file.getDim(1) == dims[1] &&
+                   file.getDim(2) == dims[2] && file.getItemSize() == itemSize, "idx header");
+
+            bool itemsMatch = true;
+
+            for (uint32_t item = 0; item < dims[0]; ++item)
+            {
+                itemsMatch &= memcmp(file.getItem(item), bytes.data() + headerSize + item * itemSize, itemSize) == 0;
+            }
+
+            expect(itemsMatch, "idx items");
+
+            std::vector<float> normalized(3 * itemSize);
+            file.normalize(1, 3, normalized.data(), 1.0f / 255.0f);
+
+            bool normalizedMatch = true;
+
+            for (uint64_t i = 0; i < normalized.size(); ++i)
+            {
+                normalizedMatch &= normalized[i] == bytes[headerSize + itemSize + i] * (1.0f / 255.0f);
+            }
+
+            expect(normalizedMatch, "idx normalize");
+        }
+    }
+
+    // One byte short of the last item
+    std::vector<uint8_t> truncated(bytes.begin(), bytes.end() - 1);
+    writeFile(path, truncated);
+    {
+        IdxFile file;
+        expect(!file.open(path), "idx rejects truncated");
+    }
+
+    // Float data, not unsigned bytes
+    std::vector<uint8_t> floats(bytes);
+    floats[2] = 0x0D;
+    writeFile(path, floats);
+    {
+        IdxFile file;
+        expect(!file.open(path), "idx rejects other types");
+    }
+
+    remove(path);
+}
+
+// Save a Neural Net, load and attach it elsewhere, then reject a corrupt
+// checkpoint and one of another shape
+template<typename T>
+void checkCheckpoint()
+{
+    const char* path = "selfcheck.nnck";
+    std::string suffix = std::string(" ") + typeName<T>();
+
+    NeuralNet<13, 7, 3, T> net(rng, NN::Activations::TANH, (T)0.0125);
+    net.randomize((T)-1.0, (T)1.0);
+
+    if (!expect(CheckpointFile::save(path, net, 1234), "checkpoint save" + suffix))
+    {
+        return;
+    }
+
+    T inputs[13];
+    T expectedOutputs[3];
+    T outputs[3];
+
+    for (T &input : inputs)
+    {
+        input = (T)std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    }
+
+    net.guess(inputs, expectedOutputs);
+
+    {
+        CheckpointFile file;
+
+        if (expect(file.open(path), "checkpoint open" + suffix))
+        {
+            expect(file.getHeader().step == 1234, "checkpoint step" + suffix);
+
+            NeuralNet<13, 7, 3, T> loaded(rng, NN::Activations::TANH, (T)0.5);
+
+            if (expect(file.load(loaded), "checkpoint load" + suffix))
+            {
+                bool weightsMatch =
+                    memcmp(loaded.getInputWeights().getData(), net.getInputWeights().getData(), 13 * 7 * sizeof(T)) == 0 &&
+                    memcmp(loaded.getInputBias().getData(), net.getInputBias().getData(), 7 * sizeof(T)) == 0 &&
+                    memcmp(loaded.getHiddenWeights().getData(), net.getHiddenWeights().getData(), 7 * 3 * sizeof(T)) == 0 &&
+                    memcmp(loaded.getHiddenBias().getData(), net.getHiddenBias().getData(), 3 * sizeof(T)) == 0;
+
+                expect(weightsMatch && loaded.getLearningRate() == net.getLearningRate(), "checkpoint weights" + suffix);
+            }
+
+            NeuralNet<13, 7, 3, T> attached(rng, NN::Activations::TANH, (T)0.5);
+
+            if (expect(file.attach(attached), "checkpoint attach" + suffix))
+            {
+                attached.guess(inputs, outputs);
+                expect(memcmp(outputs, expectedOutputs, sizeof(outputs)) == 0, "checkpoint attached guess" + suffix);
+            }
+
+            NeuralNet<13, 8, 3, T> otherShape(rng, NN::Activations::TANH, (T)0.5);
+            expect(!file.load(otherShape), "checkpoint rejects other shape" + suffix);
+        }
+    }
+
+    // One flipped bit in the last blob fails the checksum
+    std::vector<uint8_t> bytes = readFile(path);
+
+    if (expect(bytes.size() > sizeof(Checkpoint::Header), "checkpoint read" + suffix))
+    {
+        bytes[bytes.size() - 1] ^= 0x01;
+        writeFile(path, bytes);
+
+        CheckpointFile file;
+        expect(!file.open(path), "checkpoint rejects corrupt" + suffix);
+    }
+
+    remove(path);
+}
+
+int main(int argc, char** argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--verbose") == 0)
+        {
+            verbose = true;
+        }
+        else
+        {
+            printf("Usage: %s [--verbose]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    printf("SIMD: %s\n", levelName(Simd::detectLevel()));
+
+    //////////////////////
+    // Kernels
+    //////////////////////
+    for (Simd::Level level : supportedLevels())
+    {
+        checkElementWise<float>(level);
+        checkElementWise<double_t>(level);
+
+        checkActivations<float>(level, Simd::Accuracy::PRECISE);
+        checkActivations<double_t>(level, Simd::Accuracy::PRECISE);
+        checkActivations<float>(level, Simd::Accuracy::FAST);
+        checkActivations<double_t>(level, Simd::Accuracy::FAST);
+
+        checkOptimizers<float>(level);
+        checkOptimizers<double_t>(level);
+
+        checkGemm<float>(level);
+        checkGemm<double_t>(level);
+    }
+
+    Simd::setLevel(Simd::detectLevel());
+
+    checkPreciseActivations<float>();
+    checkPreciseActivations<double_t>();
+
+    checkQuantizedDot();
+
+    //////////////////////
+    // File Formats
+    //////////////////////
+    checkIdxFile();
+    checkCheckpoint<float>();
+    checkCheckpoint<double_t>();
+
+    printf("%u checks, %u failed\n", numChecks, numFailed);
+
+    return (numFailed == 0) ? 0 : 1;
+}